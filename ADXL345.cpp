@@ -33,100 +33,187 @@
 #define ADXL345_DATAZ1			0x37 // z-axis data 1
 #define ADXL345_FIFO_CTL		0x38 // FIFO control
 #define ADXL345_FIFO_STATUS		0x39 // FIFO status
-#define ADXL345_ADDRESS			0x53 // device address when ADO = 0
 
-// accelerometer measure limits
-enum Ascales
+static void convert(const int16_t * raw, float res, float &ax, float &ay, float &az)
 {
-	AFS_2G = 0,
-	AFS_4G,
-	AFS_8G,
-	AFS_16G
-};
-
-// accelerometer ODR and Bandwidth
-enum Arates
-{
-	ARTBW_010_005 = 0,	// 0.1 Hz ODR, 0.05Hz bandwidth
-	ARTBW_020_010,
-	ARTBW_039_020,
-	ARTBW_078_039,
-	ARTBW_156_078,
-	ARTBW_313_156,
-	ARTBW_125_625,
-	ARTBW_25_125,
-	ARTBW_50_25,
-	ARTBW_100_50,
-	ARTBW_200_100,
-	ARTBW_400_200,
-	ARTBW_800_400,
-	ARTBW_1600_800,
-	ARTBW_3200_1600		// 3200 Hz ODR, 1600 Hz bandwidth
-};
-
-constexpr float getAres(Ascales scale)
-{
-	// possible accelerometer scales (and their register bit settings) are:
-	// 2 Gs (00), 4 Gs (01), 8 Gs (10), and 16 Gs (11).
-	return
-		scale == AFS_2G  ?  2.0f/( 512.0f*64.0f) : // 10-bit 2s-complement
-		scale == AFS_4G  ?  4.0f/(1024.0f*32.0f) : // 11-bit 2s-complement
-		scale == AFS_8G  ?  8.0f/(2048.0f*16.0f) : // 12-bit 2s-complement
-		scale == AFS_16G ? 16.0f/(4096.0f* 8.0f) : // 13-bit 2s-complement
-		0.0f;
+	// calculate the accleration value in Gs
+	ax = (float)raw[0] * res;
+	ay = (float)raw[1] * res;
+	az = (float)raw[2] * res;
 }
 
-constexpr Ascales Ascale = AFS_4G;
-constexpr Arates  Arate  = ARTBW_100_50;
-constexpr float   aRes   = getAres(Ascale);
+void ADXL345Base::unpack(const uint8_t * rawData, int16_t * raw)
+{
+	raw[0] = ((int16_t)rawData[1] << 8) | rawData[0]; // turn the MSB and LSB into a signed 16-bit value
+	raw[1] = ((int16_t)rawData[3] << 8) | rawData[2];
+	raw[2] = ((int16_t)rawData[5] << 8) | rawData[4];
+}
 
-int ADXL345::init()
+int ADXL345Base::setup(uint8_t scale, uint8_t rate)
 {
-	const auto who = readByte(ADXL345_ADDRESS, WHO_AM_I_ADXL345);
+	uint8_t who;
 
-	if (who != I_AM_ADXL345)
+	if (readByte(bus, address, WHO_AM_I_ADXL345, who) != 0 || who != I_AM_ADXL345)
 	{
 		return -1;
 	}
 
 	// preset device state
-	writeByte(ADXL345_ADDRESS, ADXL345_POWER_CTL,	0x00);			// put device in standby mode
+	if (writeByte(bus, address, ADXL345_POWER_CTL,	0x00) != 0)				// put device in standby mode
+	{
+		return -1;
+	}
 	delay(12); // worst case 11.1 ms from datasheet
 
 	// setup device
-	writeByte(ADXL345_ADDRESS, ADXL345_BW_RATE,		Arate);			// normal power operation, ODR, bandwidth
-	writeByte(ADXL345_ADDRESS, ADXL345_DATA_FORMAT,	0x04 | Ascale);	// set full scale range left justify MSB
-	writeByte(ADXL345_ADDRESS, ADXL345_FIFO_CTL,	0x00);			// bypass FIFO
+	if (writeByte(bus, address, ADXL345_BW_RATE,		rate) != 0 ||			// normal power operation, ODR, bandwidth
+		writeByte(bus, address, ADXL345_DATA_FORMAT,	0x04 | scale) != 0 ||		// set full scale range left justify MSB
+		writeByte(bus, address, ADXL345_FIFO_CTL,	0x00) != 0)				// bypass FIFO
+	{
+		return -1;
+	}
 	
 	// start measurment process
-	writeByte(ADXL345_ADDRESS, ADXL345_POWER_CTL,	0x08);			// put device in normal mode
+	if (writeByte(bus, address, ADXL345_POWER_CTL,	0x08) != 0)				// put device in normal mode
+	{
+		return -1;
+	}
 	delay(12); // settle again
 
 	return 0;
 }
 
-int ADXL345::measure(float &ax, float &ay, float &az)
+int ADXL345Base::readRaw(int16_t * raw)
 {
-	if (readByte(ADXL345_ADDRESS, ADXL345_INT_SOURCE) & 0x80) // when data ready bit is high
+	uint8_t rawData[6];
+
+	if (readBytes(bus, address, ADXL345_DATAX0, 6, &rawData[0]) != 0) //read measurement in one pass
 	{
-		uint8_t rawData[6];
+		return -2;
+	}
 
-		readBytes(ADXL345_ADDRESS, ADXL345_DATAX0, 6, &rawData[0]); //read measurement in one pass
+	unpack(rawData, raw);
 
-		const int16_t sensorOut[3] 
-		{
-			((int16_t)rawData[1] << 8) | rawData[0], // turn the MSB and LSB into a signed 16-bit value
-			((int16_t)rawData[3] << 8) | rawData[2],
-			((int16_t)rawData[5] << 8) | rawData[4],
-		};
+	return 0;
+}
+
+int ADXL345Base::measureRaw(int16_t * raw)
+{
+	uint8_t status;
 
-		// calculate the accleration value in Gs
-		ax = (float)sensorOut[0] * aRes;
-		ay = (float)sensorOut[1] * aRes;
-		az = (float)sensorOut[2] * aRes;
+	if (readByte(bus, address, ADXL345_INT_SOURCE, status) != 0)
+	{
+		return -2;
+	}
+
+	motion |= status & (activityBit | inactivityBit);
 
-		return 0;
+	if (ready(status))
+	{
+		return readRaw(raw);
 	}
 
 	return -1;
 }
+
+int ADXL345Base::enableDataReady()
+{
+	intEnable |= 0x80; // DATA_READY, cleared by reading data, mapped to INT1 pin, active high
+
+	if (writeByte(bus, address, ADXL345_INT_MAP,		intMap) != 0 ||
+		writeByte(bus, address, ADXL345_INT_ENABLE,	intEnable) != 0)
+	{
+		return -1;
+	}
+
+	return 0;
+}
+
+int ADXL345Base::enableMotion(uint8_t activity, uint8_t inactivity, uint8_t seconds)
+{
+	intEnable |= activityBit | inactivityBit;
+	intMap &= ~(activityBit | inactivityBit); // to INT1
+
+	if (writeByte(bus, address, ADXL345_THRESH_ACT,		activity) != 0 ||
+		writeByte(bus, address, ADXL345_THRESH_INACT,	inactivity) != 0 ||
+		writeByte(bus, address, ADXL345_TIME_INACT,		seconds) != 0 ||
+		writeByte(bus, address, ADXL345_ACT_INACT_CTL,	0xFF) != 0 ||		// AC coupled, all axes for both
+		writeByte(bus, address, ADXL345_INT_MAP,		intMap) != 0 ||
+		writeByte(bus, address, ADXL345_INT_ENABLE,		intEnable) != 0 ||
+		writeByte(bus, address, ADXL345_POWER_CTL,		0x38) != 0)			// link, auto sleep, measure, 8 Hz in sleep
+	{
+		return -1;
+	}
+
+	return 0;
+}
+
+int ADXL345Base::startStream(uint8_t watermark)
+{
+	if (writeByte(bus, address, ADXL345_FIFO_CTL,	0x80 | (watermark & 0x1F)) != 0)	// stream mode, trigger on INT1, watermark
+	{
+		return -1;
+	}
+
+	return 0;
+}
+
+int ADXL345Base::readStream(ImuSample * samples, int count, float res, float period)
+{
+	const uint32_t now = micros();
+
+	uint8_t status;
+
+	if (readByte(bus, address, ADXL345_FIFO_STATUS, status) != 0)
+	{
+		return -2;
+	}
+
+	// entries in FIFO, output registers hold one more
+	int available = status & 0x3F;
+
+	if (available == 0)
+	{
+		return -1;
+	}
+
+	if (available > count)
+	{
+		available = count;
+	}
+
+	// FIFO pops one entry per data register read, there is no multi-sample burst on this chip
+	for (int i = 0; i < available; ++i)
+	{
+		uint8_t rawData[6];
+
+		if (readBytes(bus, address, ADXL345_DATAX0, 6, &rawData[0]) != 0)
+		{
+			return i > 0 ? i : -2; // samples read so far are good
+		}
+
+		int16_t raw[3];
+		unpack(rawData, raw);
+		convert(raw, res, samples[i].x(), samples[i].y(), samples[i].z());
+
+		// oldest sample comes first, newest was taken about now
+		samples[i].time = now - (uint32_t)((available - 1 - i) * period);
+	}
+
+	return available;
+}
+
+void ADXL345Base::prepareStatus(I2cTransaction & t, uint8_t * status)
+{
+	t.prepareRead(address, ADXL345_INT_SOURCE, 1, status);
+}
+
+void ADXL345Base::prepareData(I2cTransaction & t, uint8_t * rawData)
+{
+	t.prepareRead(address, ADXL345_DATAX0, 6, rawData);
+}
+
+bool ADXL345Base::ready(uint8_t status)
+{
+	return status & 0x80; // when data ready bit is high
+}
@@ -1,16 +1,179 @@
 #ifndef ADXL345_h_
 #define ADXL345_h_
 
-#include "imusensor.h"
+#include <Arduino.h>
 
-class ADXL345 : public ImuSensor
+#include "imusample.h"
+#include "i2chelp.h"
+#include "mounting.h"
+
+// accelerometer measure limits
+enum Ascales
+{
+	AFS_2G = 0,
+	AFS_4G,
+	AFS_8G,
+	AFS_16G
+};
+
+// accelerometer ODR and Bandwidth
+enum Arates
+{
+	ARTBW_010_005 = 0,	// 0.1 Hz ODR, 0.05Hz bandwidth
+	ARTBW_020_010,
+	ARTBW_039_020,
+	ARTBW_078_039,
+	ARTBW_156_078,
+	ARTBW_313_156,
+	ARTBW_125_625,
+	ARTBW_25_125,
+	ARTBW_50_25,
+	ARTBW_100_50,
+	ARTBW_200_100,
+	ARTBW_400_200,
+	ARTBW_800_400,
+	ARTBW_1600_800,
+	ARTBW_3200_1600		// 3200 Hz ODR, 1600 Hz bandwidth
+};
+
+constexpr float getAres(Ascales scale)
+{
+	// possible accelerometer scales (and their register bit settings) are:
+	// 2 Gs (00), 4 Gs (01), 8 Gs (10), and 16 Gs (11).
+	return
+		scale == AFS_2G  ?  2.0f/( 512.0f*64.0f) : // 10-bit 2s-complement
+		scale == AFS_4G  ?  4.0f/(1024.0f*32.0f) : // 11-bit 2s-complement
+		scale == AFS_8G  ?  8.0f/(2048.0f*16.0f) : // 12-bit 2s-complement
+		scale == AFS_16G ? 16.0f/(4096.0f* 8.0f) : // 13-bit 2s-complement
+		0.0f;
+}
+
+// Register access shared by every configuration, see ADXL345T for the sensor itself
+class ADXL345Base
+{
+public:
+	// ALT ADDRESS pin low, as on GY-80, or high
+	static constexpr uint8_t addressLow  = 0x53;
+	static constexpr uint8_t addressHigh = 0x1D;
+
+	// reading as it comes from sensor, multiply by resolution() to get physical value
+	// return 0 with new reading, -1 if there is none yet, -2 on bus error
+	int measureRaw(int16_t * raw);
+	// read data without asking status, for use when data ready interrupt said so
+	int readRaw(int16_t * raw);
+
+	// drive data ready interrupt pin of sensor, return 0 on success
+	int enableDataReady();
+
+	// Motion engine, AC coupled on all axes, thresholds in 62.5 mG steps.
+	// Activity above activity threshold ends inactivity, staying below inactivity threshold
+	// for given seconds starts it. Events are linked, so they alternate, and chip drops to 8 Hz
+	// output while inactive. Both go to INT1 pin along with data ready, so interrupt driven reading
+	// sees them on the pin it watches anyway, and status read that comes with data takes them. Return 0 on success.
+	int enableMotion(uint8_t activity, uint8_t inactivity, uint8_t seconds);
+
+	// activity and inactivity bits seen by status reads since last call, reading status clears them on chip
+	uint8_t takeMotion() { const uint8_t e = motion; motion = 0; return e; }
+
+	static constexpr uint8_t activityBit   = 0x10;
+	static constexpr uint8_t inactivityBit = 0x08;
+
+	// Status check and read as separate transactions, so reads of several buses can be queued and run at once.
+	// Status transaction reads one byte, data transaction 6 bytes, see unpack().
+	void prepareStatus(I2cTransaction & t, uint8_t * status);
+	void prepareData(I2cTransaction & t, uint8_t * rawData);
+	static bool ready(uint8_t status);
+	static void unpack(const uint8_t * rawData, int16_t * raw);
+
+protected:
+	ADXL345Base(I2cEngine & bus, uint8_t address) : bus(bus), address(address) {}
+
+	int setup(uint8_t scale, uint8_t rate);
+	int startStream(uint8_t watermark);
+	int readStream(ImuSample * samples, int count, float res, float period);
+
+	I2cEngine & bus;
+	const uint8_t address;
+
+	// INT_ENABLE and INT_MAP as written, so data ready and motion can be set up in any order
+	uint8_t intEnable = 0;
+	uint8_t intMap = 0;
+
+	uint8_t motion = 0;
+};
+
+// Configuration is fixed at compile time, so scale factor folds into a constant and calls need no dispatch
+// Mount turns readings from sensor to board frame, see mounting.h
+template <Ascales Scale = AFS_4G, Arates Rate = ARTBW_100_50, class Mount = NoMounting>
+class ADXL345T : public ADXL345Base
 {
+	static_assert(Scale >= AFS_2G && Scale <= AFS_16G, "No such accelerometer range");
+	static_assert(Rate >= ARTBW_010_005 && Rate <= ARTBW_3200_1600, "No such accelerometer rate");
+	static_assert(Rate <= ARTBW_800_400, "Datasheet limits output rate to 800 Hz with 400 kHz I2C");
+
 public:
-	ADXL345() = default;
-	virtual ~ADXL345() = default;
-	
-	virtual int init();
-	virtual int measure(float &ax, float &ay, float &az);
+	explicit ADXL345T(I2cEngine & bus = WireEngine, uint8_t address = addressLow) : ADXL345Base(bus, address) {}
+
+	// return 0 on success, -1 if sensor does not answer or is not what it should be
+	int init() { return setup(Scale, Rate); }
+
+	// as in ADXL345Base, but in board frame
+	int measureRaw(int16_t * raw) { return mounted(ADXL345Base::measureRaw(raw), raw); }
+	int readRaw(int16_t * raw) { return mounted(ADXL345Base::readRaw(raw), raw); }
+	static void unpack(const uint8_t * rawData, int16_t * raw) { ADXL345Base::unpack(rawData, raw); Mount::apply(raw); }
+
+	// acceleration in G, return 0 with new reading, -1 if there is none yet, -2 on bus error
+	int measure(float &ax, float &ay, float &az)
+	{
+		int16_t raw[3];
+
+		const int result = measureRaw(raw);
+
+		if (result != 0)
+		{
+			return result;
+		}
+
+		// calculate the accleration value in Gs
+		ax = (float)raw[0] * resolution();
+		ay = (float)raw[1] * resolution();
+		az = (float)raw[2] * resolution();
+
+		return 0;
+	}
+
+	static constexpr float resolution() { return getAres(Scale); }
+
+	// microseconds between samples
+	static constexpr float period() { return 312.5f * (1 << (ARTBW_3200_1600 - Rate)); }
+
+	// put FIFO in stream mode, watermark is number of samples (0..31) to raise watermark flag
+	int initStream(uint8_t watermark) { return init() != 0 ? -1 : startStream(watermark); }
+	// drain up to count samples from FIFO, return number of samples read, -1 if none or -2 on bus error
+	int measureStream(ImuSample * samples, int count)
+	{
+		const int n = readStream(samples, count, resolution(), period());
+
+		for (int i = 0; i < n; ++i)
+		{
+			Mount::apply(samples[i].values);
+		}
+
+		return n;
+	}
+
+protected:
+	static int mounted(int result, int16_t * raw)
+	{
+		if (result == 0)
+		{
+			Mount::apply(raw);
+		}
+
+		return result;
+	}
 };
 
+typedef ADXL345T<> ADXL345;
+
 #endif
@@ -1,11 +1,196 @@
 #include "BMP085.h"
 
-int BMP085::init()
+#include "i2chelp.h"
+
+#define BMP085_ADDRESS		0x77
+#define BMP085_CAL_AC1		0xAA // first of 11 big endian calibration words
+#define BMP085_CHIP_ID		0xD0
+#define BMP085_CHIP_ID_R	0x55
+#define BMP085_CONTROL		0xF4
+#define BMP085_OUT_MSB		0xF6
+#define BMP085_OUT_LSB		0xF7
+#define BMP085_OUT_XLSB		0xF8
+#define BMP085_CMD_TEMP		0x2E
+#define BMP085_CMD_PRES		0x34 // | oversampling << 6
+
+constexpr uint32_t Ttime = 4500; // temperature conversion in microseconds
+
+// temperature drifts slowly, refresh it once per this many pressure readings
+constexpr uint8_t pressurePerTemperature = 8;
+
+int BMP085Base::init()
+{
+	uint8_t id;
+
+	if (readByte(bus, BMP085_ADDRESS, BMP085_CHIP_ID, id) != 0 || id != BMP085_CHIP_ID_R)
+	{
+		return -1;
+	}
+
+	uint8_t rawData[22];
+
+	if (readBytes(bus, BMP085_ADDRESS, BMP085_CAL_AC1, 22, &rawData[0]) != 0)
+	{
+		return -1;
+	}
+
+	int16_t words[11];
+
+	for (uint8_t i = 0; i < 11; ++i)
+	{
+		words[i] = ((int16_t)rawData[2 * i] << 8) | rawData[2 * i + 1]; // MSB first
+
+		// datasheet says 0 and 0xFFFF mean broken communication
+		if (words[i] == 0 || words[i] == -1)
+		{
+			return -1;
+		}
+	}
+
+	cal.ac1 = words[0];
+	cal.ac2 = words[1];
+	cal.ac3 = words[2];
+	cal.ac4 = (uint16_t)words[3];
+	cal.ac5 = (uint16_t)words[4];
+	cal.ac6 = (uint16_t)words[5];
+	cal.b1  = words[6];
+	cal.b2  = words[7];
+	cal.mb  = words[8];
+	cal.mc  = words[9];
+	cal.md  = words[10];
+
+	// first pressure needs temperature
+	return startTemperature();
+}
+
+int BMP085Base::startTemperature()
+{
+	if (writeByte(bus, BMP085_ADDRESS, BMP085_CONTROL, BMP085_CMD_TEMP) != 0)
+	{
+		state = STATE_IDLE;
+		return -2;
+	}
+
+	started = micros();
+	state = STATE_TEMPERATURE;
+
+	return 0;
+}
+
+int BMP085Base::startPressure()
 {
+	if (writeByte(bus, BMP085_ADDRESS, BMP085_CONTROL, BMP085_CMD_PRES | (oss << 6)) != 0)
+	{
+		state = STATE_IDLE;
+		return -2;
+	}
+
+	started = micros();
+	state = STATE_PRESSURE;
+
 	return 0;
 }
 
-int BMP085::measure(float &, float &, float &)
+int BMP085Base::measure(float & temperature, float & pressure, float & altitude)
 {
+	const uint32_t elapsed = micros() - started;
+
+	switch (state)
+	{
+	case STATE_TEMPERATURE:
+		if (elapsed >= Ttime)
+		{
+			uint8_t rawData[2];
+
+			if (readBytes(bus, BMP085_ADDRESS, BMP085_OUT_MSB, 2, &rawData[0]) != 0)
+			{
+				startTemperature();
+				return -2;
+			}
+
+			ut = ((int32_t)rawData[0] << 8) | rawData[1];
+			pressureCount = 0;
+
+			return startPressure() == 0 ? -1 : -2;
+		}
+		break;
+
+	case STATE_PRESSURE:
+		if (elapsed >= ptime)
+		{
+			uint8_t rawData[3];
+
+			const int result = readBytes(bus, BMP085_ADDRESS, BMP085_OUT_MSB, 3, &rawData[0]);
+
+			// start next conversion before doing math, it runs meanwhile, also after failed read
+			if (++pressureCount >= pressurePerTemperature)
+			{
+				startTemperature();
+			}
+			else
+			{
+				startPressure();
+			}
+
+			if (result != 0)
+			{
+				return -2;
+			}
+
+			const int32_t up = (((int32_t)rawData[0] << 16) | ((int32_t)rawData[1] << 8) | rawData[2]) >> (8 - oss);
+
+			int32_t t, p;
+
+			compensate(cal, ut, up, oss, t, p);
+
+			temperature = t * 0.1f;
+			pressure = p;
+			altitude = 44330.0f * (1.0f - powf(pressure / 101325.0f, 1.0f / 5.255f)); // international barometric formula
+
+			return 0;
+		}
+		break;
+
+	case STATE_IDLE:
+		// starting conversion failed before, try again
+		return startTemperature() == 0 ? -1 : -2;
+	}
+
 	return -1;
 }
+
+// checked against datasheet calculation example in test/bmp085test.cpp
+void BMP085Base::compensate(const Bmp085Calibration & cal, int32_t ut, int32_t up, uint8_t oss, int32_t & temperature, int32_t & pressure)
+{
+	int32_t x1, x2, x3, b3, b5, b6, p;
+	uint32_t b4, b7;
+
+	// temperature
+	x1 = ((ut - (int32_t)cal.ac6) * (int32_t)cal.ac5) >> 15;
+	// mc is negative, multiply instead of shifting it left
+	x2 = ((int32_t)cal.mc * 2048) / (x1 + cal.md);
+	b5 = x1 + x2;
+
+	temperature = (b5 + 8) >> 4;
+
+	// pressure
+	b6 = b5 - 4000;
+	x1 = (cal.b2 * ((b6 * b6) >> 12)) >> 11;
+	x2 = (cal.ac2 * b6) >> 11;
+	x3 = x1 + x2;
+	b3 = ((((int32_t)cal.ac1 * 4 + x3) * (1 << oss)) + 2) >> 2;
+
+	x1 = (cal.ac3 * b6) >> 13;
+	x2 = (cal.b1 * ((b6 * b6) >> 12)) >> 16;
+	x3 = ((x1 + x2) + 2) >> 2;
+	b4 = ((uint32_t)cal.ac4 * (uint32_t)(x3 + 32768)) >> 15;
+	b7 = ((uint32_t)up - b3) * (50000 >> oss);
+
+	p = b7 < 0x80000000 ? (b7 * 2) / b4 : (b7 / b4) * 2;
+
+	x1 = (p >> 8) * (p >> 8);
+	x1 = (x1 * 3038) >> 16;
+	x2 = (-7357 * p) >> 16;
+
+	pressure = p + ((x1 + x2 + 3791) >> 4);
+}
@@ -1,16 +1,90 @@
 #ifndef BMP085_h_
 #define BMP085_h_
 
-#include "imusensor.h"
+#include <Arduino.h>
 
-class BMP085 : public ImuSensor
+#include "i2chelp.h"
+
+// pressure oversampling, internal samples per reading
+enum Posss
+{
+	POSS_ULTRA_LOW_POWER = 0,	// 1 sample, 4.5 ms
+	POSS_STANDARD,				// 2 samples, 7.5 ms
+	POSS_HIGH_RES,				// 4 samples, 13.5 ms
+	POSS_ULTRA_HIGH_RES,		// 8 samples, 25.5 ms
+};
+
+constexpr uint32_t getPtime(Posss oss)
+{
+	// worst case conversion time in microseconds
+	return 1500 + (3000 << oss);
+}
+
+// factory calibration from device EEPROM
+struct Bmp085Calibration
+{
+	int16_t  ac1, ac2, ac3;
+	uint16_t ac4, ac5, ac6;
+	int16_t  b1, b2;
+	int16_t  mb, mc, md;
+};
+
+// Conversions run in background, measure() only checks if current one is over and starts next one,
+// so it never waits. Temperature is converted once every few pressure readings.
+// Has one fixed address, one per bus. See BMP085T for the sensor itself.
+class BMP085Base
 {
 public:
-	BMP085() = default;
-	virtual ~BMP085() = default;
-	
-	virtual int init();
-	virtual int measure(float &, float &, float &);
+	// return 0 on success, -1 if sensor does not answer or is not what it should be
+	int init();
+
+	// temperature in C, pressure in Pa, altitude in m above standard sea level pressure
+	// return 0 when new pressure is ready, -1 otherwise, -2 on bus error
+	int measure(float & temperature, float & pressure, float & altitude);
+
+	// datasheet integer algorithm, temperature in 0.1 C, pressure in Pa
+	static void compensate(const Bmp085Calibration & cal, int32_t ut, int32_t up, uint8_t oss, int32_t & temperature, int32_t & pressure);
+
+protected:
+	BMP085Base(I2cEngine & bus, Posss oss) : bus(bus), oss(oss), ptime(getPtime(oss)) {}
+
+	enum State : uint8_t
+	{
+		STATE_IDLE,			// nothing running, next measure() starts temperature conversion
+		STATE_TEMPERATURE,	// temperature conversion running
+		STATE_PRESSURE,		// pressure conversion running
+	};
+
+	// return 0 or -2 on bus error
+	int startTemperature();
+	int startPressure();
+
+	I2cEngine & bus;
+
+	const uint8_t  oss;
+	const uint32_t ptime;	// pressure conversion in microseconds
+
+	Bmp085Calibration cal;
+
+	State state = STATE_IDLE;
+	uint32_t started;	// micros() when conversion started
+	int32_t ut;			// uncompensated temperature of latest conversion
+	uint8_t pressureCount;
+};
+
+// Oversampling is fixed at compile time, it only sets conversion command and wait
+template <Posss Oss = POSS_STANDARD>
+class BMP085T : public BMP085Base
+{
+	static_assert(Oss >= POSS_ULTRA_LOW_POWER && Oss <= POSS_ULTRA_HIGH_RES, "No such pressure oversampling");
+
+public:
+	explicit BMP085T(I2cEngine & bus = WireEngine) : BMP085Base(bus, Oss) {}
+
+	// microseconds between pressure readings, one temperature conversion is added every few of them
+	static constexpr uint32_t period() { return getPtime(Oss); }
 };
 
+typedef BMP085T<> BMP085;
+
 #endif
@@ -1,16 +1,135 @@
 #ifndef HMC5883L_h_
 #define HMC5883L_h_
 
-#include "imusensor.h"
+#include <Arduino.h>
 
-class HMC5883L : public ImuSensor
+#include "i2chelp.h"
+#include "mounting.h"
+
+enum Mscales
+{
+	MFS_GAIN0 = 0,
+	MFS_GAIN1,
+	MFS_GAIN2,
+	MFS_GAIN3,
+	MFS_GAIN4,
+	MFS_GAIN5,
+	MFS_GAIN6,
+	MFS_GAIN7,
+};
+
+// Magnetometer ODR
+enum Mrates
+{ 
+	MRT_0075 = 0,	// 0.75 Hz ODR
+	MRT_015,		// 1.5 Hz
+	MRT_030,		// 3.0 Hz
+	MRT_075,		// 7.5 Hz
+	MRT_15,			// 15 Hz default
+	MRT_30,			// 30 Hz
+	MRT_75,			// 75 Hz ODR    
+};
+
+constexpr float getMres(Mscales scale)
+{
+	// in mG per LSB, with +- of field
+	return
+		scale == MFS_GAIN0 ?  0.73f : // 0.88 Ga
+		scale == MFS_GAIN1 ?  0.92f : // 1.3 Ga default
+		scale == MFS_GAIN2 ?  1.22f : // 1.9 Ga
+		scale == MFS_GAIN3 ?  1.52f : // 2.5 Ga
+		scale == MFS_GAIN4 ?  2.27f : // 4.0 Ga
+		scale == MFS_GAIN5 ?  2.56f : // 4.7 Ga
+		scale == MFS_GAIN6 ?  3.03f : // 5.6 Ga
+		scale == MFS_GAIN7 ?  4.35f : // 8.1 Ga
+		0.0f;
+}
+
+// Register access shared by every configuration, see HMC5883LT for the sensor itself.
+// Has one fixed address, one per bus.
+class HMC5883LBase
+{
+public:
+	// reading as it comes from sensor, multiply by resolution() to get physical value
+	// return 0 with new reading, -1 if there is none yet, -2 on bus error
+	int measureRaw(int16_t * raw);
+	// read data without asking status, for use when data ready interrupt said so
+	int readRaw(int16_t * raw);
+
+	// drive data ready interrupt pin of sensor, return 0 on success
+	int enableDataReady();
+
+	// idle mode and back to continuous measurement, return 0 or -2 on bus error
+	int sleep();
+	int wake();
+
+	// Status check and read as separate transactions, so reads of several buses can be queued and run at once.
+	// Status transaction reads one byte, data transaction 6 bytes, see unpack().
+	void prepareStatus(I2cTransaction & t, uint8_t * status);
+	void prepareData(I2cTransaction & t, uint8_t * rawData);
+	static bool ready(uint8_t status);
+	static void unpack(const uint8_t * rawData, int16_t * raw);
+
+protected:
+	explicit HMC5883LBase(I2cEngine & bus) : bus(bus) {}
+
+	int setup(uint8_t scale, uint8_t rate);
+
+	I2cEngine & bus;
+};
+
+// Configuration is fixed at compile time, so scale factor folds into a constant and calls need no dispatch
+// Mount turns readings from sensor to board frame, see mounting.h
+template <Mscales Scale = MFS_GAIN0, Mrates Rate = MRT_75, class Mount = NoMounting>
+class HMC5883LT : public HMC5883LBase
 {
+	static_assert(Scale >= MFS_GAIN0 && Scale <= MFS_GAIN7, "No such magnetometer gain");
+	static_assert(Rate >= MRT_0075 && Rate <= MRT_75, "No such magnetometer rate");
+
 public:
-	HMC5883L() = default;
-	virtual ~HMC5883L() = default;
-	
-	virtual int init();
-	virtual int measure(float &, float &, float &);
+	explicit HMC5883LT(I2cEngine & bus = WireEngine) : HMC5883LBase(bus) {}
+
+	// return 0 on success, -1 if sensor does not answer or is not what it should be
+	int init() { return setup(Scale, Rate); }
+
+	// as in HMC5883LBase, but in board frame
+	int measureRaw(int16_t * raw) { return mounted(HMC5883LBase::measureRaw(raw), raw); }
+	int readRaw(int16_t * raw) { return mounted(HMC5883LBase::readRaw(raw), raw); }
+	static void unpack(const uint8_t * rawData, int16_t * raw) { HMC5883LBase::unpack(rawData, raw); Mount::apply(raw); }
+
+	// field strength in milliGauss, return 0 with new reading, -1 if there is none yet, -2 on bus error
+	int measure(float &mx, float &my, float &mz)
+	{
+		int16_t raw[3];
+
+		const int result = measureRaw(raw);
+
+		if (result != 0)
+		{
+			return result;
+		}
+
+		mx = (float)raw[0] * resolution();
+		my = (float)raw[1] * resolution();
+		mz = (float)raw[2] * resolution();
+
+		return 0;
+	}
+
+	static constexpr float resolution() { return getMres(Scale); }
+
+protected:
+	static int mounted(int result, int16_t * raw)
+	{
+		if (result == 0)
+		{
+			Mount::apply(raw);
+		}
+
+		return result;
+	}
 };
 
+typedef HMC5883LT<> HMC5883L;
+
 #endif
@@ -1,7 +1,6 @@
 #include "L3G4200D.h"
 
 #include "i2chelp.h"
-#include "mathhelp.h"
 
 #define WHO_AM_I_L3G4200D		0x0F
 #define I_AM_L3G4200D			0xD3
@@ -30,92 +29,167 @@
 #define L3G4200D_INT1_TSH_ZH	0x36
 #define L3G4200D_INT1_TSH_ZL	0x37
 #define L3G4200D_INT1_DURATION	0x38
-#define L3G4200D_ADDRESS		0x69 // device address when ADO = 0
 
-// gyro measure limits
-enum Gscales
+static void convert(const int16_t * raw, float res, float &gx, float &gy, float &gz)
 {
-	GFS_250DPS = 0,
-	GFS_500DPS,
-	GFS_2000DPS
-};
+	// calculate the angle rate in radians per second
+	gx = (float)raw[0] * res;
+	gy = (float)raw[1] * res;
+	gz = (float)raw[2] * res;
+}
 
-// gyro ODR and Bandwidth with 4 bits
-enum Grates
-{
-	GRTBW_100_125 = 0,	// 100 Hz ODR, 12.5 Hz bandwidth
-	GRTBW_100_25,
-	GRTBW_100_25a,
-	GRTBW_100_25b,
-	GRTBW_200_125,
-	GRTBW_200_25,
-	GRTBW_200_50,
-	GRTBW_200_70,
-	GRTBW_400_20,
-	GRTBW_400_25,
-	GRTBW_400_50,
-	GRTBW_400_110,
-	GRTBW_800_30,
-	GRTBW_800_35,
-	GRTBW_800_50,
-	GRTBW_800_110		// 800 Hz ODR, 110 Hz bandwidth   
-};
-
-constexpr float getGres(Gscales scale)
+void L3G4200DBase::unpack(const uint8_t * rawData, int16_t * raw)
 {
-	// possible gyro scales (and their register bit settings) are:
-	// 250 DPS (00), 500 DPS (01), and 2000 DPS (10 or 11). 
-	return
-		scale == GFS_250DPS  ?  250.0f/32768.0f :
-		scale == GFS_500DPS  ?  500.0f/32768.0f :
-		scale == GFS_2000DPS ? 2000.0f/32768.0f :
-		0.0f;
+	raw[0] = ((int16_t)rawData[1] << 8) | rawData[0]; // turn the MSB and LSB into a signed 16-bit value
+	raw[1] = ((int16_t)rawData[3] << 8) | rawData[2];
+	raw[2] = ((int16_t)rawData[5] << 8) | rawData[4];
 }
 
-constexpr Gscales Gscale = GFS_500DPS;
-constexpr Grates  Grate  = GRTBW_100_25;
-constexpr float   gRes   = deg2rad(getGres(Gscale));
-
-int L3G4200D::init()
+int L3G4200DBase::setup(uint8_t scale, uint8_t rate)
 {
-	const auto who = readByte(L3G4200D_ADDRESS, WHO_AM_I_L3G4200D);
+	uint8_t who;
 
-	if (who != I_AM_L3G4200D)
+	if (readByte(bus, address, WHO_AM_I_L3G4200D, who) != 0 || who != I_AM_L3G4200D)
 	{
 		return -1;
 	}
 
-	writeByte(L3G4200D_ADDRESS, L3G4200D_CTRL_REG1,	Grate << 4 | 0x0F);	// set gyro ODR and bandwidth, normal mode, all axis active
+	ctrl1 = rate << 4 | 0x0F;
+
 	//skip register 2, has something to do with calibration
 	//skip register 3, don`t use interrupts
-	writeByte(L3G4200D_ADDRESS, L3G4200D_CTRL_REG4,	Gscale << 4);		// set cont. update, gyro scale, no self-test
-	writeByte(L3G4200D_ADDRESS, L3G4200D_CTRL_REG5,	0x00);				// disable FIFO
+	if (writeByte(bus, address, L3G4200D_CTRL_REG1,	ctrl1) != 0 ||				// set gyro ODR and bandwidth, normal mode, all axis active
+		writeByte(bus, address, L3G4200D_CTRL_REG4,	scale << 4) != 0 ||			// set cont. update, gyro scale, no self-test
+		writeByte(bus, address, L3G4200D_CTRL_REG5,	0x00) != 0)					// disable FIFO
+	{
+		return -1;
+	}
 
 	return 0;
 }
 
-int L3G4200D::measure(float &gx, float &gy, float &gz)
+int L3G4200DBase::readRaw(int16_t * raw)
 {
-	if (readByte(L3G4200D_ADDRESS, L3G4200D_STATUS_REG) & 0x08) // when zyxda bit is high
+	uint8_t rawData[6];
+
+	if (readBytes(bus, address, L3G4200D_OUT_X_L | 0x80, 6, &rawData[0]) != 0) //read measurement in one pass
 	{
-		uint8_t rawData[6];
+		return -2;
+	}
 
-		readBytes(L3G4200D_ADDRESS, L3G4200D_OUT_X_L | 0x80, 6, &rawData[0]); //read measurement in one pass
+	unpack(rawData, raw);
 
-		const int16_t sensorOut[3] 
-		{
-			((int16_t)rawData[1] << 8) | rawData[0], // turn the MSB and LSB into a signed 16-bit value
-			((int16_t)rawData[3] << 8) | rawData[2],
-			((int16_t)rawData[5] << 8) | rawData[4],
-		};
+	return 0;
+}
 
-		// calculate the angle rate in radians per second
-		gx = (float)sensorOut[0] * gRes;
-		gy = (float)sensorOut[1] * gRes;   
-		gz = (float)sensorOut[2] * gRes;  
+int L3G4200DBase::measureRaw(int16_t * raw)
+{
+	uint8_t status;
 
-		return 0;
+	if (readByte(bus, address, L3G4200D_STATUS_REG, status) != 0)
+	{
+		return -2;
+	}
+
+	if (ready(status))
+	{
+		return readRaw(raw);
 	}
 
 	return -1;
 }
+
+int L3G4200DBase::enableDataReady()
+{
+	if (writeByte(bus, address, L3G4200D_CTRL_REG3,	0x08) != 0)	// data ready on INT2 pin, active high, push-pull
+	{
+		return -1;
+	}
+
+	return 0;
+}
+
+int L3G4200DBase::sleep()
+{
+	return writeByte(bus, address, L3G4200D_CTRL_REG1, ctrl1 & 0xF0) != 0 ? -2 : 0; // PD bit low
+}
+
+int L3G4200DBase::wake()
+{
+	return writeByte(bus, address, L3G4200D_CTRL_REG1, ctrl1) != 0 ? -2 : 0;
+}
+
+int L3G4200DBase::startStream(uint8_t watermark)
+{
+	if (writeByte(bus, address, L3G4200D_FIFO_CTRL_REG,	0x40 | (watermark & 0x1F)) != 0 ||	// stream mode, watermark
+		writeByte(bus, address, L3G4200D_CTRL_REG5,		0x40) != 0)							// enable FIFO
+	{
+		return -1;
+	}
+
+	return 0;
+}
+
+int L3G4200DBase::readStream(ImuSample * samples, int count, float res, float period)
+{
+	const uint32_t now = micros();
+
+	uint8_t src;
+
+	if (readByte(bus, address, L3G4200D_FIFO_SRC_REG, src) != 0)
+	{
+		return -2;
+	}
+
+	if (src & 0x20) // EMPTY bit
+	{
+		return -1;
+	}
+
+	int available = (src & 0x40) ? 32 : (src & 0x1F); // OVRN means FIFO is full
+
+	if (available > count)
+	{
+		available = count;
+	}
+
+	if (available == 0)
+	{
+		return -1;
+	}
+
+	// with FIFO enabled auto increment wraps from OUT_Z_H to OUT_X_L, so all samples come in one burst
+	uint8_t rawData[6 * 32];
+
+	if (readBytes(bus, address, L3G4200D_OUT_X_L | 0x80, 6 * available, &rawData[0]) != 0)
+	{
+		return -2;
+	}
+
+	for (int i = 0; i < available; ++i)
+	{
+		int16_t raw[3];
+		unpack(&rawData[6 * i], raw);
+		convert(raw, res, samples[i].x(), samples[i].y(), samples[i].z());
+
+		// oldest sample comes first, newest was taken about now
+		samples[i].time = now - (uint32_t)((available - 1 - i) * period);
+	}
+
+	return available;
+}
+
+void L3G4200DBase::prepareStatus(I2cTransaction & t, uint8_t * status)
+{
+	t.prepareRead(address, L3G4200D_STATUS_REG, 1, status);
+}
+
+void L3G4200DBase::prepareData(I2cTransaction & t, uint8_t * rawData)
+{
+	t.prepareRead(address, L3G4200D_OUT_X_L | 0x80, 6, rawData);
+}
+
+bool L3G4200DBase::ready(uint8_t status)
+{
+	return status & 0x08; // when zyxda bit is high
+}
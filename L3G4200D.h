@@ -1,16 +1,164 @@
 #ifndef L3G4200D_h_
 #define L3G4200D_h_
 
-#include "imusensor.h"
+#include <Arduino.h>
 
-class L3G4200D : public ImuSensor
+#include "imusample.h"
+#include "i2chelp.h"
+#include "mounting.h"
+#include "mathhelp.h"
+
+// gyro measure limits
+enum Gscales
+{
+	GFS_250DPS = 0,
+	GFS_500DPS,
+	GFS_2000DPS
+};
+
+// gyro ODR and Bandwidth with 4 bits
+enum Grates
+{
+	GRTBW_100_125 = 0,	// 100 Hz ODR, 12.5 Hz bandwidth
+	GRTBW_100_25,
+	GRTBW_100_25a,
+	GRTBW_100_25b,
+	GRTBW_200_125,
+	GRTBW_200_25,
+	GRTBW_200_50,
+	GRTBW_200_70,
+	GRTBW_400_20,
+	GRTBW_400_25,
+	GRTBW_400_50,
+	GRTBW_400_110,
+	GRTBW_800_30,
+	GRTBW_800_35,
+	GRTBW_800_50,
+	GRTBW_800_110		// 800 Hz ODR, 110 Hz bandwidth   
+};
+
+constexpr float getGres(Gscales scale)
+{
+	// possible gyro scales (and their register bit settings) are:
+	// 250 DPS (00), 500 DPS (01), and 2000 DPS (10 or 11). 
+	return
+		scale == GFS_250DPS  ?  250.0f/32768.0f :
+		scale == GFS_500DPS  ?  500.0f/32768.0f :
+		scale == GFS_2000DPS ? 2000.0f/32768.0f :
+		0.0f;
+}
+
+// Register access shared by every configuration, see L3G4200DT for the sensor itself
+class L3G4200DBase
 {
 public:
-	L3G4200D() = default;
-	virtual ~ L3G4200D() = default;
-	
-	virtual int init();
-	virtual int measure(float &, float &, float &);
+	// SDO pin low or high, as on GY-80
+	static constexpr uint8_t addressLow  = 0x68;
+	static constexpr uint8_t addressHigh = 0x69;
+
+	// reading as it comes from sensor, multiply by resolution() to get physical value
+	// return 0 with new reading, -1 if there is none yet, -2 on bus error
+	int measureRaw(int16_t * raw);
+	// read data without asking status, for use when data ready interrupt said so
+	int readRaw(int16_t * raw);
+
+	// drive data ready interrupt pin of sensor, return 0 on success
+	int enableDataReady();
+
+	// power down and back to rate set by init(), first reading after wake takes a while, return 0 or -2 on bus error
+	int sleep();
+	int wake();
+
+	// Status check and read as separate transactions, so reads of several buses can be queued and run at once.
+	// Status transaction reads one byte, data transaction 6 bytes, see unpack().
+	void prepareStatus(I2cTransaction & t, uint8_t * status);
+	void prepareData(I2cTransaction & t, uint8_t * rawData);
+	static bool ready(uint8_t status);
+	static void unpack(const uint8_t * rawData, int16_t * raw);
+
+protected:
+	L3G4200DBase(I2cEngine & bus, uint8_t address) : bus(bus), address(address) {}
+
+	int setup(uint8_t scale, uint8_t rate);
+	int startStream(uint8_t watermark);
+	int readStream(ImuSample * samples, int count, float res, float period);
+
+	I2cEngine & bus;
+	const uint8_t address;
+
+	uint8_t ctrl1 = 0; // CTRL_REG1 as set up
 };
 
+// Configuration is fixed at compile time, so scale factor folds into a constant and calls need no dispatch
+// Mount turns readings from sensor to board frame, see mounting.h
+template <Gscales Scale = GFS_500DPS, Grates Rate = GRTBW_100_25, class Mount = NoMounting>
+class L3G4200DT : public L3G4200DBase
+{
+	static_assert(Scale >= GFS_250DPS && Scale <= GFS_2000DPS, "No such gyro range");
+	static_assert(Rate >= GRTBW_100_125 && Rate <= GRTBW_800_110, "No such gyro rate");
+
+public:
+	explicit L3G4200DT(I2cEngine & bus = WireEngine, uint8_t address = addressHigh) : L3G4200DBase(bus, address) {}
+
+	// return 0 on success, -1 if sensor does not answer or is not what it should be
+	int init() { return setup(Scale, Rate); }
+
+	// as in L3G4200DBase, but in board frame
+	int measureRaw(int16_t * raw) { return mounted(L3G4200DBase::measureRaw(raw), raw); }
+	int readRaw(int16_t * raw) { return mounted(L3G4200DBase::readRaw(raw), raw); }
+	static void unpack(const uint8_t * rawData, int16_t * raw) { L3G4200DBase::unpack(rawData, raw); Mount::apply(raw); }
+
+	// angle rate in radians per second, return 0 with new reading, -1 if there is none yet, -2 on bus error
+	int measure(float &gx, float &gy, float &gz)
+	{
+		int16_t raw[3];
+
+		const int result = measureRaw(raw);
+
+		if (result != 0)
+		{
+			return result;
+		}
+
+		gx = (float)raw[0] * resolution();
+		gy = (float)raw[1] * resolution();
+		gz = (float)raw[2] * resolution();
+
+		return 0;
+	}
+
+	static constexpr float resolution() { return deg2rad(getGres(Scale)); }
+
+	// microseconds between samples, ODR is top 2 bits of rate
+	static constexpr float period() { return 10000 >> (Rate >> 2); }
+
+	// put FIFO in stream mode, watermark is number of samples (0..31) to raise watermark flag
+	int initStream(uint8_t watermark) { return init() != 0 ? -1 : startStream(watermark); }
+	// drain up to count samples from FIFO, return number of samples read, -1 if none or -2 on bus error
+	int measureStream(ImuSample * samples, int count)
+	{
+		const int n = readStream(samples, count, resolution(), period());
+
+		for (int i = 0; i < n; ++i)
+		{
+			Mount::apply(samples[i].values);
+		}
+
+		return n;
+	}
+
+protected:
+	static int mounted(int result, int16_t * raw)
+	{
+		if (result == 0)
+		{
+			Mount::apply(raw);
+		}
+
+		return result;
+	}
+};
+
+typedef L3G4200DT<> L3G4200D;
+
 #endif
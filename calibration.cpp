@@ -0,0 +1,280 @@
+#include "calibration.h"
+
+#include <math.h>
+
+// gyro
+constexpr float gyroAlpha = 0.05f;			// smoothing of motion detector, about 20 readings
+constexpr float gyroStillVar = 3.0e-4f;		// (rad/s)^2, about 1 degree/s of noise
+constexpr float acelStillVar = 4.0e-4f;		// G^2, about 0.02 G of noise
+constexpr float maxBias = 0.5f;				// rad/s, L3G4200D zero rate level is well below
+constexpr uint16_t biasWindow = 1024;		// average of first readings, then moving average of this length
+
+// magnetometer
+constexpr float fitUnit = 0.001f;			// mGauss to Gauss, keeps squared terms near 1
+constexpr float earthField = 0.5f;			// Gauss, starting guess of sphere radius
+constexpr float initialVariance = 10.0f;	// how little starting guess is trusted
+constexpr float forgetting = 0.998f;		// about 500 points of memory
+constexpr float maxTrace = 6.0f * initialVariance;	// forgetting stops here, see update()
+constexpr float maxVariance = 4.0f;			// of every coefficient for fit to be trusted, full turns give about 1
+constexpr float minSpacing = 0.02f;			// Gauss
+constexpr float minRadius = 0.1f;			// Gauss, fits outside of this are nonsense
+constexpr float maxRadius = 2.0f;
+
+// exponentially weighted mean and variance, variance summed over axes
+static float track(float * mean, const float x, const float y, const float z, float var, const float alpha)
+{
+	const float dx = x - mean[0];
+	const float dy = y - mean[1];
+	const float dz = z - mean[2];
+
+	mean[0] += alpha * dx;
+	mean[1] += alpha * dy;
+	mean[2] += alpha * dz;
+
+	return (1.0f - alpha) * (var + alpha * (dx * dx + dy * dy + dz * dz));
+}
+
+void GyroBias::reset()
+{
+	for (uint8_t i = 0; i < 3; ++i)
+	{
+		gyroMean[i] = 0.0f;
+		acelMean[i] = 0.0f;
+		offset[i] = 0.0f;
+	}
+
+	// start as moving, detector has to see quiet first
+	gyroVar = 1.0f;
+	acelVar = 1.0f;
+
+	stillCount = 0;
+	learned = 0;
+}
+
+void GyroBias::restore(const float * bias)
+{
+	for (uint8_t i = 0; i < 3; ++i)
+	{
+		offset[i] = bias[i];
+	}
+
+	stillCount = 0;
+}
+
+void GyroBias::acel(float x, float y, float z)
+{
+	acelVar = track(acelMean, x, y, z, acelVar, gyroAlpha);
+
+	if (acelVar > acelStillVar)
+	{
+		stillCount = 0;
+	}
+}
+
+void GyroBias::apply(float & x, float & y, float & z)
+{
+	gyroVar = track(gyroMean, x, y, z, gyroVar, gyroAlpha);
+
+	const bool quiet = gyroVar < gyroStillVar && acelVar < acelStillVar
+		&& fabsf(gyroMean[0]) < maxBias && fabsf(gyroMean[1]) < maxBias && fabsf(gyroMean[2]) < maxBias;
+
+	if (!quiet)
+	{
+		stillCount = 0;
+	}
+	else if (stillCount < stillSamples)
+	{
+		++stillCount;
+	}
+
+	if (still())
+	{
+		if (learned < biasWindow)
+		{
+			++learned;
+		}
+
+		// cumulative average until window is full, so first estimate comes quickly
+		const float k = 1.0f / learned;
+
+		offset[0] += k * (x - offset[0]);
+		offset[1] += k * (y - offset[1]);
+		offset[2] += k * (z - offset[2]);
+	}
+
+	x -= offset[0];
+	y -= offset[1];
+	z -= offset[2];
+}
+
+void MagnCalibration::reset()
+{
+	for (uint8_t i = 0; i < 6; ++i)
+	{
+		for (uint8_t j = 0; j < 6; ++j)
+		{
+			P[i][j] = i == j ? initialVariance : 0.0f;
+		}
+	}
+
+	// sphere around origin
+	theta[0] = theta[1] = theta[2] = 1.0f / (earthField * earthField);
+	theta[3] = theta[4] = theta[5] = 0.0f;
+
+	for (uint8_t i = 0; i < 3; ++i)
+	{
+		last[i] = 0.0f;
+		center[i] = 0.0f;
+		gain[i] = 1.0f;
+	}
+
+	points = 0;
+	ok = false;
+}
+
+void MagnCalibration::apply(float & x, float & y, float & z)
+{
+	const float gx = x * fitUnit;
+	const float gy = y * fitUnit;
+	const float gz = z * fitUnit;
+
+	const float dx = gx - last[0];
+	const float dy = gy - last[1];
+	const float dz = gz - last[2];
+
+	if (dx * dx + dy * dy + dz * dz >= minSpacing * minSpacing)
+	{
+		last[0] = gx;
+		last[1] = gy;
+		last[2] = gz;
+
+		update(gx, gy, gz);
+		solve();
+	}
+
+	if (ok)
+	{
+		x = (x - center[0]) * gain[0];
+		y = (y - center[1]) * gain[1];
+		z = (z - center[2]) * gain[2];
+	}
+}
+
+// One step of recursive least squares with target 1, about 150 multiplications and 2 divisions
+void MagnCalibration::update(float x, float y, float z)
+{
+	const float phi[6] = { x * x, y * y, z * z, x, y, z };
+
+	float Pphi[6];
+	float denominator = forgetting;
+	float error = 1.0f;
+
+	for (uint8_t i = 0; i < 6; ++i)
+	{
+		float sum = 0.0f;
+
+		for (uint8_t j = 0; j < 6; ++j)
+		{
+			sum += P[i][j] * phi[j];
+		}
+
+		Pphi[i] = sum;
+		denominator += phi[i] * sum;
+		error -= phi[i] * theta[i];
+	}
+
+	const float k = 1.0f / denominator;
+
+	for (uint8_t i = 0; i < 6; ++i)
+	{
+		theta[i] += Pphi[i] * k * error;
+	}
+
+	// P = (P - P*phi*phi'*P / denominator) / forgetting, upper triangle mirrored to stay symmetric
+	float trace = 0.0f;
+
+	for (uint8_t i = 0; i < 6; ++i)
+	{
+		for (uint8_t j = i; j < 6; ++j)
+		{
+			P[i][j] -= Pphi[i] * Pphi[j] * k;
+		}
+
+		trace += P[i][i];
+	}
+
+	// Readings that leave a direction out, e.g. turns about one axis only, would let forgetting grow P in it
+	// without bound until theta overflows. Trace is held at maxTrace instead, that direction just stays unknown.
+	const float f = trace * (1.0f / forgetting) < maxTrace ? 1.0f / forgetting : maxTrace / trace;
+
+	for (uint8_t i = 0; i < 6; ++i)
+	{
+		for (uint8_t j = i; j < 6; ++j)
+		{
+			P[i][j] *= f;
+			P[j][i] = P[i][j];
+		}
+	}
+
+	// should not happen any more, start over rather than stay stuck on NaN
+	if (!isfinite(trace) || !isfinite(theta[0] + theta[1] + theta[2] + theta[3] + theta[4] + theta[5]))
+	{
+		reset();
+		return;
+	}
+
+	if (points < minPoints)
+	{
+		++points;
+	}
+}
+
+void MagnCalibration::solve()
+{
+	if (points < minPoints || theta[0] <= 0.0f || theta[1] <= 0.0f || theta[2] <= 0.0f)
+	{
+		ok = false;
+		return;
+	}
+
+	// coefficient readings have not pinned down, e.g. scale and offset of z while board only turns about z
+	for (uint8_t i = 0; i < 6; ++i)
+	{
+		if (!(P[i][i] < maxVariance))
+		{
+			ok = false;
+			return;
+		}
+	}
+
+	float c[3], r[3];
+	float g = 1.0f;
+
+	for (uint8_t i = 0; i < 3; ++i)
+	{
+		c[i] = -theta[i + 3] / (2.0f * theta[i]);
+		g += theta[i] * c[i] * c[i];
+	}
+
+	for (uint8_t i = 0; i < 3; ++i)
+	{
+		r[i] = sqrtf(g / theta[i]);
+
+		if (!(r[i] > minRadius && r[i] < maxRadius))
+		{
+			ok = false;
+			return;
+		}
+	}
+
+	// keep mean radius, so corrected field still has sensible magnitude
+	const float mean = (r[0] + r[1] + r[2]) * (1.0f / 3.0f);
+
+	for (uint8_t i = 0; i < 3; ++i)
+	{
+		center[i] = c[i] / fitUnit;
+		gain[i] = mean / r[i];
+	}
+
+	ok = true;
+}
@@ -0,0 +1,83 @@
+#ifndef calibration_h_
+#define calibration_h_
+
+#include <stdint.h>
+
+// Online calibration, learns all the time from live readings, fixed memory and bounded work per sample.
+
+// Gyro zero rate offset, learned only while board is still.
+// Board is still when both gyro and accelerometer readings stay put for a while,
+// rotating at constant rate about vertical axis would look the same, so offsets beyond maxBias are never learned.
+class GyroBias
+{
+public:
+	GyroBias() { reset(); }
+
+	void reset();
+
+	// accelerometer reading in G, only used to detect motion
+	void acel(float x, float y, float z);
+
+	// gyro reading in rad/s, learn from it and remove bias in place
+	void apply(float & x, float & y, float & z);
+
+	bool still() const { return stillCount >= stillSamples; }
+
+	// start from known offset, e.g. one saved before gyro was powered down, board counts as moving
+	void restore(const float * bias);
+
+	// rad/s
+	const float * bias() const { return offset; }
+
+protected:
+	static constexpr uint16_t stillSamples = 50;	// quiet readings in row before learning starts
+
+	float gyroMean[3];
+	float gyroVar;		// summed over axes
+	float acelMean[3];
+	float acelVar;		// summed over axes
+
+	uint16_t stillCount;
+	uint16_t learned;	// readings averaged into offset so far, saturates
+
+	float offset[3];
+};
+
+// Magnetometer hard iron offset and soft iron scale of every axis.
+// Readings lie on ellipsoid a*x*x + b*y*y + c*z*z + d*x + e*y + f*z = 1 with axes along sensor axes,
+// recursive least squares fits the 6 coefficients, forgetting old points slowly.
+// Points closer than minSpacing to last used one are skipped, so board lying still does not wear the fit down.
+// Fit is used only once readings pinned down every coefficient, turns about one axis alone never get there.
+class MagnCalibration
+{
+public:
+	MagnCalibration() { reset(); }
+
+	void reset();
+
+	// reading in mGauss, learn from it and correct in place once fit is good
+	void apply(float & x, float & y, float & z);
+
+	bool valid() const { return ok; }
+
+	// mGauss, subtract first then multiply
+	const float * offset() const { return center; }
+	const float * scale() const { return gain; }
+
+protected:
+	void update(float x, float y, float z); // Gauss
+	void solve();
+
+	static constexpr uint16_t minPoints = 64;	// used points before first fit is trusted
+
+	float theta[6];	// a, b, c, d, e, f
+	float P[6][6];	// covariance, kept symmetric
+	float last[3];	// last used point, Gauss
+	uint16_t points;
+	bool ok;
+
+	float center[3];
+	float gain[3];
+};
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef cyclecount_h_
+#define cyclecount_h_
+
+#include <stdint.h>
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+#endif
+
+// Free running cycle counter for timing code, wraps around, so only differences make sense.
+// Cortex-M3/M4/M7 Teensy use DWT cycle counter, Teensy LC (M0+) has no counter and falls back to micros()
+// scaled to cycles. Hosts count nanoseconds, time stamp counter of x86 runs at a rate that differs between hosts.
+
+#if defined(ARM_DWT_CYCCNT)
+
+inline void cycleCounterStart()
+{
+	ARM_DEMCR |= ARM_DEMCR_TRCENA;
+	ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+}
+
+inline uint32_t cycles() { return ARM_DWT_CYCCNT; }
+
+constexpr uint32_t cyclesPerSecond = F_CPU;
+
+#elif defined(ARDUINO)
+
+inline void cycleCounterStart() {}
+
+inline uint32_t cycles() { return micros() * (F_CPU / 1000000); }
+
+constexpr uint32_t cyclesPerSecond = F_CPU;
+
+#else
+
+#include <time.h>
+
+// hosts count nanoseconds
+inline void cycleCounterStart() {}
+
+inline uint32_t cycles()
+{
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+
+	return uint32_t(t.tv_sec * 1000000000ull + t.tv_nsec);
+}
+
+constexpr uint32_t cyclesPerSecond = 1000000000;
+
+#endif
+
+#endif
@@ -0,0 +1,46 @@
+#include "decimate.h"
+
+#include <Arduino.h>
+#include <math.h>
+
+void firLowpass(float * h, uint8_t taps, float cutoff)
+{
+	const float middle = 0.5f * (taps - 1);
+	float sum = 0.0f;
+
+	for (uint8_t i = 0; i < taps; ++i)
+	{
+		const float t = i - middle;
+		const float sinc = t == 0.0f ? 2.0f * cutoff : sinf(2.0f * float(PI) * cutoff * t) / (float(PI) * t);
+		const float window = taps > 1 ? 0.54f - 0.46f * cosf(2.0f * float(PI) * i / (taps - 1)) : 1.0f;
+
+		h[i] = sinc * window;
+		sum += h[i];
+	}
+
+	for (uint8_t i = 0; i < taps; ++i)
+	{
+		h[i] /= sum;
+	}
+}
+
+void biquadLowpass(float * c, float cutoff, float q)
+{
+	// Bristow-Johnson, "Cookbook formulae for audio EQ biquad filter coefficients"
+	const float w = 2.0f * float(PI) * cutoff;
+	const float alpha = sinf(w) / (2.0f * q);
+	const float cw = cosf(w);
+	const float a0 = 1.0f + alpha;
+
+	c[0] = (1.0f - cw) * 0.5f / a0;
+	c[1] = (1.0f - cw) / a0;
+	c[2] = c[0];
+	c[3] = -2.0f * cw / a0;
+	c[4] = (1.0f - alpha) / a0;
+}
+
+float butterworthQ(uint8_t section, uint8_t sections)
+{
+	// pole pairs evenly spread on half circle
+	return 0.5f / cosf(float(PI) * (2 * section + 1) / (4 * sections));
+}
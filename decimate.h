@@ -0,0 +1,333 @@
+#ifndef decimate_h_
+#define decimate_h_
+
+#include <stdint.h>
+
+// Decimators to run sensors fast and the filter slow: anti-aliasing lowpass, then every R-th output is kept.
+// All are fixed size and allocate nothing. push() takes one input sample and returns true
+// when out holds a new output, once per R inputs. outputScale() turns outputs into input units.
+// restart() begins a new input stream after a gap, e.g. sensor woke up: next input stands for all
+// inputs before it and gives an output at once, so nothing from before the gap is mixed in.
+
+// lowpass designs for float coefficients, cutoff is fraction of input sample rate, below 0.5
+// windowed sinc with Hamming window, normalized to unity gain at DC
+void firLowpass(float * h, uint8_t taps, float cutoff);
+// b0, b1, b2, a1, a2 of second order section with quality q, a0 is normalized to 1
+void biquadLowpass(float * c, float cutoff, float q);
+// quality of section of Butterworth filter with given number of sections
+float butterworthQ(uint8_t section, uint8_t sections);
+
+// Three axis stage between sensor and filter, turns raw counts into fewer, filtered readings.
+// Return true when out holds new reading, in counts with fraction.
+typedef bool (*DecimationStage)(const int16_t * raw, float * out, void * context);
+// forget readings so far, see restart() of decimators
+typedef void (*DecimationRestart)(void * context);
+
+// Cascaded integrator comb, N stages, decimation by R, differential delay 1.
+// Integer only and no multiplies, response is sinc^N with zeros at multiples of output rate.
+// Gain is R^N, registers wrap around on purpose, comb stages undo the wrap as long as
+// output fits 32 bits, which is checked for 16 bit inputs.
+template <uint8_t R, uint8_t N = 3>
+class CicDecimator
+{
+	static_assert(R >= 2, "Decimation needs factor of two or more");
+	static_assert(N >= 1 && N <= 6, "CIC needs one to six stages");
+
+	static constexpr uint8_t bits(uint32_t x) { return x <= 1 ? 0 : 1 + bits((x + 1) / 2); }
+
+	static_assert(16 + N * bits(R) <= 32, "Register growth of 16 bit input overflows 32 bits");
+
+public:
+	typedef int32_t Sample;
+
+	static constexpr uint8_t factor = R;
+
+	static constexpr float gain() { return power(R, N); }
+	static constexpr float outputScale() { return 1.0f / gain(); }
+
+	void restart() { primed = false; }
+
+	bool push(int32_t in, int32_t & out)
+	{
+		if (!primed)
+		{
+			prime(in);
+		}
+
+		uint32_t v = uint32_t(in);
+
+		for (uint8_t i = 0; i < N; ++i)
+		{
+			v = integrator[i] += v;
+		}
+
+		if (++phase < R)
+		{
+			return false;
+		}
+
+		phase = 0;
+
+		for (uint8_t i = 0; i < N; ++i)
+		{
+			const uint32_t previous = comb[i];
+			comb[i] = v;
+			v -= previous;
+		}
+
+		out = int32_t(v);
+
+		return true;
+	}
+
+protected:
+	static constexpr float power(float x, uint8_t n) { return n == 0 ? 1.0f : x * power(x, n - 1); }
+
+	// registers as after constant input, comb last taken R - 1 inputs ago, so next input gives output
+	void prime(int32_t in)
+	{
+		primed = true;
+
+		for (uint8_t i = 0; i < N; ++i)
+		{
+			integrator[i] = comb[i] = 0;
+		}
+
+		phase = 0;
+
+		int32_t ignored;
+
+		for (uint16_t i = 0; i < (N + 1) * R - 1; ++i)
+		{
+			push(in, ignored);
+		}
+	}
+
+	uint32_t integrator[N] = {};
+	uint32_t comb[N] = {};
+	uint8_t phase = 0;
+	bool primed = true;
+};
+
+// Lowpass FIR of Taps coefficients, evaluated only for kept outputs, so it costs Taps / R
+// multiply-adds per input. T is float or Fixed<F> with F small enough for input range.
+template <typename T, uint8_t Taps, uint8_t R>
+class FirDecimator
+{
+	static_assert(R >= 2, "Decimation needs factor of two or more");
+	static_assert(Taps >= R, "Filter shorter than decimation factor does not stop aliasing");
+
+public:
+	typedef T Sample;
+
+	static constexpr uint8_t factor = R;
+
+	static constexpr float outputScale() { return 1.0f; }
+
+	// cutoff as fraction of input rate, default leaves a fifth of output band for transition
+	explicit FirDecimator(float cutoff = 0.4f / R)
+	{
+		float h[Taps];
+
+		firLowpass(h, Taps, cutoff);
+
+		for (uint8_t i = 0; i < Taps; ++i)
+		{
+			coefficients[i] = T(h[i]);
+		}
+	}
+
+	void restart() { primed = false; }
+
+	bool push(T in, T & out)
+	{
+		if (!primed)
+		{
+			// history as if input had been constant, output is due at once
+			for (T & h : history)
+			{
+				h = in;
+			}
+
+			phase = R - 1;
+			primed = true;
+		}
+
+		history[head] = in;
+		head = head + 1 < Taps ? head + 1 : 0;
+
+		if (++phase < R)
+		{
+			return false;
+		}
+
+		phase = 0;
+
+		// oldest sample is at head, coefficients are symmetric, so order does not matter
+		T sum = T();
+		uint8_t j = head;
+
+		for (uint8_t i = 0; i < Taps; ++i)
+		{
+			sum += coefficients[i] * history[j];
+			j = j + 1 < Taps ? j + 1 : 0;
+		}
+
+		out = sum;
+
+		return true;
+	}
+
+protected:
+	T coefficients[Taps];
+	T history[Taps] = {};
+	uint8_t head = 0;
+	uint8_t phase = 0;
+	bool primed = true;
+};
+
+// Butterworth lowpass of order 2 * Sections as cascade of biquads, transposed direct form II.
+// Recursive, so it runs on every input, but few sections give a steep edge.
+// T is float or Fixed<F>, fixed point needs cutoff not too far below input rate to keep poles apart.
+template <typename T, uint8_t Sections, uint8_t R>
+class BiquadDecimator
+{
+	static_assert(R >= 2, "Decimation needs factor of two or more");
+	static_assert(Sections >= 1, "Needs at least one section");
+
+public:
+	typedef T Sample;
+
+	static constexpr uint8_t factor = R;
+
+	static constexpr float outputScale() { return 1.0f; }
+
+	explicit BiquadDecimator(float cutoff = 0.4f / R)
+	{
+		for (uint8_t s = 0; s < Sections; ++s)
+		{
+			float c[5];
+
+			biquadLowpass(c, cutoff, butterworthQ(s, Sections));
+
+			for (uint8_t i = 0; i < 5; ++i)
+			{
+				section[s].c[i] = T(c[i]);
+			}
+		}
+	}
+
+	void restart() { primed = false; }
+
+	bool push(T in, T & out)
+	{
+		if (!primed)
+		{
+			// sections settled on constant input, each has unity gain at DC
+			for (Section & s : section)
+			{
+				s.z[0] = in - s.c[0] * in;
+				s.z[1] = s.c[2] * in - s.c[4] * in;
+			}
+
+			phase = R - 1;
+			primed = true;
+		}
+
+		T v = in;
+
+		for (Section & s : section)
+		{
+			const T y = s.c[0] * v + s.z[0];
+
+			s.z[0] = s.c[1] * v - s.c[3] * y + s.z[1];
+			s.z[1] = s.c[2] * v - s.c[4] * y;
+
+			v = y;
+		}
+
+		if (++phase < R)
+		{
+			return false;
+		}
+
+		phase = 0;
+		out = v;
+
+		return true;
+	}
+
+protected:
+	struct Section
+	{
+		T c[5];		// b0, b1, b2, a1, a2
+		T z[2] = {};
+	};
+
+	Section section[Sections];
+	uint8_t phase = 0;
+	bool primed = true;
+};
+
+// Three axes of one sensor, see Gy80Base::setDecimation().
+// Takes raw counts, gives counts with fraction at decimated rate.
+template <class D>
+class Decimate3
+{
+public:
+	Decimate3() = default;
+
+	// same arguments for every axis, e.g. cutoff
+	template <typename... Args>
+	explicit Decimate3(Args... args) : axis { D(args...), D(args...), D(args...) } {}
+
+	static constexpr uint8_t factor = D::factor;
+
+	bool push(const int16_t * raw, float * out)
+	{
+		typename D::Sample y[3];
+		bool ready = false;
+
+		// axes are always in step, all of them have output at once
+		for (uint8_t i = 0; i < 3; ++i)
+		{
+			ready = axis[i].push(typename D::Sample(raw[i]), y[i]);
+		}
+
+		if (!ready)
+		{
+			return false;
+		}
+
+		for (uint8_t i = 0; i < 3; ++i)
+		{
+			out[i] = float(y[i]) * D::outputScale();
+		}
+
+		return true;
+	}
+
+	void restart()
+	{
+		for (D & a : axis)
+		{
+			a.restart();
+		}
+	}
+
+	// fits DecimationStage and DecimationRestart, context is the Decimate3 itself
+	static bool stage(const int16_t * raw, float * out, void * context)
+	{
+		return static_cast<Decimate3 *>(context)->push(raw, out);
+	}
+
+	static void restartStage(void * context)
+	{
+		static_cast<Decimate3 *>(context)->restart();
+	}
+
+protected:
+	D axis[3];
+};
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef drdy_h_
+#define drdy_h_
+
+#include <stdint.h>
+
+#include "spscring.h"
+#include "rawlog.h"
+
+// sensor said it has data at given micros()
+struct DrdyEvent
+{
+	uint32_t time;
+	RawSensor sensor;
+	uint16_t edge; // number of edge of this sensor, wraps around
+};
+
+// Data ready edges queued from interrupt handlers for main loop.
+// Nothing here touches hardware, so a host harness can drive it with simulated edges.
+class DataReadyEvents
+{
+public:
+	DataReadyEvents() = default;
+
+	DataReadyEvents (const DataReadyEvents &) = delete;
+	DataReadyEvents & operator = (const DataReadyEvents &) = delete;
+
+	// interrupt side, timestamp is taken by caller as close to the edge as possible
+	void signal(RawSensor sensor, uint32_t time)
+	{
+		const uint16_t edge = edges[sensor].load(std::memory_order_relaxed) + 1;
+
+		edges[sensor].store(edge, std::memory_order_relaxed);
+		ring.push(DrdyEvent { time, sensor, edge });
+	}
+
+	// main loop side, return false when there are no more events
+	bool next(DrdyEvent & event) { return ring.pop(event); }
+
+	// Edges of sensor signalled so far. Taken just before reading sensor, it marks events that read answers:
+	// sample of such edge was in data registers already, so the read got it or a newer one.
+	uint16_t edgeCount(RawSensor sensor) const { return edges[sensor].load(std::memory_order_relaxed); }
+
+	// true if read that took edgeCount() as answered covers event
+	static bool answered(const DrdyEvent & event, uint16_t answeredEdge) { return int16_t(event.edge - answeredEdge) <= 0; }
+
+	// edges lost because main loop did not keep up
+	uint32_t lost() const { return ring.overflows(); }
+
+protected:
+	// a few milliseconds worth of edges at full rate of all three sensors
+	SpscRing<DrdyEvent, 32> ring;
+
+	std::atomic<uint16_t> edges[3] { { 0 }, { 0 }, { 0 } }; // indexed by RawSensor, written by interrupt side only
+};
+
+#endif
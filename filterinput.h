@@ -3,9 +3,12 @@
 
 #include "imudata.h"
 
-struct FilterInput : ImuData
+template <typename T>
+struct FilterInputT : ImuDataT<T>
 {
-	float deltaT;
+	T deltaT;
 };
 
+typedef FilterInputT<float> FilterInput;
+
 #endif
@@ -0,0 +1,78 @@
+#ifndef fixed_h_
+#define fixed_h_
+
+#include <stdint.h>
+
+// signed fixed point number with F fraction bits in 32 bits, e.g. Fixed<24> is Q7.24
+// products and quotients go through 64 bits, nothing checks for overflow
+template <uint8_t F>
+struct Fixed
+{
+	static constexpr int32_t one = int32_t(1) << F;
+
+	constexpr Fixed() : raw(0) {}
+	constexpr Fixed(float f) : raw(int32_t(f * float(one) + (f < 0.0f ? -0.5f : 0.5f))) {}
+
+	static constexpr Fixed fromRaw(int32_t r) { Fixed x; x.raw = r; return x; }
+
+	explicit constexpr operator float() const { return float(raw) / float(one); }
+
+	friend constexpr Fixed operator + (Fixed a, Fixed b) { return fromRaw(a.raw + b.raw); }
+	friend constexpr Fixed operator - (Fixed a, Fixed b) { return fromRaw(a.raw - b.raw); }
+	friend constexpr Fixed operator * (Fixed a, Fixed b) { return fromRaw(int32_t((int64_t(a.raw) * b.raw) >> F)); }
+	friend constexpr Fixed operator / (Fixed a, Fixed b) { return fromRaw(int32_t((int64_t(a.raw) * one) / b.raw)); }
+
+	constexpr Fixed operator - () const { return fromRaw(-raw); }
+
+	Fixed & operator += (Fixed b) { raw += b.raw; return *this; }
+	Fixed & operator -= (Fixed b) { raw -= b.raw; return *this; }
+	Fixed & operator *= (Fixed b) { return *this = *this * b; }
+
+	friend constexpr bool operator <  (Fixed a, Fixed b) { return a.raw <  b.raw; }
+	friend constexpr bool operator >  (Fixed a, Fixed b) { return a.raw >  b.raw; }
+	friend constexpr bool operator == (Fixed a, Fixed b) { return a.raw == b.raw; }
+
+	int32_t raw;
+};
+
+// integer square root, rounded down
+inline uint32_t isqrt(uint64_t x)
+{
+	uint64_t result = 0;
+	uint64_t bit = uint64_t(1) << 62;
+
+	while (bit > x)
+	{
+		bit >>= 2;
+	}
+
+	while (bit != 0)
+	{
+		if (x >= result + bit)
+		{
+			x -= result + bit;
+			result = (result >> 1) + bit;
+		}
+		else
+		{
+			result >>= 1;
+		}
+
+		bit >>= 2;
+	}
+
+	return uint32_t(result);
+}
+
+template <uint8_t F>
+Fixed<F> sqrt(Fixed<F> x)
+{
+	if (x.raw <= 0)
+	{
+		return Fixed<F>();
+	}
+
+	return Fixed<F>::fromRaw(int32_t(isqrt(uint64_t(x.raw) << F)));
+}
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef fusion_h_
+#define fusion_h_
+
+#include "madgwick.h"
+#include "mahony.h"
+#include "mekf.h"
+
+// Fusion engine is the filter FusionScheduler runs. Engines share no base class, the one picked
+// for the build is a member of the scheduler, so calls are direct and nothing is virtual.
+// Engine over scalar type T has
+//	void reset();	forget everything learned, caller resets orientation
+//	void predict(QuartT<T> & quart, FilterInputT<T> input);	integrate gyro over deltaT
+//	void correct(QuartT<T> & quart, FilterInputT<T> input, bool magnFresh);	accelerometer and magnetometer, deltaT since previous correction
+//	void correctGravity(QuartT<T> & quart, FilterInputT<T> input);	accelerometer only, while there is no magnetometer reading
+//
+// MadgwickEngineT	gradient descent step with fixed gain, cheapest
+// MahonyEngineT	complementary filter, integral feedback learns gyro bias
+// MekfEngineT		Kalman filter of attitude error and gyro bias, weighs sensors by their noise, costs most
+
+// scalar type Gy80 runs the filter in, GY80_FIXED_POINT selects fixed point for cores without FPU
+#if defined(GY80_FIXED_POINT)
+typedef Fixed<24> FusionScalar;
+#else
+typedef float FusionScalar;
+#endif
+
+// engine Gy80 runs, GY80_FUSION_MAHONY or GY80_FUSION_MEKF replace Madgwick
+#if defined(GY80_FUSION_MEKF)
+#if defined(GY80_FIXED_POINT)
+#error "GY80_FUSION_MEKF needs floating point, covariance does not fit Fixed<24>"
+#endif
+typedef MekfEngineT<FusionScalar> FusionEngine;
+#elif defined(GY80_FUSION_MAHONY)
+typedef MahonyEngineT<FusionScalar> FusionEngine;
+#else
+typedef MadgwickEngineT<FusionScalar> FusionEngine;
+#endif
+
+#endif
@@ -1,117 +1,495 @@
 #include "gy-80.h"
 
-#include <i2c_t3.h>
+void Gy80Base::begin()
+{
+	bus.begin();
+
+	fusion.reset(micros());
 
-#include "madgwick.h"
+#if defined(GY80_PROFILE) || defined(GY80_METRICS)
+	cycleCounterStart();
+#endif
+}
 
-int Gy80::init()
+#if defined(GY80_METRICS)
+MetricsSnapshot Gy80Base::metrics()
 {
-	/*
-	We have disabled the internal pull-ups used by the Wire library in the Wire.h/twi.c utility file.
-	We are also using the 400 kHz fast I2C mode by setting the TWI_FREQ to 400000L /twi.h utility file.
-	The Teensy has no internal pullups and we are using the Wire.begin function of the i2c_t3.h library
-	to select 400 Hz i2c speed.
-	*/
+	MetricsSnapshot snapshot;
 
-	Wire.begin(I2C_MASTER, 0x00, I2C_PINS_18_19, I2C_PULLUP_EXT, I2C_RATE_400);
-	//delay(4000);
+	snapshot.sense = senseMetrics;
+	snapshot.bus = bus.metrics();
 
-	lastUpdate = micros();
+	return snapshot;
+}
 
-	quart.q1() = 1.0f;
-	quart.q2() = 0.0f;
-	quart.q3() = 0.0f;
-	quart.q4() = 0.0f;
+void Gy80Base::clearMetrics()
+{
+	senseMetrics.clear();
+	bus.metrics().clear();
+}
+#endif
 
-	if (acel.init() != 0)
-		return -1;
+int Gy80Base::setLog(RawLogWriter * writer)
+{
+	logWriter = writer;
 
-	if (gyro.init() != 0)
-		return -2;
-	
-	if (magn.init() != 0)
-		return -3;
+	if (logWriter == nullptr)
+	{
+		return 0;
+	}
+
+	return logWriter->begin(res[RAW_ACEL], res[RAW_GYRO], res[RAW_MAGN]);
+}
+
+void Gy80Base::setDecimation(RawSensor sensor, DecimationStage stage, void * context, DecimationRestart restart)
+{
+	decimation[sensor] = stage;
+	decimationRestart[sensor] = restart;
+	decimationContext[sensor] = context;
+}
+
+void Gy80Base::restartDecimation()
+{
+	// gyro and magnetometer were off and accelerometer ran at 8 Hz, readings before sleep do not belong to new ones
+	for (uint8_t s = 0; s < 3; ++s)
+	{
+		if (decimationRestart[s] != nullptr)
+		{
+			decimationRestart[s](decimationContext[s]);
+		}
+	}
+}
+
+bool Gy80Base::barometer(float & temperature, float & pressure, float & altitude) const
+{
+	temperature = baro[0];
+	pressure = baro[1];
+	altitude = baro[2];
+
+	return baroValid;
+}
+
+void Gy80Base::record(RawSensor sensor, uint32_t time, const int16_t * raw)
+{
+	if (logWriter != nullptr)
+	{
+		logWriter->write(sensor, time, raw);
+	}
+}
+
+// interrupt handlers have no object, so they go to the one board that asked for them
+static DataReadyEvents * interruptEvents = nullptr;
+
+static void acelReady() { interruptEvents->signal(RAW_ACEL, micros()); }
+static void gyroReady() { interruptEvents->signal(RAW_GYRO, micros()); }
+static void magnReady() { interruptEvents->signal(RAW_MAGN, micros()); }
+
+void Gy80Base::attachInterrupts(uint8_t acelPin, uint8_t gyroPin, uint8_t magnPin)
+{
+	pins[RAW_ACEL] = acelPin;
+	pins[RAW_GYRO] = gyroPin;
+	pins[RAW_MAGN] = magnPin;
+
+	interruptEvents = &events;
+
+	answeredEdge[RAW_ACEL] = events.edgeCount(RAW_ACEL);
+	answeredEdge[RAW_GYRO] = events.edgeCount(RAW_GYRO);
+	answeredEdge[RAW_MAGN] = events.edgeCount(RAW_MAGN);
+
+	pinMode(acelPin, INPUT);
+	pinMode(gyroPin, INPUT);
+	pinMode(magnPin, INPUT);
+
+	attachInterrupt(digitalPinToInterrupt(acelPin), acelReady, RISING);
+	attachInterrupt(digitalPinToInterrupt(gyroPin), gyroReady, RISING);
+	attachInterrupt(digitalPinToInterrupt(magnPin), magnReady, FALLING);	// DRDY is active low
+
+	interruptDriven = true;
+}
+
+bool Gy80Base::take(RawSensor sensor, uint32_t time, const int16_t * raw)
+{
+	// readings come in board frame, sensor types turn them by their mounting, see mounting.h
+
+	// log keeps readings as they came, before calibration
+	record(sensor, time, raw);
+
+	float counts[3] { float(raw[0]), float(raw[1]), float(raw[2]) };
+
+	// sensor running faster than filter gives output only every few readings
+	if (decimation[sensor] != nullptr && !decimation[sensor](raw, counts, decimationContext[sensor]))
+	{
+		return false;
+	}
+
+	switch (sensor)
+	{
+	case RAW_ACEL:
+		{
+			const float r = res[RAW_ACEL];
+			float x = counts[0] * r, y = counts[1] * r, z = counts[2] * r; //G
+
+			{
+				GY80_PROFILE_SCOPE(profiler, PROFILE_CALIBRATION);
+				gyroCal.acel(x, y, z);
+			}
+
+			fusion.acel(time, x, y, z);
+
+			acelLatest[0] = x;
+			acelLatest[1] = y;
+			acelLatest[2] = z;
+		}
+		return false;
+
+	case RAW_MAGN:
+		{
+			const float r = res[RAW_MAGN];
+			float x = counts[0] * r, y = counts[1] * r, z = counts[2] * r; //mGauss
+
+			{
+				GY80_PROFILE_SCOPE(profiler, PROFILE_CALIBRATION);
+				magnCal.apply(x, y, z);
+			}
+
+			fusion.magn(time, x, y, z);
+		}
+		return false;
+
+	case RAW_GYRO:
+		{
+			// first reading after sensors woke up, filter goes on from where it stopped
+			if (gate.state() == MOTION_WAKING)
+			{
+				gate.gyroSample(time);
+				fusion.resume(time);
+			}
+
+			const float r = res[RAW_GYRO];
+			float x = counts[0] * r, y = counts[1] * r, z = counts[2] * r; //rad/s
+
+			{
+				GY80_PROFILE_SCOPE(profiler, PROFILE_CALIBRATION);
+				gyroCal.apply(x, y, z);
+			}
+
+#if defined(GY80_METRICS)
+			if (senseMetrics.gyroSeen)
+			{
+				// intervals near sample period all fall into one power of two bucket of deltaT, their changes do not
+				const uint32_t interval = time - senseMetrics.lastGyro;
+
+				if (senseMetrics.deltaT.count > 0)
+				{
+					const uint32_t last = senseMetrics.lastInterval;
+					senseMetrics.jitter.add(interval > last ? interval - last : last - interval);
+				}
+
+				senseMetrics.deltaT.add(interval);
+				senseMetrics.lastInterval = interval;
+			}
+
+			senseMetrics.lastGyro = time;
+			senseMetrics.gyroSeen = true;
+
+			const uint32_t filterStart = cycles();
+#endif
+
+			{
+				GY80_PROFILE_SCOPE(profiler, PROFILE_FILTER);
+
+				fusion.gyro(time, x, y, z);
+			}
+
+			GY80_METRIC(senseMetrics.filter.add(cycles() - filterStart));
+		}
+		return true;
+	}
+
+	return false;
+}
+
+void Gy80Base::senseBarometer()
+{
+	// barometer converts in background, this only collects result and starts next conversion
+	if (pres.measure(baro[0], baro[1], baro[2]) == 0)
+	{
+		baroValid = true;
+	}
+}
+
+Orientation Gy80Base::orientation(bool updated)
+{
+	if (!updated)
+	{
+		return Orientation();
+	}
+
+	GY80_PROFILE_SCOPE(profiler, PROFILE_EULER);
+
+	QuartT<FusionScalar> & quart = fusion.quart();
+
+	Quart q;
+	q.q1() = float(quart.q1());
+	q.q2() = float(quart.q2());
+	q.q3() = float(quart.q3());
+	q.q4() = float(quart.q4());
+
+	return Orientation(q, acelLatest, declination);
+}
+
+void Gy80Base::statusDone(I2cTransaction & t)
+{
+	Pending & p = *static_cast<Pending *>(t.context);
+
+	if (t.status == XFER_DONE && p.ready(p.statusByte))
+	{
+		p.dataQueued = p.bus->submit(p.data) == 0;
+	}
+}
+
+#if defined(GY80_PIPELINE)
+void Gy80Base::pipelineStatusDone(I2cTransaction & t)
+{
+	Pending & p = *static_cast<Pending *>(t.context);
+
+	++p.polls;
+
+	if (!p.continuous)
+	{
+		return;
+	}
+
+	// failed read goes on polling too, engine has already retried it,
+	// data goes ahead of others, e.g. barometer read, so reading is no older than it has to be
+	if (t.status == XFER_DONE && p.ready(p.statusByte))
+	{
+		p.bus->submitFirst(p.data);
+	}
+	else
+	{
+		p.bus->submit(p.next()->status);
+	}
+}
 
-	if (pres.init() != 0)
-		return -4;
+void Gy80Base::pipelineDataDone(I2cTransaction & t)
+{
+	Pending & p = *static_cast<Pending *>(t.context);
 
-	return 0;
+	// newer reading replaces one filter has not taken yet
+	if (t.status == XFER_DONE)
+	{
+		memcpy(p.freshData, p.rawData, sizeof(p.rawData));
+		p.freshTime = micros();
+		p.fresh = true;
+	}
+
+	if (p.continuous)
+	{
+		p.bus->submit(p.next()->status);
+	}
 }
 
-ImuData Gy80::sense()
+bool Gy80Base::anyFresh() const
 {
-	FilterInput filterInput;
+	for (const Pending & p : pending)
+	{
+		if (p.fresh)
+		{
+			return true;
+		}
+	}
 
-	const uint32_t now = micros();
-	filterInput.deltaT = (float(now - lastUpdate) / 1000000.0f); // set integration time by time elapsed since last filter update
-	lastUpdate = now;
+	return false;
+}
 
-	int a = acel.measure(filterInput.ax(), filterInput.ay(), filterInput.az()); //m/s^2
-	int g = gyro.measure(filterInput.gx(), filterInput.gy(), filterInput.gz()); //rad/s/s
-	int m = magn.measure(filterInput.mx(), filterInput.my(), filterInput.mz()); //mGauss
+bool Gy80Base::takeFresh(bool yield)
+{
+	bool updated = false;
 
-	ImuData error;
-	error.ok() = true;
+	// same order as sensePolled(), gyro last so fresh readings go into its filter step
+	static const RawSensor order[3] { RAW_ACEL, RAW_MAGN, RAW_GYRO };
 
-	if (a < 0)
+	for (const RawSensor sensor : order)
 	{
-		error.ok() = false;
+		// with completion interrupt this only checks timeouts, on a polled bus next phase or transaction
+		// needs a call, so there bus waits for one sensor's worth of math at most
+		if (yield)
+		{
+			bus.service();
+		}
+
+		Pending & p = pending[sensor];
+
+		if (!p.fresh)
+		{
+			continue;
+		}
+
+		// completion interrupt may bring newer reading meanwhile
+		int16_t raw[3];
+
+		noInterrupts();
+		p.unpack(p.freshData, raw);
+		const uint32_t time = p.freshTime;
+		p.fresh = false;
+		interrupts();
+
+		if (take(sensor, time, raw))
+		{
+			updated = true;
+		}
 	}
-	
-	if (g < 0)
+
+	return updated;
+}
+
+Orientation Gy80Base::sensePipelined()
+{
+	if (!pipelined)
 	{
-		error.ok() = false;
+		// gyro every other poll, accelerometer and magnetometer by turns in between,
+		// so a gyro sample waits for reads of one other sensor at most
+		pending[RAW_ACEL].following = &pending[RAW_GYRO];
+		pending[RAW_MAGN].following = &pending[RAW_GYRO];
+		pending[RAW_GYRO].following = &pending[RAW_MAGN];
+		pending[RAW_ACEL].alternate = nullptr;
+		pending[RAW_MAGN].alternate = nullptr;
+		pending[RAW_GYRO].alternate = &pending[RAW_ACEL];
+
+		for (Pending & p : pending)
+		{
+			p.status.callback = pipelineStatusDone;
+			p.data.callback = pipelineDataDone;
+			p.data.context = &p;
+			p.fresh = false;
+			p.continuous = true;
+		}
+
+		// chain goes on from completion interrupt while filter works, polled bus only moves in service()
+		bus.useCompletionInterrupt();
+		bus.submit(pending[RAW_ACEL].status);
+		pipelined = true;
 	}
-	
-	if (m < 0)
+
+	// barometer reads block, readings that are there already go first
+	if (!anyFresh())
 	{
-		error.ok() = false;
+		senseBarometer();
 	}
-	
-	if (!error.ok())
+
+	// Filter readings as they come until gyro reading went into filter. Like sense(), give up
+	// when gyro status was read after this call began and there was nothing.
+	const uint8_t polls = pending[RAW_GYRO].polls;
+
+	bool updated = false;
+
+	while (!updated && uint8_t(pending[RAW_GYRO].polls - polls) < 2)
 	{
-		return error;
+		updated = takeFresh(true);
 	}
-	
-	//if not ready then make NaNs, code in filter will skip correction
-	if (m < 0)
+
+	return orientation(updated);
+}
+
+Orientation Gy80Base::stopPipeline()
+{
+	if (!pipelined)
 	{
-		filterInput.mx() = nan("");
-		filterInput.my() = nan("");
-		filterInput.mz() = nan("");
+		return Orientation();
 	}
-	
-	//TODO rotate values to match directions
-	//TODO apply magnetometer bias
-	
-	MadgwickQuaternionUpdate(quart, filterInput);
 
-	// Define output variables from updated quaternion---these are Tait-Bryan angles, commonly used in aircraft orientation.
-	// In this coordinate system, the positive z-axis is down toward Earth. 
-	// Yaw is the angle between Sensor x-axis and Earth magnetic North (or true North if corrected for local declination, looking down on the sensor positive yaw is counterclockwise.
-	// Pitch is angle between sensor x-axis and Earth ground plane, toward the Earth is positive, up toward the sky is negative.
-	// Roll is angle between sensor y-axis and Earth ground plane, y-axis up is positive roll.
-	// These arise from the definition of the homogeneous rotation matrix constructed from quaternions.
-	// Tait-Bryan angles as well as Euler angles are non-commutative; that is, the get the correct orientation the rotations must be
-	// applied in the correct order which for this configuration is yaw, pitch, and then roll.
-	// For more see http://en.wikipedia.org/wiki/Conversion_between_quaternions_and_Euler_angles which has additional links.
+	for (Pending & p : pending)
+	{
+		p.continuous = false;
+	}
+
+	while (!bus.idle())
+	{
+		bus.service();
+	}
+
+	for (Pending & p : pending)
+	{
+		p.status.callback = statusDone;
+		p.data.callback = nullptr;
+	}
+
+	pipelined = false;
+
+	return orientation(takeFresh(false));
+}
+#endif
+
+int Gy80Base::pendingResult(const Pending & p)
+{
+	if (p.status.status != XFER_DONE)
+	{
+		return -2;
+	}
+
+	if (!p.dataQueued)
+	{
+		return -1;
+	}
+
+	return p.data.status == XFER_DONE ? 0 : -2;
+}
+
+void Gy80Base::startSense()
+{
+	pendingTime = micros();
+
+	for (Pending & p : pending)
+	{
+		p.dataQueued = false;
+
+		bus.submit(p.status);
+	}
+}
+
+bool Gy80Base::senseReady() const
+{
+	for (const Pending & p : pending)
+	{
+		if (!p.status.finished() || (p.dataQueued && !p.data.finished()))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+Orientation Gy80Base::finishSense()
+{
+	senseBarometer();
+
+	bool updated = false;
+
+	// same order as sensePolled(), gyro last so fresh readings go into its filter step
+	static const RawSensor order[3] { RAW_ACEL, RAW_MAGN, RAW_GYRO };
+
+	for (const RawSensor sensor : order)
+	{
+		const Pending & p = pending[sensor];
+		const int result = pendingResult(p);
+
+		if (result == 0)
+		{
+			int16_t raw[3];
+			p.unpack(p.rawData, raw);
+
+			if (take(sensor, pendingTime, raw))
+			{
+				updated = true;
+			}
+		}
+		else if (result == -1)
+		{
+			GY80_METRIC(++senseMetrics.notReady[sensor]);
+		}
+	}
 
-	float pitch, yaw, roll;
-	
-	yaw   = atan2(2.0f * (quart.q2() * quart.q3() + quart.q1() * quart.q4()), quart.q1() * quart.q1() + quart.q2() * quart.q2() - quart.q3() * quart.q3() - quart.q4() * quart.q4());   
-	pitch = -asin(2.0f * (quart.q2() * quart.q4() - quart.q1() * quart.q3()));
-	roll  = atan2(2.0f * (quart.q1() * quart.q2() + quart.q3() * quart.q4()), quart.q1() * quart.q1() - quart.q2() * quart.q2() - quart.q3() * quart.q3() + quart.q4() * quart.q4());
-	pitch *= 180.0f / PI;
-	yaw   *= 180.0f / PI; 
-	yaw   -= 10.0f; // Declination at Danville, California is 13 degrees 48 minutes and 47 seconds on 2014-04-04
-	roll  *= 180.0f / PI;
-	
-	ImuData result;
-	result.ok() = true;
-	
-	result.ax() = yaw;
-	result.ay() = pitch;
-	result.az() = roll;
-	
-	return result;
+	return orientation(updated);
 }
@@ -4,32 +4,456 @@
 #include <Arduino.h>
 
 #include "quart.h"
-#include "imudata.h"
+#include "orientation.h"
+#include "scheduler.h"
+#include "rawlog.h"
+#include "drdy.h"
+#include "profile.h"
+#include "metrics.h"
+#include "calibration.h"
+#include "decimate.h"
+#include "motiongate.h"
 
 #include "ADXL345.h"
 #include "L3G4200D.h"
 #include "HMC5883L.h"
 #include "BMP085.h"
 
-class Gy80
+// Everything of one board that does not depend on sensor types or configuration, see Gy80T for the board itself.
+// Boards of any configuration can be handled through this, e.g. by Gy80Group.
+class Gy80Base
 {
 public:
-	Gy80() = default;
+	Gy80Base (const Gy80Base &) = delete;
+	Gy80Base & operator = (const Gy80Base &) = delete;
 
-	Gy80 (const Gy80 &) = delete;
-	Gy80 & operator = (const Gy80 &) = delete;
+	// Polled sense in halves, so boards on different buses transfer at the same time, see Gy80Group.
+	// startSense() queues status reads, service engine() until senseReady(), then finishSense() filters.
+	// Not for use with interrupts, call after init().
+	void startSense();
+	bool senseReady() const;
+	Orientation finishSense();
 
-	int init();
-	ImuData sense();
+#if defined(GY80_PIPELINE)
+	// Pipelined sense, bus keeps reading while filter works. Transaction callbacks chain the reads, gyro status
+	// every other time and accelerometer and magnetometer status by turns in between, each followed by data read
+	// if there is data. First call turns on completion interrupt of engine(), so the chain goes on from there
+	// during filter math. Each call filters readings as they arrive until gyro reading advanced the filter.
+	// Transaction callbacks then run in interrupt context, for sense() too, see I2cEngine::useCompletionInterrupt().
+	// Not for use with data ready interrupts or motion gate, call stopPipeline() before going back to sense()
+	// or startSense(). On a bus without completion interrupt it falls back to polling and gains nothing.
+	// test/pipelinebench, gyro at 800 Hz, latency from gyro sample to orientation, at 400 kHz:
+	//   filter  30 us  sense()  490 us, pipelined  429 us
+	//   filter 150 us  sense()  619 us, pipelined  543 us
+	//   filter 400 us  sense()  946 us, pipelined  804 us
+	//   filter 600 us  sense() 1274 us and 684 steps/s, 214 gyro samples lost in 2 s,
+	//                  pipelined 1022 us and all 791 steps/s, none lost
+	// at 1 MHz, filter 30 us 213 us against 185 us, 800 us 990 us against 963 us.
+	// Costs bus time, chain keeps bus about 92% busy at 400 kHz against 62..89% for sense().
+	Orientation sensePipelined();
+	// let reads in flight finish and filter readings not taken yet
+	Orientation stopPipeline();
+#endif
+
+	I2cEngine & engine() { return bus; }
+
+#if defined(GY80_PROFILE)
+	// cycles spent in stages of sense(), see Profiler::report() for machine readable dump
+	Profiler & profile() { return profiler; }
+#endif
+
+#if defined(GY80_METRICS)
+	// counters and histograms since init() or last clearMetrics()
+	MetricsSnapshot metrics();
+	void clearMetrics();
+#endif
+
+	// magnetic declination in degrees, subtracted from yaw so it points to true North
+	void setDeclination(float degrees) { declination = degrees; }
+
+	// minimal time between accelerometer/magnetometer corrections, 0 corrects on every fresh reading
+	void setCorrectionInterval(uint32_t micros) { fusion.setCorrectionInterval(micros); }
+
+	// Filter and thin out readings of sensor before calibration and fusion, e.g. gyro at 800 Hz into filter
+	// at 100 Hz through Decimate3<FirDecimator<float, 32, 8>>. Output gets time of latest input, filter delay
+	// is not accounted for. Stage must outlive board, nullptr passes every reading on.
+	// restart is called when sensors wake up, so filter does not mix readings from before sleep, may be nullptr.
+	void setDecimation(RawSensor sensor, DecimationStage stage, void * context, DecimationRestart restart = nullptr);
+
+	template <class D>
+	void setDecimation(RawSensor sensor, Decimate3<D> * decimate) { setDecimation(sensor, Decimate3<D>::stage, decimate, Decimate3<D>::restartStage); }
+
+	// record every raw reading to writer, nullptr stops recording, return result of writing log header
+	int setLog(RawLogWriter * writer);
+
+	// online calibration applied to every reading, learned continuously
+	GyroBias & gyroBias() { return gyroCal; }
+	MagnCalibration & magnCalibration() { return magnCal; }
+
+	// latest barometer reading, temperature in C, pressure in Pa, altitude in m
+	// return false until first reading arrives
+	bool barometer(float & temperature, float & pressure, float & altitude) const;
+
+	// sleep state and wake latency, see Gy80T::initMotionGate()
+	const MotionGate & motionGate() const { return gate; }
+
+protected:
+	// resolutions of raw readings, barometer belongs to derived class and is only referred to here
+	Gy80Base(I2cEngine & bus, float acelRes, float gyroRes, float magnRes, BMP085Base & pres) :
+		bus(bus), res { acelRes, gyroRes, magnRes }, pres(pres) {}
+
+	// start bus and filter, before sensors are set up
+	void begin();
+
+	// route data ready pins to events, sensors must drive them already
+	void attachInterrupts(uint8_t acelPin, uint8_t gyroPin, uint8_t magnPin);
+
+	void record(RawSensor sensor, uint32_t time, const int16_t * raw);
+
+	// pass reading to log and filter, return true if filter advanced
+	bool take(RawSensor sensor, uint32_t time, const int16_t * raw);
+
+	void senseBarometer();
+	Orientation orientation(bool updated);
+
+	// polled read of one sensor as two transactions, data read is queued by status callback if there is data
+	struct Pending
+	{
+		I2cTransaction status;
+		I2cTransaction data;
+		uint8_t statusByte;
+		uint8_t rawData[6];
+		bool dataQueued;
+
+#if defined(GY80_PIPELINE)
+		// pipelined sense, newest reading not taken yet and time it arrived
+		uint8_t freshData[6];
+		uint32_t freshTime;
+		volatile bool fresh;
+		bool continuous;	// keep polling from callbacks
+		volatile uint8_t polls;	// status reads finished, wraps around
+		Pending * following;	// sensor polled next
+		Pending * alternate;	// if set, takes turns with following
+
+		Pending * next()
+		{
+			Pending * const n = following;
+
+			if (alternate != nullptr)
+			{
+				following = alternate;
+				alternate = n;
+			}
+
+			return n;
+		}
+#endif
+
+		I2cEngine * bus;
+		bool (*ready)(uint8_t);
+		void (*unpack)(const uint8_t *, int16_t *);
+	};
+
+	// addresses never change, so transactions are set up once
+	template <class Sensor>
+	void prepare(RawSensor s, Sensor & sensor)
+	{
+		Pending & p = pending[s];
+
+		sensor.prepareStatus(p.status, &p.statusByte);
+		sensor.prepareData(p.data, p.rawData);
+		p.ready = Sensor::ready;
+		p.unpack = Sensor::unpack;
+		p.status.callback = statusDone;
+		p.status.context = &p;
+		p.bus = &bus;
+	}
+
+	static void statusDone(I2cTransaction & t);
+	static int pendingResult(const Pending & p);
+
+#if defined(GY80_PIPELINE)
+	static void pipelineStatusDone(I2cTransaction & t);
+	static void pipelineDataDone(I2cTransaction & t);
+	// pass fresh readings to filter, yield services bus between sensors, return true if filter advanced
+	bool takeFresh(bool yield);
+	bool anyFresh() const;
+
+	bool pipelined = false;
+#endif
+
+	Pending pending[3]; // indexed by RawSensor
+	uint32_t pendingTime;
+
+	DataReadyEvents events;
+	bool interruptDriven = false;
+	uint8_t pins[3]; // indexed by RawSensor
+	uint16_t answeredEdge[3]; // indexed by RawSensor, edge count taken before latest read
+
+#if defined(GY80_PROFILE)
+	Profiler profiler;
+#endif
+
+#if defined(GY80_METRICS)
+	SenseMetrics senseMetrics;
+#endif
+
+	FusionScheduler fusion;
+	float declination = 0.0f;
+	float acelLatest[3] = { 0.0f, 0.0f, 0.0f }; // calibrated, for linear acceleration
+
+	GyroBias gyroCal;
+	MagnCalibration magnCal;
+	RawLogWriter * logWriter = nullptr;
+
+	MotionGate gate;
+
+	// indexed by RawSensor
+	DecimationStage decimation[3] = { nullptr, nullptr, nullptr };
+	DecimationRestart decimationRestart[3] = { nullptr, nullptr, nullptr };
+	void * decimationContext[3];
+
+	void restartDecimation();
+
+	float baro[3]; // temperature, pressure, altitude
+	bool baroValid = false;
+
+	I2cEngine & bus;
+
+	const float res[3]; // indexed by RawSensor
+	BMP085Base & pres;
+};
+
+// One board on one bus. Several boards need buses of their own, as HMC5883L and BMP085 have fixed addresses.
+// Sensor types carry their configuration, e.g. Gy80T<ADXL345T<AFS_16G>>, so calls to them are resolved at compile time.
+// Mounting is part of sensor type too, e.g. ADXL345T<AFS_4G, ARTBW_100_50, AxisMap<AXIS_Y, AXIS_NX, AXIS_Z>>.
+template <class Acel = ADXL345, class Gyro = L3G4200D, class Magn = HMC5883L, class Pres = BMP085>
+class Gy80T : public Gy80Base
+{
+public:
+	explicit Gy80T(I2cEngine & bus = WireEngine, uint8_t acelAddress = Acel::addressLow, uint8_t gyroAddress = Gyro::addressHigh) :
+		Gy80Base(bus, Acel::resolution(), Gyro::resolution(), Magn::resolution(), barometer),
+		acel(bus, acelAddress), gyro(bus, gyroAddress), magn(bus), barometer(bus) {}
+
+	int init()
+	{
+		begin();
+
+		if (acel.init() != 0)
+			return -1;
+
+		if (gyro.init() != 0)
+			return -2;
+		
+		if (magn.init() != 0)
+			return -3;
+
+		if (barometer.init() != 0)
+			return -4;
+
+		prepare(RAW_ACEL, acel);
+		prepare(RAW_GYRO, gyro);
+		prepare(RAW_MAGN, magn);
+
+		return 0;
+	}
+
+	// not ok if filter did not advance since last call
+	Orientation sense()
+	{
+		GY80_PROFILE_SCOPE(profiler, PROFILE_SENSE);
+
+		senseBarometer();
+
+		const bool updated = interruptDriven ? senseEvents() : sensePolled();
+
+		if (gate.enabled())
+		{
+			gateMotion();
+		}
+
+		return orientation(updated);
+	}
+
+	// Sleep while board is still, for sense() only, not startSense(). Thresholds are in 62.5 mG steps,
+	// see ADXL345Base::enableMotion(). While inactive gyro and magnetometer are off and filter is skipped,
+	// activity wakes them and decimation stages start over. With interrupts, motion events come on ADXL345 INT1
+	// along with data ready. Return 0 on success, call after init() and initInterrupts().
+	int initMotionGate(uint8_t activity, uint8_t inactivity, uint8_t seconds)
+	{
+		if (acel.enableMotion(activity, inactivity, seconds) != 0)
+		{
+			return -1;
+		}
+
+		gate.enable();
+
+		return 0;
+	}
+
+	// Read sensors only when their data ready pins say so, instead of polling status registers.
+	// ADXL345 INT1, L3G4200D INT2 and HMC5883L DRDY go to given pins, only one board may use this.
+	// Return 0 on success, call after init().
+	int initInterrupts(uint8_t acelPin, uint8_t gyroPin, uint8_t magnPin)
+	{
+		if (acel.enableDataReady() != 0 || gyro.enableDataReady() != 0 || magn.enableDataReady() != 0)
+		{
+			return -1;
+		}
+
+		attachInterrupts(acelPin, gyroPin, magnPin);
+
+		return 0;
+	}
 
 protected:
-	uint32_t lastUpdate;
-	Quart quart;
+	bool sensePolled()
+	{
+		const uint32_t now = micros();
+
+		int16_t raw[3];
+
+		int a, m, g;
+
+		// every sensor keeps its own data ready state, scheduler decides what to do with readings
+		{
+			GY80_PROFILE_SCOPE(profiler, PROFILE_ACEL);
+			a = acel.measureRaw(raw);
+		}
 
-	ADXL345  acel;
-	L3G4200D gyro;
-	HMC5883L magn;
-	BMP085   pres;
+		if (a == 0)
+		{
+			take(RAW_ACEL, now, raw);
+		}
+		else if (a == -1)
+		{
+			GY80_METRIC(++senseMetrics.notReady[RAW_ACEL]);
+		}
+
+		// powered down sensors are not asked
+		if (gate.state() == MOTION_INACTIVE)
+		{
+			return false;
+		}
+
+		{
+			GY80_PROFILE_SCOPE(profiler, PROFILE_MAGN);
+			m = magn.measureRaw(raw);
+		}
+
+		if (m == 0)
+		{
+			take(RAW_MAGN, now, raw);
+		}
+		else if (m == -1)
+		{
+			GY80_METRIC(++senseMetrics.notReady[RAW_MAGN]);
+		}
+
+		{
+			GY80_PROFILE_SCOPE(profiler, PROFILE_GYRO);
+			g = gyro.measureRaw(raw);
+		}
+
+#if defined(GY80_METRICS)
+		if (g == -1)
+		{
+			++senseMetrics.notReady[RAW_GYRO];
+		}
+#endif
+
+		// without gyro reading there is nothing to integrate, fresh readings wait for next gyro sample
+		return g == 0 && take(RAW_GYRO, now, raw);
+	}
+
+	bool senseEvents()
+	{
+		bool updated = false;
+
+		int16_t raw[3];
+		DrdyEvent event;
+
+		while (events.next(event))
+		{
+			// Sample of event may be taken already, reading again would give it twice. Read after the edge has taken
+			// it, e.g. second HMC5883L pulse queued while main loop was busy. ADXL345 and L3G4200D lines also tell,
+			// reading the data lowers them.
+			if (DataReadyEvents::answered(event, answeredEdge[event.sensor]) ||
+				(event.sensor != RAW_MAGN && digitalRead(pins[event.sensor]) == LOW))
+			{
+				continue;
+			}
+
+			if (readEvent(event.sensor, raw) == 0 && take(event.sensor, event.time, raw))
+			{
+				updated = true;
+			}
+		}
+
+		// edge lost to full queue or raised before handler was attached leaves ADXL345 and L3G4200D lines high for good,
+		// reading the data lowers them and lets next edge through
+		const uint32_t now = micros();
+
+		if (digitalRead(pins[RAW_ACEL]) == HIGH && readEvent(RAW_ACEL, raw) == 0)
+		{
+			take(RAW_ACEL, now, raw);
+		}
+
+		if (digitalRead(pins[RAW_GYRO]) == HIGH && readEvent(RAW_GYRO, raw) == 0 && take(RAW_GYRO, now, raw))
+		{
+			updated = true;
+		}
+
+		return updated;
+	}
+
+	// read data of sensor, edges so far are answered by it
+	int readEvent(RawSensor sensor, int16_t * raw)
+	{
+		answeredEdge[sensor] = events.edgeCount(sensor);
+
+		switch (sensor)
+		{
+		// motion events share INT1 with data ready, status read takes them and lets line go low
+		case RAW_ACEL: return gate.enabled() ? acel.measureRaw(raw) : acel.readRaw(raw);
+		case RAW_GYRO: return gyro.readRaw(raw);
+		case RAW_MAGN: return magn.readRaw(raw);
+		}
+
+		return -1;
+	}
+
+	void gateMotion()
+	{
+		// motion bits come with accelerometer status, polled or read on INT1 edges
+		const uint8_t motion = acel.takeMotion();
+
+		switch (gate.events(micros(), motion & Acel::activityBit, motion & Acel::inactivityBit))
+		{
+		case MOTION_SLEEP:
+			gate.snapshotBias(gyroCal.bias());
+			gyro.sleep();
+			magn.sleep();
+			break;
+
+		case MOTION_WAKE:
+			gyroCal.restore(gate.bias());
+			gyro.wake();
+			magn.wake();
+			restartDecimation();
+			break;
+
+		case MOTION_NONE:
+			break;
+		}
+	}
+
+	Acel acel;
+	Gyro gyro;
+	Magn magn;
+	Pres barometer;
 };
 
+typedef Gy80T<> Gy80;
+
 #endif
@@ -0,0 +1,139 @@
+#include "gy80group.h"
+
+#include "mathhelp.h"
+
+// boards further apart than this are not counted as agreeing
+constexpr float maxDisagreement = 10.0f; // degrees
+
+// quaternions q and -q are same orientation, so this is cosine of half angle between them
+static float similarity(Quart & a, Quart & b)
+{
+	const float dot = a.q1() * b.q1() + a.q2() * b.q2() + a.q3() * b.q3() + a.q4() * b.q4();
+
+	return dot < 0.0f ? -dot : dot;
+}
+
+int Gy80Group::add(Gy80Base & board)
+{
+	if (count >= maxBoards)
+	{
+		return -1;
+	}
+
+	boards[count++] = &board;
+
+	return 0;
+}
+
+Orientation Gy80Group::sense()
+{
+	for (uint8_t i = 0; i < count; ++i)
+	{
+		boards[i]->startSense();
+	}
+
+	// every engine moves its own bus, servicing them in turn keeps all buses busy
+	for (bool ready = false; !ready; )
+	{
+		ready = true;
+
+		for (uint8_t i = 0; i < count; ++i)
+		{
+			boards[i]->engine().service();
+			ready = boards[i]->senseReady() && ready;
+		}
+	}
+
+	bool updated = false;
+
+	for (uint8_t i = 0; i < count; ++i)
+	{
+		Orientation o = boards[i]->finishSense();
+
+		if (o.ok())
+		{
+			latest[i] = o.quart();
+			acel[i][0] = o.acceleration()[0];
+			acel[i][1] = o.acceleration()[1];
+			acel[i][2] = o.acceleration()[2];
+			valid[i] = true;
+			updated = true;
+		}
+	}
+
+	if (!updated)
+	{
+		return Orientation();
+	}
+
+	// vote, every board counts others it agrees with
+	const float agree = cosf(deg2rad(maxDisagreement) * 0.5f);
+
+	uint8_t votes[maxBoards] = {};
+	uint8_t best = 0;
+
+	for (uint8_t i = 0; i < count; ++i)
+	{
+		for (uint8_t j = i + 1; j < count; ++j)
+		{
+			if (valid[i] && valid[j] && similarity(latest[i], latest[j]) >= agree)
+			{
+				++votes[i];
+				++votes[j];
+			}
+		}
+
+		if (valid[i] && votes[i] > best)
+		{
+			best = votes[i];
+		}
+	}
+
+	// average of majority, signs aligned to first member
+	Quart q;
+	q.q1() = q.q2() = q.q3() = q.q4() = 0.0f;
+
+	float a[3] = { 0.0f, 0.0f, 0.0f };
+	int8_t first = -1;
+	uint8_t members = 0;
+
+	outvotedMask = 0;
+
+	for (uint8_t i = 0; i < count; ++i)
+	{
+		if (!valid[i] || votes[i] < best || (best == 0 && first >= 0))
+		{
+			outvotedMask |= 1 << i;
+			continue;
+		}
+
+		if (first < 0)
+		{
+			first = i;
+		}
+
+		const float dot = latest[first].q1() * latest[i].q1() + latest[first].q2() * latest[i].q2()
+			+ latest[first].q3() * latest[i].q3() + latest[first].q4() * latest[i].q4();
+		const float sign = dot < 0.0f ? -1.0f : 1.0f;
+
+		q.q1() += sign * latest[i].q1();
+		q.q2() += sign * latest[i].q2();
+		q.q3() += sign * latest[i].q3();
+		q.q4() += sign * latest[i].q4();
+
+		a[0] += acel[i][0];
+		a[1] += acel[i][1];
+		a[2] += acel[i][2];
+
+		++members;
+	}
+
+	// close quaternions average well enough by normalised sum
+	normalize(q.q1(), q.q2(), q.q3(), q.q4());
+
+	a[0] /= members;
+	a[1] /= members;
+	a[2] /= members;
+
+	return Orientation(q, a, declination);
+}
@@ -0,0 +1,44 @@
+#ifndef gy80group_h_
+#define gy80group_h_
+
+#include "gy-80.h"
+
+// Redundant boards mounted the same way, each on a bus of its own, sampled at once and combined.
+// Boards vote, those agreeing with most others within maxDisagreement are averaged, the rest are ignored.
+// With two boards that disagree there is no majority, first added board wins.
+class Gy80Group
+{
+public:
+	Gy80Group() = default;
+
+	Gy80Group (const Gy80Group &) = delete;
+	Gy80Group & operator = (const Gy80Group &) = delete;
+
+	// board must be initialised, return -1 if group is full
+	int add(Gy80Base & board);
+
+	// not ok if no board advanced since last call
+	Orientation sense();
+
+	// magnetic declination in degrees, subtracted from yaw of combined orientation
+	void setDeclination(float degrees) { declination = degrees; }
+
+	// bit for every board, in order of add(), that was left out of latest combined result
+	uint8_t outvoted() const { return outvotedMask; }
+
+	static constexpr uint8_t maxBoards = 4;
+
+protected:
+	Gy80Base * boards[maxBoards];
+	uint8_t count = 0;
+
+	// latest result of every board, boards may advance at different calls
+	Quart latest[maxBoards];
+	float acel[maxBoards][3];
+	bool valid[maxBoards] = {};
+
+	float declination = 0.0f;
+	uint8_t outvotedMask = 0;
+};
+
+#endif
@@ -0,0 +1,190 @@
+#include "i2cbus.h"
+
+int I2cEngine::submit(I2cTransaction & t)
+{
+	if (!t.finished())
+	{
+		return -1; // already queued
+	}
+
+	lock();
+
+	t.status = XFER_QUEUED;
+	t.next = nullptr;
+
+	if (tail != nullptr)
+	{
+		tail->next = &t;
+	}
+	else
+	{
+		head = &t;
+	}
+
+	tail = &t;
+
+	kick();
+	unlock();
+
+	return 0;
+}
+
+int I2cEngine::submitFirst(I2cTransaction & t)
+{
+	if (!t.finished())
+	{
+		return -1; // already queued
+	}
+
+	lock();
+
+	// active transaction stays where it is
+	I2cTransaction * before = head != nullptr && head->status != XFER_QUEUED ? head : nullptr;
+
+	t.status = XFER_QUEUED;
+	t.next = before != nullptr ? before->next : head;
+
+	if (before != nullptr)
+	{
+		before->next = &t;
+	}
+	else
+	{
+		head = &t;
+	}
+
+	if (t.next == nullptr)
+	{
+		tail = &t;
+	}
+
+	kick();
+	unlock();
+
+	return 0;
+}
+
+int I2cEngine::useCompletionInterrupt()
+{
+	lock();
+
+	interruptDriven = bus.notifyOnDone(completed, this) == 0;
+
+	unlock();
+
+	return interruptDriven ? 0 : -1;
+}
+
+void I2cEngine::completed(void * engine)
+{
+	I2cEngine & e = *static_cast<I2cEngine *>(engine);
+
+	// interrupt may come while service() runs, e.g. on host where nothing blocks it
+	if (!e.inside)
+	{
+		e.advance();
+	}
+}
+
+void I2cEngine::kick()
+{
+	// idle bus gives no completion interrupt, first transaction is started here,
+	// from inside of advance() loop there takes it
+	if (interruptDriven && !inside && head != nullptr && head->status == XFER_QUEUED)
+	{
+		advance();
+	}
+}
+
+void I2cEngine::service()
+{
+	lock();
+	advance();
+	unlock();
+}
+
+void I2cEngine::advance()
+{
+	inside = true;
+
+	while (head != nullptr)
+	{
+		I2cTransaction & t = *head;
+
+		if (t.status == XFER_QUEUED)
+		{
+			t.status = bus.start(t) == 0 ? XFER_ACTIVE : XFER_ERROR;
+			activeSince = bus.now();
+
+			GY80_METRIC(activeCycles = cycles());
+		}
+
+		if (t.status == XFER_ACTIVE)
+		{
+			int s = bus.poll(t);
+
+			if (s == XFER_ACTIVE)
+			{
+				if (bus.now() - activeSince <= t.timeout)
+				{
+					break; // bus is busy, come back later
+				}
+
+				bus.recover();
+				s = XFER_TIMEOUT;
+			}
+
+			t.status = s;
+		}
+
+		if (t.status != XFER_DONE && attempt < t.retries)
+		{
+			++attempt;
+			t.status = XFER_QUEUED;
+
+			GY80_METRIC(++busMetrics.retries);
+			continue;
+		}
+
+		attempt = 0;
+
+#if defined(GY80_METRICS)
+		++busMetrics.transactions;
+
+		if (t.status == XFER_DONE)
+		{
+			busMetrics.bytes += 1 + t.count;
+			busMetrics.time.add(cycles() - activeCycles);
+		}
+		else
+		{
+			++busMetrics.errors;
+		}
+#endif
+
+		// unlink before callback, so it can submit again
+		head = t.next;
+		if (head == nullptr)
+		{
+			tail = nullptr;
+		}
+		t.next = nullptr;
+
+		if (t.callback != nullptr)
+		{
+			t.callback(t);
+		}
+	}
+
+	inside = false;
+}
+
+int I2cEngine::wait(I2cTransaction & t)
+{
+	while (!t.finished())
+	{
+		service();
+	}
+
+	return t.status;
+}
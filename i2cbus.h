@@ -0,0 +1,153 @@
+#ifndef i2cbus_h_
+#define i2cbus_h_
+
+#include <Arduino.h>
+#include <stdint.h>
+
+#include "metrics.h"
+
+// state of a transaction, negative values are failures
+enum XferStatus
+{
+	XFER_DONE   = 0,
+	XFER_QUEUED = 1,
+	XFER_ACTIVE = 2,
+	XFER_ERROR   = -1,	// not acknowledged, arbitration lost, short read
+	XFER_TIMEOUT = -2,	// did not finish in time, bus was recovered
+};
+
+struct I2cTransaction;
+
+typedef void (*I2cCallback)(I2cTransaction &);
+
+// completion interrupt handler of bus backend, see I2cBus::notifyOnDone()
+typedef void (*I2cNotify)(void * context);
+
+struct I2cTransaction
+{
+	// read count bytes starting at subAddress into dest
+	void prepareRead(uint8_t addr, uint8_t sub, uint8_t n, uint8_t * dest)
+	{
+		address = addr; subAddress = sub; count = n; data = dest; read = true;
+	}
+
+	// write count bytes from src starting at subAddress, src must stay valid until transaction is started
+	void prepareWrite(uint8_t addr, uint8_t sub, uint8_t n, uint8_t * src)
+	{
+		address = addr; subAddress = sub; count = n; data = src; read = false;
+	}
+
+	bool finished() const { return status <= XFER_DONE; }
+
+	// worst case time of transaction is (retries + 1) * timeout plus bus recoveries
+	uint32_t timeout = 2000;	// microseconds for one attempt
+	uint8_t  retries = 2;		// attempts after failed one
+
+	uint8_t   address    = 0;
+	uint8_t   subAddress = 0;
+	uint8_t   count      = 0;
+	uint8_t * data       = nullptr;
+	bool      read       = true;
+
+	volatile int8_t status = XFER_DONE;
+
+	I2cCallback callback = nullptr;	// called on completion, from completion interrupt if engine uses it
+	void *      context  = nullptr;	// free for use by owner of transaction
+
+	I2cTransaction * next = nullptr;	// queue link, owned by I2cEngine
+};
+
+// bus backend, performs one transaction at a time without blocking
+class I2cBus
+{
+public:
+	I2cBus() = default;
+	virtual ~I2cBus() = default;
+
+	// set up controller, called once before first transaction
+	virtual void begin() {}
+
+	// begin transfer, return 0 if started
+	virtual int start(I2cTransaction &) = 0;
+
+	// advance transfer, return XFER_ACTIVE while running, XFER_DONE or error when finished
+	virtual int poll(I2cTransaction &) = 0;
+
+	// abandon active transfer and free the bus, e.g. clock out slave holding SDA low
+	virtual void recover() = 0;
+
+	// microseconds, for timeouts
+	virtual uint32_t now() = 0;
+
+	// Have notify called from interrupt whenever a transfer phase finished, nullptr stops it.
+	// Return 0 if backend has such an interrupt, -1 if it can only be polled.
+	virtual int notifyOnDone(I2cNotify, void *) { return -1; }
+};
+
+// FIFO of transactions executed in order of submission on one bus
+// Polled by default: transfers move on only in service(), called by wait() or the main loop.
+// With useCompletionInterrupt() the completion interrupt of the bus polls, starts next phase or transaction
+// and runs callbacks, so the bus keeps going while the main loop computes. service() is then needed only
+// for timeouts. submit() and service() block that interrupt while they change the queue.
+// engines of different buses are independent, servicing them in turn runs their transfers at the same time
+class I2cEngine
+{
+public:
+	explicit I2cEngine(I2cBus & bus) : bus(bus) {}
+
+	I2cEngine (const I2cEngine &) = delete;
+	I2cEngine & operator = (const I2cEngine &) = delete;
+
+	void begin() { bus.begin(); }
+
+	// queue transaction, it must stay alive until finished
+	int submit(I2cTransaction &);
+
+	// queue transaction ahead of waiting ones, next to start after active one, e.g. from completion callback
+	// to read data right after status said there is some
+	int submitFirst(I2cTransaction &);
+
+	// advance active transaction, start next ones, run completion callbacks
+	void service();
+
+	// service until transaction is finished, return its status, bounded by timeouts of queued transactions
+	int wait(I2cTransaction &);
+
+	bool idle() const { return head == nullptr; }
+
+	// drive transfers from completion interrupt of bus, return 0 on success, -1 if bus has no such interrupt
+	// callbacks of transactions then run in interrupt context, keep them short, they may submit
+	int useCompletionInterrupt();
+
+#if defined(GY80_METRICS)
+	BusMetrics & metrics() { return busMetrics; }
+#endif
+
+protected:
+	I2cBus & bus;
+
+#if defined(GY80_METRICS)
+	BusMetrics busMetrics;
+	uint32_t activeCycles;	// cycles() when head was started
+#endif
+
+	// service() without blocking interrupt, for completion interrupt and inside of service()
+	void advance();
+	static void completed(void * engine);
+	// start transaction queued on idle bus when completion interrupt drives it
+	void kick();
+
+	// queue changes from main loop block completion interrupt, ones from callbacks run with it blocked already
+	void lock() { if (!inside) noInterrupts(); }
+	void unlock() { if (!inside) interrupts(); }
+
+	I2cTransaction * volatile head = nullptr;	// active transaction
+	I2cTransaction * tail = nullptr;
+	volatile bool inside = false;	// advance() runs
+	bool interruptDriven = false;
+
+	uint32_t activeSince;	// bus.now() when head was started
+	uint8_t  attempt = 0;	// retries of head so far
+};
+
+#endif
@@ -1,43 +1,38 @@
 #include "i2chelp.h"
 
-void writeCommand(uint8_t address, uint8_t command)
-{
-	Wire.beginTransmission(address);	// initialize the Tx buffer
-	Wire.write(command);				// put command in Tx buffer
-	Wire.endTransmission();				// send the Tx buffer
-}
+#include "i2cwire.h"
+
+static WireBus wireBus(Wire);
+I2cEngine WireEngine(wireBus);
 
-void writeByte(uint8_t address, uint8_t subAddress, uint8_t data)
+int writeCommand(I2cEngine & bus, uint8_t address, uint8_t command)
 {
-	Wire.beginTransmission(address);	// initialize the Tx buffer
-	Wire.write(subAddress);				// put slave register address in Tx buffer
-	Wire.write(data);					// put data in Tx buffer
-	Wire.endTransmission();				// send the Tx buffer
+	I2cTransaction t;
+	t.prepareWrite(address, command, 0, nullptr);	// command goes where slave register address would
+
+	bus.submit(t);
+	return bus.wait(t);
 }
 
-uint8_t readByte(uint8_t address, uint8_t subAddress)
+int writeByte(I2cEngine & bus, uint8_t address, uint8_t subAddress, uint8_t data)
 {
-	Wire.beginTransmission(address);		// initialize the Tx buffer
-	Wire.write(subAddress);					// put slave register address in Tx buffer
-	Wire.endTransmission(false);			// send the Tx buffer, but send a restart to keep connection alive
-
-	Wire.requestFrom(address, (uint8_t) 1);	// read one byte from slave register address 
+	I2cTransaction t;
+	t.prepareWrite(address, subAddress, 1, &data);
 
-	return Wire.read();						// fill Rx buffer with result
+	bus.submit(t);
+	return bus.wait(t);
 }
 
-void readBytes(uint8_t address, uint8_t subAddress, uint8_t count, uint8_t * dest)
-{  
-	Wire.beginTransmission(address);	// initialize the Tx buffer
-	Wire.write(subAddress);				// put slave register address in Tx buffer
-	Wire.endTransmission(false);		// send the Tx buffer, but send a restart to keep connection alive
-
-	Wire.requestFrom(address, count);	// read bytes from slave register address 
+int readByte(I2cEngine & bus, uint8_t address, uint8_t subAddress, uint8_t & data)
+{
+	return readBytes(bus, address, subAddress, 1, &data);
+}
 
-	uint8_t i = 0;
+int readBytes(I2cEngine & bus, uint8_t address, uint8_t subAddress, uint8_t count, uint8_t * dest)
+{
+	I2cTransaction t;
+	t.prepareRead(address, subAddress, count, dest);
 
-	while (Wire.available())
-	{
-		dest[i++] = Wire.read();		// put read results in the Rx buffer
-	}         
+	bus.submit(t);
+	return bus.wait(t);
 }
@@ -3,9 +3,16 @@
 
 #include <i2c_t3.h>
 
-void writeCommand(uint8_t address, uint8_t command);
-void writeByte   (uint8_t address, uint8_t subAddress, uint8_t data);
-uint8_t readByte (uint8_t address, uint8_t subAddress);
-void readBytes   (uint8_t address, uint8_t subAddress, uint8_t count, uint8_t * dest);
+#include "i2cbus.h"
+
+// transaction engine on Wire, pins 18 and 19 at 400 kHz, default bus of sensors
+extern I2cEngine WireEngine;
+
+// blocking transfers on given bus
+// return 0 on success, negative XferStatus after timeouts and retries ran out, read data is undefined then
+int writeCommand(I2cEngine & bus, uint8_t address, uint8_t command);
+int writeByte   (I2cEngine & bus, uint8_t address, uint8_t subAddress, uint8_t data);
+int readByte    (I2cEngine & bus, uint8_t address, uint8_t subAddress, uint8_t & data);
+int readBytes   (I2cEngine & bus, uint8_t address, uint8_t subAddress, uint8_t count, uint8_t * dest);
 
 #endif
@@ -0,0 +1,133 @@
+#include "i2cwire.h"
+
+void WireBus::begin()
+{
+	/*
+	We have disabled the internal pull-ups used by the Wire library in the Wire.h/twi.c utility file.
+	We are also using the 400 kHz fast I2C mode by setting the TWI_FREQ to 400000L /twi.h utility file.
+	The Teensy has no internal pullups and we are using the Wire.begin function of the i2c_t3.h library
+	to select 400 Hz i2c speed.
+	*/
+
+	wire.begin(I2C_MASTER, 0x00, pins, I2C_PULLUP_EXT, rate);
+}
+
+int WireBus::start(I2cTransaction & t)
+{
+	wire.beginTransmission(t.address);	// initialize the Tx buffer
+	wire.write(t.subAddress);			// put slave register address in Tx buffer
+
+	if (t.read)
+	{
+		wire.sendTransmission(I2C_NOSTOP);	// send the Tx buffer, but send a restart to keep connection alive
+		phase = PHASE_ADDRESS;
+	}
+	else
+	{
+		for (uint8_t i = 0; i < t.count; ++i)
+		{
+			wire.write(t.data[i]);			// put data in Tx buffer
+		}
+
+		wire.sendTransmission(I2C_STOP);	// send the Tx buffer
+		phase = PHASE_WRITE;
+	}
+
+	return 0;
+}
+
+int WireBus::poll(I2cTransaction & t)
+{
+	if (!wire.done())
+	{
+		return XFER_ACTIVE;
+	}
+
+	if (wire.getError() != 0)
+	{
+		return XFER_ERROR;
+	}
+
+	if (phase == PHASE_ADDRESS)
+	{
+		wire.sendRequest(t.address, t.count, I2C_STOP);	// read bytes from slave register address
+		phase = PHASE_READ;
+
+		return XFER_ACTIVE;
+	}
+
+	if (phase == PHASE_READ)
+	{
+		// fewer bytes would leave stale data in dest
+		if (wire.available() < t.count)
+		{
+			return XFER_ERROR;
+		}
+
+		for (uint8_t i = 0; i < t.count; ++i)
+		{
+			t.data[i] = wire.read();	// put read results in the Rx buffer
+		}
+	}
+
+	return XFER_DONE;
+}
+
+void WireBus::recover()
+{
+	// clocks SCL until slave lets go of SDA, then sends stop and sets up the controller again
+	wire.resetBus();
+}
+
+WireBus * WireBus::notified[maxNotified] = {};
+
+template <uint8_t N>
+void WireBus::done()
+{
+	WireBus * const w = notified[N];
+
+	if (w != nullptr && w->notify != nullptr)
+	{
+		w->notify(w->notifyContext);
+	}
+}
+
+int WireBus::notifyOnDone(I2cNotify n, void * context)
+{
+	static void (* const handlers[maxNotified])(void) { done<0>, done<1>, done<2>, done<3> };
+
+	// slot of this bus, or first free one
+	uint8_t slot = 0;
+
+	while (slot < maxNotified && notified[slot] != this)
+	{
+		++slot;
+	}
+
+	if (slot == maxNotified)
+	{
+		slot = 0;
+
+		while (slot < maxNotified && notified[slot] != nullptr)
+		{
+			++slot;
+		}
+	}
+
+	if (slot == maxNotified)
+	{
+		return -1; // all taken
+	}
+
+	noInterrupts();
+	notify = n;
+	notifyContext = context;
+	notified[slot] = n != nullptr ? this : nullptr;
+	interrupts();
+
+	wire.onTransmitDone(n != nullptr ? handlers[slot] : nullptr);
+	wire.onReqFromDone(n != nullptr ? handlers[slot] : nullptr);
+	wire.onError(n != nullptr ? handlers[slot] : nullptr);
+
+	return 0;
+}
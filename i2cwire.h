@@ -0,0 +1,50 @@
+#ifndef i2cwire_h_
+#define i2cwire_h_
+
+#include <i2c_t3.h>
+
+#include "i2cbus.h"
+
+// bus backend on top of non-blocking i2c_t3 calls, e.g. WireBus(Wire1, I2C_PINS_37_38) for second bus of Teensy 3.6
+class WireBus : public I2cBus
+{
+public:
+	explicit WireBus(i2c_t3 & wire, i2c_pins pins = I2C_PINS_18_19, i2c_rate rate = I2C_RATE_400) :
+		wire(wire), pins(pins), rate(rate) {}
+	virtual ~WireBus() = default;
+
+	virtual void begin();
+	virtual int start(I2cTransaction &);
+	virtual int poll(I2cTransaction &);
+	virtual void recover();
+	virtual uint32_t now() { return micros(); }
+
+	// i2c_t3 onTransmitDone, onReqFromDone and onError, one WireBus per i2c_t3 and at most maxNotified of them
+	virtual int notifyOnDone(I2cNotify, void *);
+
+protected:
+	enum Phase : uint8_t
+	{
+		PHASE_WRITE,	// sub address and data are being sent
+		PHASE_ADDRESS,	// sub address is being sent, read follows
+		PHASE_READ,		// data is being received
+	};
+
+	i2c_t3 & wire;
+	const i2c_pins pins;
+	const i2c_rate rate;
+
+	Phase phase = PHASE_WRITE;
+
+	// i2c_t3 callbacks take no argument, so each bus gets a handler of its own that finds it here
+	static constexpr uint8_t maxNotified = 4;
+	static WireBus * notified[maxNotified];
+
+	template <uint8_t N>
+	static void done();
+
+	I2cNotify notify = nullptr;
+	void * notifyContext = nullptr;
+};
+
+#endif
@@ -1,24 +1,27 @@
 #ifndef imudata_h_
 #define imudata_h_
 
-struct ImuData
+template <typename T>
+struct ImuDataT
 {
-	float & ax() { return values[0]; }
-	float & ay() { return values[1]; }
-	float & az() { return values[2]; }
+	T & ax() { return values[0]; }
+	T & ay() { return values[1]; }
+	T & az() { return values[2]; }
 
-	float & gx() { return values[3]; }
-	float & gy() { return values[4]; }
-	float & gz() { return values[5]; }	
+	T & gx() { return values[3]; }
+	T & gy() { return values[4]; }
+	T & gz() { return values[5]; }	
 	
-	float & mx() { return values[6]; }
-	float & my() { return values[7]; }
-	float & mz() { return values[8]; }
+	T & mx() { return values[6]; }
+	T & my() { return values[7]; }
+	T & mz() { return values[8]; }
 
 	bool & ok() { return state; }
 	
-	float values[9];
+	T values[9];
 	bool state;
 };
 
+typedef ImuDataT<float> ImuData;
+
 #endif
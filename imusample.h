@@ -0,0 +1,17 @@
+#ifndef imusample_h_
+#define imusample_h_
+
+#include <stdint.h>
+
+// one timestamped three axis sample, as drained from sensor FIFO
+struct ImuSample
+{
+	float & x() { return values[0]; }
+	float & y() { return values[1]; }
+	float & z() { return values[2]; }
+
+	float values[3];
+	uint32_t time; // micros() when sample was taken
+};
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef lanes_h_
+#define lanes_h_
+
+// Several floats processed by one SIMD instruction, used to run the filter for many units at once.
+// Every operation rounds exactly like its scalar float counterpart, so lanes give the same bits as scalar code
+// as long as compiler does not contract scalar multiply-add into FMA.
+// GY80_LANES is defined only when host has SSE or AVX, there is nothing of this on Teensy.
+
+#if defined(__AVX__)
+
+#include <immintrin.h>
+
+#define GY80_LANES 8
+
+struct Lanes
+{
+	Lanes() = default;
+	Lanes(float f) : v(_mm256_set1_ps(f)) {}
+	Lanes(__m256 v) : v(v) {}
+
+	static Lanes load(const float * p) { return _mm256_loadu_ps(p); }
+	void store(float * p) const { _mm256_storeu_ps(p, v); }
+
+	friend Lanes operator + (Lanes a, Lanes b) { return _mm256_add_ps(a.v, b.v); }
+	friend Lanes operator - (Lanes a, Lanes b) { return _mm256_sub_ps(a.v, b.v); }
+	friend Lanes operator * (Lanes a, Lanes b) { return _mm256_mul_ps(a.v, b.v); }
+	friend Lanes operator / (Lanes a, Lanes b) { return _mm256_div_ps(a.v, b.v); }
+
+	Lanes operator - () const { return _mm256_xor_ps(v, _mm256_set1_ps(-0.0f)); }
+
+	Lanes & operator += (Lanes b) { return *this = *this + b; }
+	Lanes & operator -= (Lanes b) { return *this = *this - b; }
+
+	// per lane mask of a > 0, false for NaN like isgreater
+	friend Lanes positive(Lanes a) { return _mm256_cmp_ps(a.v, _mm256_setzero_ps(), _CMP_GT_OQ); }
+	// per lane mask ? a : b
+	friend Lanes select(Lanes mask, Lanes a, Lanes b) { return _mm256_blendv_ps(b.v, a.v, mask.v); }
+	// bit set for every lane with mask set
+	friend int bits(Lanes mask) { return _mm256_movemask_ps(mask.v); }
+
+	friend Lanes sqrt(Lanes a) { return _mm256_sqrt_ps(a.v); }
+
+	__m256 v;
+};
+
+#elif defined(__SSE2__)
+
+#include <emmintrin.h>
+
+#define GY80_LANES 4
+
+struct Lanes
+{
+	Lanes() = default;
+	Lanes(float f) : v(_mm_set1_ps(f)) {}
+	Lanes(__m128 v) : v(v) {}
+
+	static Lanes load(const float * p) { return _mm_loadu_ps(p); }
+	void store(float * p) const { _mm_storeu_ps(p, v); }
+
+	friend Lanes operator + (Lanes a, Lanes b) { return _mm_add_ps(a.v, b.v); }
+	friend Lanes operator - (Lanes a, Lanes b) { return _mm_sub_ps(a.v, b.v); }
+	friend Lanes operator * (Lanes a, Lanes b) { return _mm_mul_ps(a.v, b.v); }
+	friend Lanes operator / (Lanes a, Lanes b) { return _mm_div_ps(a.v, b.v); }
+
+	Lanes operator - () const { return _mm_xor_ps(v, _mm_set1_ps(-0.0f)); }
+
+	Lanes & operator += (Lanes b) { return *this = *this + b; }
+	Lanes & operator -= (Lanes b) { return *this = *this - b; }
+
+	friend Lanes positive(Lanes a) { return _mm_cmpgt_ps(a.v, _mm_setzero_ps()); }
+	friend Lanes select(Lanes mask, Lanes a, Lanes b) { return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)); }
+	friend int bits(Lanes mask) { return _mm_movemask_ps(mask.v); }
+
+	friend Lanes sqrt(Lanes a) { return _mm_sqrt_ps(a.v); }
+
+	__m128 v;
+};
+
+#endif
+
+#if defined(GY80_LANES)
+
+constexpr int allLanes = (1 << GY80_LANES) - 1;
+
+// result of normalising lanes, converts to true if any lane was normalised
+struct LanesOk
+{
+	operator bool() const { return mask != 0; }
+
+	int mask;
+};
+
+// same arithmetic as scalar normalize(), lanes with zero length are left as they are
+inline LanesOk normalize(Lanes & a, Lanes & b, Lanes & c)
+{
+	Lanes norm = sqrt(a * a + b * b + c * c);
+	const Lanes ok = positive(norm);
+
+	norm = Lanes(1.0f) / norm;
+
+	a = select(ok, a * norm, a);
+	b = select(ok, b * norm, b);
+	c = select(ok, c * norm, c);
+
+	return LanesOk { bits(ok) };
+}
+
+inline LanesOk normalize(Lanes & a, Lanes & b, Lanes & c, Lanes & d)
+{
+	Lanes norm = sqrt(a * a + b * b + c * c + d * d);
+	const Lanes ok = positive(norm);
+
+	norm = Lanes(1.0f) / norm;
+
+	a = select(ok, a * norm, a);
+	b = select(ok, b * norm, b);
+	c = select(ok, c * norm, c);
+	d = select(ok, d * norm, d);
+
+	return LanesOk { bits(ok) };
+}
+
+#endif
+
+#endif
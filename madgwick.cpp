@@ -1,141 +1,230 @@
 #include "madgwick.h"
 
 #include "mathhelp.h"
+#include "lanes.h"
 
 // Implementation of Sebastian Madgwick's "...efficient orientation filter for... inertial/magnetic sensor arrays"
 // (see http://www.x-io.co.uk/category/open-source/ for examples and more details)
 // which fuses acceleration, rotation rate, and magnetic moments to produce a quaternion-based estimate of absolute
 // device orientation -- which can be converted to yaw, pitch, and roll. Useful for stabilizing quadcopters, etc.
 
-#define AX input.ax()
-#define AY input.ay()
-#define AZ input.az()
-#define GX input.gx()
-#define GY input.gy()
-#define GZ input.gz()
-#define MX input.mx()
-#define MY input.my()
-#define MZ input.mz()
-
-void MadgwickQuaternionUpdate(Quart& quart, FilterInput input)
+// There is a tradeoff in the beta parameter between accuracy and response speed.
+// In the original Madgwick study, beta of 0.041 (corresponding to GyroMeasError of 2.7 degrees/s) was found to give optimal accuracy.
+// However, with this value, the LSM9SD0 response time is about 10 seconds to a stable initial quaternion.
+// Subsequent changes also require a longish lag time to a stable output, not fast enough for a quadcopter or robot car!
+// By increasing beta (GyroMeasError) by about a factor of fifteen, the response time constant is reduced to ~2 sec
+// I haven't noticed any reduction in solution accuracy. This is essentially the I coefficient in a PID control sense; 
+// the bigger the feedback coefficient, the faster the solution converges, usually at the expense of accuracy. 
+// In any case, this is the free parameter in the Madgwick filtering and fusion scheme.
+
+// global constants for 9 DoF fusion and AHRS (Attitude and Heading Reference System)
+constexpr float gyroMeasError = deg2rad(40.0f); // gyroscope measurement error in rads/s
+constexpr float beta = sqrt(3.0f / 4.0f) * gyroMeasError;
+
+// Gradient of objective, estimated minus measured directions of gravity and magnetic field, up to factor 2.
+// Written as q * (r, u), u turns q and r changes its length, this is same value as the expansion in Madgwick's
+// report with its row of Jacobian for length. Reference there is _2bx, _2bz, yet it is used as bx, bz,
+// so estimated field direction has half length of measured one, kept as is.
+template <typename T>
+static QUART_INLINE QuartT<T> gradient(const QuartT<T> & q, const Vec3T<T> & a, const Vec3T<T> & m, T _2bx, T _2bz)
 {
-	// There is a tradeoff in the beta parameter between accuracy and response speed.
-	// In the original Madgwick study, beta of 0.041 (corresponding to GyroMeasError of 2.7 degrees/s) was found to give optimal accuracy.
-	// However, with this value, the LSM9SD0 response time is about 10 seconds to a stable initial quaternion.
-	// Subsequent changes also require a longish lag time to a stable output, not fast enough for a quadcopter or robot car!
-	// By increasing beta (GyroMeasError) by about a factor of fifteen, the response time constant is reduced to ~2 sec
-	// I haven't noticed any reduction in solution accuracy. This is essentially the I coefficient in a PID control sense; 
-	// the bigger the feedback coefficient, the faster the solution converges, usually at the expense of accuracy. 
-	// In any case, this is the free parameter in the Madgwick filtering and fusion scheme.
-
-	// global constants for 9 DoF fusion and AHRS (Attitude and Heading Reference System)
-	constexpr float gyroMeasError = deg2rad(40.0f); // gyroscope measurement error in rads/s
-	constexpr float beta = sqrt(3.0f / 4.0f) * gyroMeasError;
-
-	// local copies of previous values
-	float q1 = quart.q1(), q2 = quart.q2(), q3 = quart.q3(), q4 = quart.q4(); 
-
-	// auxiliary variables to avoid repeated arithmetic
-	float hx, hy, _2bx, _2bz;
-	float s1, s2, s3, s4;
-	float qDot1, qDot2, qDot3, qDot4;
-	float _2q1mx;
-	float _2q1my;
-	float _2q1mz;
-	float _2q2mx;
-	float _4bx;
-	float _4bz;
-	float _2q1 = 2.0f * q1;
-	float _2q2 = 2.0f * q2;
-	float _2q3 = 2.0f * q3;
-	float _2q4 = 2.0f * q4;
-	float _2q1q3 = 2.0f * q1 * q3;
-	float _2q3q4 = 2.0f * q3 * q4;
-	float q1q1 = q1 * q1;
-	float q1q2 = q1 * q2;
-	float q1q3 = q1 * q3;
-	float q1q4 = q1 * q4;
-	float q2q2 = q2 * q2;
-	float q2q3 = q2 * q3;
-	float q2q4 = q2 * q4;
-	float q3q3 = q3 * q3;
-	float q3q4 = q3 * q4;
-	float q4q4 = q4 * q4;
+	const T bx = 0.5f * _2bx;
+	const T bz = 0.5f * _2bz;
+
+	// estimated directions in sensor frame
+	const Vec3T<T> v = earthAxis<2>(q);
+	const Vec3T<T> w = earthAxis<0>(q) * bx + v * bz;
+
+	const Vec3T<T> fg = v - a;
+	const Vec3T<T> fb = w - m;
+
+	const T r = dot(fg, v) - fg.z() + dot(fb, w) - (fb.x() * bx + fb.z() * bz);
+
+	return q * quart(r, cross(fg, v) + cross(fb, w));
+}
+
+// same gradient for gravity alone
+template <typename T>
+static QUART_INLINE QuartT<T> gravityGradient(const QuartT<T> & q, const Vec3T<T> & a)
+{
+	const Vec3T<T> v = earthAxis<2>(q);
+	const Vec3T<T> fg = v - a;
+
+	return q * quart(dot(fg, v) - fg.z(), cross(fg, v));
+}
+
+template <typename T>
+void MadgwickQuaternionUpdate(QuartT<T>& quart, FilterInputT<T> input)
+{
+	QuartT<T> q = quart;
+
+	Vec3T<T> a(input.ax(), input.ay(), input.az());
+	Vec3T<T> m(input.mx(), input.my(), input.mz());
+	const Vec3T<T> g(input.gx(), input.gy(), input.gz());
 
 	// normalise accelerometer measurement
-	if (!normalize(AX, AY, AZ))
+	if (!normalize(a))
 	{
 		return;
 	}
 
 	// normalise magnetometer measurement
-	if (!normalize(MX, MY, MZ))
+	if (!normalize(m))
 	{
 		return;
 	}
 
 	// reference direction of Earth's magnetic field
-	_2q1mx = 2.0f * q1 * MX;
-	_2q1my = 2.0f * q1 * MY;
-	_2q1mz = 2.0f * q1 * MZ;
-	_2q2mx = 2.0f * q2 * MX;
-
-	hx = MX * q1q1 - _2q1my * q4 + _2q1mz * q3 + MX * q2q2 + _2q2 * MY * q3 + _2q2 * MZ * q4 - MX * q3q3 - MX * q4q4;
-	hy = _2q1mx * q4 + MY * q1q1 - _2q1mz * q2 + _2q2mx * q3 - MY * q2q2 + MY * q3q3 + _2q3 * MZ * q4 - MY * q4q4;
+	const Vec3T<T> h = rotate(q, m);
 
-	_2bx = sqrt(hx * hx + hy * hy);
-	_2bz = -_2q1mx * q3 + _2q1my * q2 + MZ * q1q1 + _2q2mx * q4 - MZ * q2q2 + _2q3 * MY * q4 - MZ * q3q3 + MZ * q4q4;
-	_4bx = 2.0f * _2bx;
-	_4bz = 2.0f * _2bz;
-
-	// gradient decent algorithm corrective step
-	s1 = -_2q3 * (2.0f * q2q4 - _2q1q3 - AX) + _2q2 * (2.0f * q1q2 + _2q3q4 - AY) - _2bz * q3 * (_2bx * (0.5f - q3q3 - q4q4) + _2bz * (q2q4 - q1q3) - MX) + (-_2bx * q4 + _2bz * q2) * (_2bx * (q2q3 - q1q4) + _2bz * (q1q2 + q3q4) - MY) + _2bx * q3 * (_2bx * (q1q3 + q2q4) + _2bz * (0.5f - q2q2 - q3q3) - MZ);
-	s2 = _2q4 * (2.0f * q2q4 - _2q1q3 - AX) + _2q1 * (2.0f * q1q2 + _2q3q4 - AY) - 4.0f * q2 * (1.0f - 2.0f * q2q2 - 2.0f * q3q3 - AZ) + _2bz * q4 * (_2bx * (0.5f - q3q3 - q4q4) + _2bz * (q2q4 - q1q3) - MX) + (_2bx * q3 + _2bz * q1) * (_2bx * (q2q3 - q1q4) + _2bz * (q1q2 + q3q4) - MY) + (_2bx * q4 - _4bz * q2) * (_2bx * (q1q3 + q2q4) + _2bz * (0.5f - q2q2 - q3q3) - MZ);
-	s3 = -_2q1 * (2.0f * q2q4 - _2q1q3 - AX) + _2q4 * (2.0f * q1q2 + _2q3q4 - AY) - 4.0f * q3 * (1.0f - 2.0f * q2q2 - 2.0f * q3q3 - AZ) + (-_4bx * q3 - _2bz * q1) * (_2bx * (0.5f - q3q3 - q4q4) + _2bz * (q2q4 - q1q3) - MX) + (_2bx * q2 + _2bz * q4) * (_2bx * (q2q3 - q1q4) + _2bz * (q1q2 + q3q4) - MY) + (_2bx * q1 - _4bz * q3) * (_2bx * (q1q3 + q2q4) + _2bz * (0.5f - q2q2 - q3q3) - MZ);
-	s4 = _2q2 * (2.0f * q2q4 - _2q1q3 - AX) + _2q3 * (2.0f * q1q2 + _2q3q4 - AY) + (-_4bx * q4 + _2bz * q2) * (_2bx * (0.5f - q3q3 - q4q4) + _2bz * (q2q4 - q1q3) - MX) + (-_2bx * q1 + _2bz * q3) * (_2bx * (q2q3 - q1q4) + _2bz * (q1q2 + q3q4) - MY) + _2bx * q2 * (_2bx * (q1q3 + q2q4) + _2bz * (0.5f - q2q2 - q3q3) - MZ);
+	QuartT<T> s = gradient(q, a, m, sqrt(h.x() * h.x() + h.y() * h.y()), h.z());
 
 	// normalise step magnitude
-	bool magOk = normalize(s1, s2, s3, s4);
+	bool magOk = normalize(s);
 	
 	// if magnetometer measurement is missing, then don't correct
 	if (!magOk)
 	{
-		s1 = 0.0f;
-		s2 = 0.0f;
-		s3 = 0.0f;
-		s4 = 0.0f;
+		s = QuartT<T>(T(), T(), T(), T());
+	}
+
+	// integrate rate of change of quaternion
+	q = q + (q * g * T(0.5f) - s * beta) * input.deltaT;
+
+	// normalise quaternion
+	if (!normalize(q))
+	{
+		return;
 	}
 
-	// compute rate of change of quaternion
-	qDot1 = 0.5f * (-q2 * GX - q3 * GY - q4 * GZ) - beta * s1;
-	qDot2 = 0.5f * ( q1 * GX + q3 * GZ - q4 * GY) - beta * s2;
-	qDot3 = 0.5f * ( q1 * GY - q2 * GZ + q4 * GX) - beta * s3;
-	qDot4 = 0.5f * ( q1 * GZ + q2 * GY - q3 * GX) - beta * s4;
+	quart = q;
+}
+
+template <typename T>
+void MadgwickQuaternionPredict(QuartT<T>& quart, FilterInputT<T> input)
+{
+	QuartT<T> q = quart;
+
+	const Vec3T<T> g(input.gx(), input.gy(), input.gz());
+
+	// integrate rate of change of quaternion, same order as hand expanded filter, see test/rewritetest.cpp
+	q = q + q * g * T(0.5f) * input.deltaT;
+
+	// normalise quaternion
+	if (!normalize(q))
+	{
+		return;
+	}
+
+	quart = q;
+}
+
+template <typename T>
+void MadgwickQuaternionCorrect(QuartT<T>& quart, FilterInputT<T> input, MadgwickReferenceT<T>& reference, bool magnFresh)
+{
+	QuartT<T> q = quart;
+
+	Vec3T<T> a(input.ax(), input.ay(), input.az());
+	Vec3T<T> m(input.mx(), input.my(), input.mz());
+
+	// normalise accelerometer measurement
+	if (!normalize(a))
+	{
+		return;
+	}
+
+	// normalise magnetometer measurement
+	if (!normalize(m))
+	{
+		return;
+	}
+
+	// reference direction of Earth's magnetic field, only changes with new magnetometer reading
+	if (magnFresh || !reference.valid)
+	{
+		const Vec3T<T> h = rotate(q, m);
+
+		reference._2bx = sqrt(h.x() * h.x() + h.y() * h.y());
+		reference._2bz = h.z();
+		reference.valid = true;
+	}
+
+	QuartT<T> s = gradient(q, a, m, reference._2bx, reference._2bz);
+
+	// normalise step magnitude, nothing to correct if it is zero
+	if (!normalize(s))
+	{
+		return;
+	}
+
+	// step against gradient for time elapsed since previous correction
+	q = q - s * (beta * input.deltaT);
+
+	// normalise quaternion
+	if (!normalize(q))
+	{
+		return;
+	}
+
+	quart = q;
+}
+
+template <typename T>
+void MadgwickQuaternionCorrectGravity(QuartT<T>& quart, FilterInputT<T> input)
+{
+	QuartT<T> q = quart;
+
+	Vec3T<T> a(input.ax(), input.ay(), input.az());
+
+	// normalise accelerometer measurement
+	if (!normalize(a))
+	{
+		return;
+	}
+
+	QuartT<T> s = gravityGradient(q, a);
+
+	// normalise step magnitude, nothing to correct if it is zero
+	if (!normalize(s))
+	{
+		return;
+	}
 
-	// integrate to yield quaternion
-	q1 += qDot1 * input.deltaT;
-	q2 += qDot2 * input.deltaT;
-	q3 += qDot3 * input.deltaT;
-	q4 += qDot4 * input.deltaT;
+	// step against gradient for time elapsed since previous correction
+	q = q - s * (beta * input.deltaT);
 
 	// normalise quaternion
-	if (!normalize(q1, q2, q3, q4))
+	if (!normalize(q))
 	{
 		return;
 	}
 
-	quart.q1() = q1;
-	quart.q2() = q2;
-	quart.q3() = q3;
-	quart.q4() = q4;
+	quart = q;
 }
 
-#undef AX
-#undef AY
-#undef AZ
-#undef GX
-#undef GY
-#undef GZ
-#undef MX
-#undef MY
-#undef MZ
+// Operation count per call, same for every scalar type, counted with a scalar type that counts:
+// update  ~190 multiplications, ~120 additions, 5 square roots, 4 divisions
+// predict  ~30 multiplications,  ~15 additions, 1 square root,  1 division
+// correct ~170 multiplications, ~105 additions, 5 square roots, 4 divisions,
+//         1 square root and ~40 multiplications less between magnetometer readings
+// correct gravity ~80 multiplications, ~45 additions, 3 square roots, 3 divisions
+
+template void MadgwickQuaternionUpdate(QuartT<float>&, FilterInputT<float>);
+template void MadgwickQuaternionPredict(QuartT<float>&, FilterInputT<float>);
+template void MadgwickQuaternionCorrect(QuartT<float>&, FilterInputT<float>, MadgwickReferenceT<float>&, bool);
+template void MadgwickQuaternionCorrectGravity(QuartT<float>&, FilterInputT<float>);
+
+template void MadgwickQuaternionUpdate(QuartT<double>&, FilterInputT<double>);
+template void MadgwickQuaternionPredict(QuartT<double>&, FilterInputT<double>);
+template void MadgwickQuaternionCorrect(QuartT<double>&, FilterInputT<double>, MadgwickReferenceT<double>&, bool);
+template void MadgwickQuaternionCorrectGravity(QuartT<double>&, FilterInputT<double>);
+
+template void MadgwickQuaternionUpdate(QuartT<Fixed<24>>&, FilterInputT<Fixed<24>>);
+template void MadgwickQuaternionPredict(QuartT<Fixed<24>>&, FilterInputT<Fixed<24>>);
+template void MadgwickQuaternionCorrect(QuartT<Fixed<24>>&, FilterInputT<Fixed<24>>, MadgwickReferenceT<Fixed<24>>&, bool);
+template void MadgwickQuaternionCorrectGravity(QuartT<Fixed<24>>&, FilterInputT<Fixed<24>>);
+
+#if defined(GY80_LANES)
+// for MadgwickQuaternionUpdateBatch()
+template void MadgwickQuaternionUpdate(QuartT<Lanes>&, FilterInputT<Lanes>);
+#endif
@@ -3,7 +3,57 @@
 
 #include "quart.h"
 #include "filterinput.h"
+#include "fixed.h"
 
-void MadgwickQuaternionUpdate(Quart& quart, FilterInput input);
+// Earth magnetic field direction, kept between magnetometer readings
+template <typename T>
+struct MadgwickReferenceT
+{
+	T _2bx;
+	T _2bz;
+	bool valid = false;
+};
+
+typedef MadgwickReferenceT<float> MadgwickReference;
+
+// Filter is instantiated for float, double and Fixed<24>.
+// Fixed<24> (Q7.24) holds gyro rates up to 2000 dps, magnetometer has to be given in Gauss rather than mG to fit.
+
+// complete filter step, gyro integration and gradient descent correction together
+template <typename T>
+void MadgwickQuaternionUpdate(QuartT<T>& quart, FilterInputT<T> input);
+
+// integrate gyroscope only, cheap enough to run at full gyro rate
+template <typename T>
+void MadgwickQuaternionPredict(QuartT<T>& quart, FilterInputT<T> input);
+
+// gradient descent correction with accelerometer and magnetometer, may run at lower rate than predict
+// deltaT is time since previous correction, reference is recomputed only for fresh magnetometer reading
+template <typename T>
+void MadgwickQuaternionCorrect(QuartT<T>& quart, FilterInputT<T> input, MadgwickReferenceT<T>& reference, bool magnFresh);
+
+// gradient descent correction with accelerometer only, magnetometer input is not used and heading is left to gyro
+template <typename T>
+void MadgwickQuaternionCorrectGravity(QuartT<T>& quart, FilterInputT<T> input);
+
+// fusion engine of gradient descent filter, see fusion.h
+template <typename T>
+class MadgwickEngineT
+{
+public:
+	void reset() { reference.valid = false; }
+
+	void predict(QuartT<T> & quart, FilterInputT<T> input) { MadgwickQuaternionPredict(quart, input); }
+
+	void correct(QuartT<T> & quart, FilterInputT<T> input, bool magnFresh)
+	{
+		MadgwickQuaternionCorrect(quart, input, reference, magnFresh);
+	}
+
+	void correctGravity(QuartT<T> & quart, FilterInputT<T> input) { MadgwickQuaternionCorrectGravity(quart, input); }
+
+protected:
+	MadgwickReferenceT<T> reference;
+};
 
 #endif
@@ -0,0 +1,80 @@
+#include "madgwickbatch.h"
+
+#include "madgwick.h"
+#include "lanes.h"
+
+static void updateOne(float * const q[4], const float * const input[9], const float * deltaT, size_t i)
+{
+	Quart quart;
+	quart.q1() = q[0][i];
+	quart.q2() = q[1][i];
+	quart.q3() = q[2][i];
+	quart.q4() = q[3][i];
+
+	FilterInput filterInput;
+
+	for (uint8_t k = 0; k < 9; ++k)
+	{
+		filterInput.values[k] = input[k][i];
+	}
+
+	filterInput.deltaT = deltaT[i];
+
+	MadgwickQuaternionUpdate(quart, filterInput);
+
+	q[0][i] = quart.q1();
+	q[1][i] = quart.q2();
+	q[2][i] = quart.q3();
+	q[3][i] = quart.q4();
+}
+
+void MadgwickQuaternionUpdateBatch(float * const q[4], const float * const input[9], const float * deltaT, size_t count)
+{
+	size_t i = 0;
+
+#if defined(GY80_LANES)
+	for (; i + GY80_LANES <= count; i += GY80_LANES)
+	{
+		FilterInputT<Lanes> filterInput;
+
+		for (uint8_t k = 0; k < 9; ++k)
+		{
+			filterInput.values[k] = Lanes::load(&input[k][i]);
+		}
+
+		filterInput.deltaT = Lanes::load(&deltaT[i]);
+
+		// unit without accelerometer or magnetometer direction leaves filter early, lanes can not, do such group one by one
+		const Lanes a = filterInput.ax() * filterInput.ax() + filterInput.ay() * filterInput.ay() + filterInput.az() * filterInput.az();
+		const Lanes m = filterInput.mx() * filterInput.mx() + filterInput.my() * filterInput.my() + filterInput.mz() * filterInput.mz();
+
+		if ((bits(positive(a)) & bits(positive(m))) != allLanes)
+		{
+			for (size_t j = i; j < i + GY80_LANES; ++j)
+			{
+				updateOne(q, input, deltaT, j);
+			}
+
+			continue;
+		}
+
+		QuartT<Lanes> quart;
+		quart.q1() = Lanes::load(&q[0][i]);
+		quart.q2() = Lanes::load(&q[1][i]);
+		quart.q3() = Lanes::load(&q[2][i]);
+		quart.q4() = Lanes::load(&q[3][i]);
+
+		MadgwickQuaternionUpdate(quart, filterInput);
+
+		quart.q1().store(&q[0][i]);
+		quart.q2().store(&q[1][i]);
+		quart.q3().store(&q[2][i]);
+		quart.q4().store(&q[3][i]);
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		updateOne(q, input, deltaT, i);
+	}
+}
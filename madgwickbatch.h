@@ -0,0 +1,15 @@
+#ifndef madgwickbatch_h_
+#define madgwickbatch_h_
+
+#include <stddef.h>
+
+// Advance count independent filters, e.g. logs of many units, with data as structure of arrays.
+// q holds four arrays of quaternion components updated in place,
+// input holds nine arrays ax, ay, az, gx, gy, gz, mx, my, mz, deltaT is one more array.
+// Runs GY80_LANES units per step when host has SSE or AVX, scalar MadgwickQuaternionUpdate() otherwise.
+// Lanes give same bits as scalar call for every unit, unless a step has gradient or quaternion so small
+// that its squared length is zero, scalar call then skips that part while lanes keep the tiny values,
+// difference is below float resolution of quaternion.
+void MadgwickQuaternionUpdateBatch(float * const q[4], const float * const input[9], const float * deltaT, size_t count);
+
+#endif
@@ -0,0 +1,137 @@
+#include "mahony.h"
+
+#include "madgwick.h"
+#include "mathhelp.h"
+
+// Gains of Mahony's "Nonlinear complementary filters on the special orthogonal group".
+// kp sets how fast accelerometer and magnetometer pull orientation, heading is pulled only by horizontal
+// part of magnetic field, so it needs high gain to settle within seconds. ki sets how fast gyro bias
+// is learned, zero turns integral feedback off.
+constexpr float kp = 10.0f;
+constexpr float ki = 0.05f;
+
+template <typename T>
+void MahonyEngineT<T>::reset()
+{
+	integral.e1() = 0.0f;
+	integral.e2() = 0.0f;
+	integral.e3() = 0.0f;
+	integral.e4() = 0.0f;
+
+	referenceValid = false;
+}
+
+template <typename T>
+void MahonyEngineT<T>::predict(QuartT<T> & quart, FilterInputT<T> input)
+{
+	input.gx() += integral.e1();
+	input.gy() += integral.e2();
+	input.gz() += integral.e3();
+
+	MadgwickQuaternionPredict(quart, input);
+}
+
+template <typename T>
+void MahonyEngineT<T>::correct(QuartT<T> & quart, FilterInputT<T> input, bool magnFresh)
+{
+	const T q1 = quart.q1(), q2 = quart.q2(), q3 = quart.q3(), q4 = quart.q4();
+
+	const T q1q1 = q1 * q1;
+	const T q1q2 = q1 * q2;
+	const T q1q3 = q1 * q3;
+	const T q1q4 = q1 * q4;
+	const T q2q2 = q2 * q2;
+	const T q2q3 = q2 * q3;
+	const T q2q4 = q2 * q4;
+	const T q3q3 = q3 * q3;
+	const T q3q4 = q3 * q4;
+	const T q4q4 = q4 * q4;
+
+	T ax = input.ax(), ay = input.ay(), az = input.az();
+	T mx = input.mx(), my = input.my(), mz = input.mz();
+
+	if (!normalize(ax, ay, az) || !normalize(mx, my, mz))
+	{
+		return;
+	}
+
+	// magnetic field in Earth frame, turned around vertical onto x axis
+	if (magnFresh || !referenceValid)
+	{
+		const T hx = 2.0f * (mx * (0.5f - q3q3 - q4q4) + my * (q2q3 - q1q4) + mz * (q2q4 + q1q3));
+		const T hy = 2.0f * (mx * (q2q3 + q1q4) + my * (0.5f - q2q2 - q4q4) + mz * (q3q4 - q1q2));
+
+		bx = sqrt(hx * hx + hy * hy);
+		bz = 2.0f * (mx * (q2q4 - q1q3) + my * (q1q2 + q3q4) + mz * (0.5f - q2q2 - q3q3));
+		referenceValid = true;
+	}
+
+	// estimated directions of gravity and magnetic field in sensor frame
+	const T vx = 2.0f * (q2q4 - q1q3);
+	const T vy = 2.0f * (q1q2 + q3q4);
+	const T vz = q1q1 - q2q2 - q3q3 + q4q4;
+	const T wx = 2.0f * (bx * (0.5f - q3q3 - q4q4) + bz * (q2q4 - q1q3));
+	const T wy = 2.0f * (bx * (q2q3 - q1q4) + bz * (q1q2 + q3q4));
+	const T wz = 2.0f * (bx * (q1q3 + q2q4) + bz * (0.5f - q2q2 - q3q3));
+
+	// error is cross product of measured and estimated directions
+	const T ex = (ay * vz - az * vy) + (my * wz - mz * wy);
+	const T ey = (az * vx - ax * vz) + (mz * wx - mx * wz);
+	const T ez = (ax * vy - ay * vx) + (mx * wy - my * wx);
+
+	feedback(quart, input, ex, ey, ez);
+}
+
+template <typename T>
+void MahonyEngineT<T>::correctGravity(QuartT<T> & quart, FilterInputT<T> input)
+{
+	const T q1 = quart.q1(), q2 = quart.q2(), q3 = quart.q3(), q4 = quart.q4();
+
+	T ax = input.ax(), ay = input.ay(), az = input.az();
+
+	if (!normalize(ax, ay, az))
+	{
+		return;
+	}
+
+	// estimated direction of gravity in sensor frame
+	const T vx = 2.0f * (q2 * q4 - q1 * q3);
+	const T vy = 2.0f * (q1 * q2 + q3 * q4);
+	const T vz = q1 * q1 - q2 * q2 - q3 * q3 + q4 * q4;
+
+	// error is cross product of measured and estimated directions, it has no part around vertical
+	const T ex = ay * vz - az * vy;
+	const T ey = az * vx - ax * vz;
+	const T ez = ax * vy - ay * vx;
+
+	feedback(quart, input, ex, ey, ez);
+}
+
+template <typename T>
+void MahonyEngineT<T>::feedback(QuartT<T> & quart, FilterInputT<T> input, T ex, T ey, T ez)
+{
+	if (ki > 0.0f)
+	{
+		const T kidt = T(ki) * input.deltaT;
+
+		integral.e1() += kidt * ex;
+		integral.e2() += kidt * ey;
+		integral.e3() += kidt * ez;
+	}
+
+	// turn at kp times error for time since previous correction
+	input.gx() = T(kp) * ex;
+	input.gy() = T(kp) * ey;
+	input.gz() = T(kp) * ez;
+
+	MadgwickQuaternionPredict(quart, input);
+}
+
+// Operation count per call, same for every scalar type:
+// predict  ~16 multiplications, ~19 additions, 1 square root, 1 division
+// correct  ~80 multiplications, ~60 additions, 3 square roots, 3 divisions, 1 square root less between magnetometer readings
+// correct gravity  ~55 multiplications, ~30 additions, 2 square roots, 2 divisions
+
+template class MahonyEngineT<float>;
+template class MahonyEngineT<double>;
+template class MahonyEngineT<Fixed<24>>;
@@ -0,0 +1,39 @@
+#ifndef mahony_h_
+#define mahony_h_
+
+#include "quart.h"
+#include "filterinput.h"
+#include "fixed.h"
+
+// Mahony's complementary filter as fusion engine, see fusion.h.
+// Error between measured and estimated directions of gravity and magnetic field turns orientation
+// with proportional gain, its integral is added to gyro rates and takes out slowly changing gyro bias.
+// Instantiated for float, double and Fixed<24>, magnetometer in Gauss like Madgwick.
+template <typename T>
+class MahonyEngineT
+{
+public:
+	void reset();
+
+	// integrate gyroscope with integral feedback
+	void predict(QuartT<T> & quart, FilterInputT<T> input);
+
+	// proportional step towards accelerometer and magnetometer over deltaT since previous correction
+	void correct(QuartT<T> & quart, FilterInputT<T> input, bool magnFresh);
+
+	// same with accelerometer only
+	void correctGravity(QuartT<T> & quart, FilterInputT<T> input);
+
+protected:
+	// integral feedback and proportional step for error of given size
+	void feedback(QuartT<T> & quart, FilterInputT<T> input, T ex, T ey, T ez);
+
+	ErrorIntegralT<T> integral; // e1 to e3 are rad/s added to gyro, e4 is not used
+
+	// Earth magnetic field, horizontal and vertical, only changes with new magnetometer reading
+	T bx;
+	T bz;
+	bool referenceValid = false;
+};
+
+#endif
@@ -2,16 +2,61 @@
 
 #include <math.h>
 
-bool normalize(float & a, float & b, float & c)
+float fastAtan2(float y, float x)
 {
-	float norm = sqrt(a * a + b * b + c * c);
+	const float ax = fabsf(x);
+	const float ay = fabsf(y);
+
+	if (ax == 0.0f && ay == 0.0f)
+	{
+		return 0.0f;
+	}
+
+	// atan of ratio in [0, 1], cubic fit from Rajan et al., "Efficient approximations for the arctangent function"
+	const bool swap = ay > ax;
+	const float r = swap ? ax / ay : ay / ax;
+
+	float a = (float)(PI / 4) * r - r * (r - 1.0f) * (0.2447f + 0.0663f * r);
+
+	if (swap)
+	{
+		a = (float)(PI / 2) - a;
+	}
+
+	if (x < 0.0f)
+	{
+		a = (float)PI - a;
+	}
+
+	return y < 0.0f ? -a : a;
+}
+
+float fastAsin(float x)
+{
+	const float ax = x < 0.0f ? -x : x;
+
+	if (ax >= 1.0f)
+	{
+		return x < 0.0f ? -(float)(PI / 2) : (float)(PI / 2);
+	}
+
+	// Abramowitz and Stegun 4.4.45
+	const float a = (float)(PI / 2) - sqrtf(1.0f - ax) * (1.5707288f + ax * (-0.2121144f + ax * (0.0742610f - 0.0187293f * ax)));
+
+	return x < 0.0f ? -a : a;
+}
+
+template <typename T>
+bool normalize(T & a, T & b, T & c)
+{
+	T norm = sqrt(a * a + b * b + c * c);
 	
-	if (!isgreater(norm, 0.0f))
+	if (!isgreater(norm, T(0)))
 	{
 		return false;
 	}
 	
-	norm = 1.0f / norm;
+	norm = T(1) / norm;
 	
 	a = a * norm;
 	b = b * norm;
@@ -20,16 +65,17 @@ bool normalize(float & a, float & b, float & c)
 	return true;
 }
 
-bool normalize(float & a, float & b, float & c, float & d)
+template <typename T>
+bool normalize(T & a, T & b, T & c, T & d)
 {
-	float norm = sqrt(a * a + b * b + c * c + d * d);
+	T norm = sqrt(a * a + b * b + c * c + d * d);
 	
-	if (!isgreater(norm, 0.0f))
+	if (!isgreater(norm, T(0)))
 	{
 		return false;
 	}
 	
-	norm = 1.0f / norm;
+	norm = T(1) / norm;
 	
 	a = a * norm;
 	b = b * norm;
@@ -38,3 +84,9 @@ bool normalize(float & a, float & b, float & c, float & d)
 	
 	return true;
 }
+
+template bool normalize(float & a, float & b, float & c);
+template bool normalize(float & a, float & b, float & c, float & d);
+
+template bool normalize(double & a, double & b, double & c);
+template bool normalize(double & a, double & b, double & c, double & d);
@@ -3,12 +3,93 @@
 
 #include <Arduino.h>
 
+#include "fixed.h"
+
 constexpr float deg2rad(float deg) { return deg * (float)DEG_TO_RAD; }
 constexpr float rad2deg(float rad) { return rad * (float)RAD_TO_DEG; }
 
 static_assert(123.0f == deg2rad(rad2deg(123.0f)), "Float error is too big");
 
-bool normalize(float & a, float & b, float & c);
-bool normalize(float & a, float & b, float & c, float & d);
+// Polynomial approximations for orientation output, no table and no division besides one in fastAtan2.
+// fastAtan2 is off by at most 0.0016 rad (0.09 degree), fastAsin by at most 0.00007 rad (0.004 degree).
+float fastAtan2(float y, float x);
+float fastAsin(float x);
+
+// instantiated for float and double
+template <typename T> bool normalize(T & a, T & b, T & c);
+template <typename T> bool normalize(T & a, T & b, T & c, T & d);
+
+// fixed point vector is first scaled by power of two to put largest component in [0.5, 1),
+// this keeps precision for short vectors and avoids overflow of squares for long ones
+template <uint8_t F>
+bool normalize(Fixed<F> * const * v, uint8_t n)
+{
+	uint32_t largest = 0;
+
+	for (uint8_t i = 0; i < n; ++i)
+	{
+		// unsigned, so magnitude of most negative value fits
+		const uint32_t m = v[i]->raw < 0 ? 0u - uint32_t(v[i]->raw) : uint32_t(v[i]->raw);
+
+		if (m > largest)
+		{
+			largest = m;
+		}
+	}
+
+	if (largest == 0)
+	{
+		return false;
+	}
+
+	int8_t shift = 0;
+
+	for (; largest >= uint32_t(Fixed<F>::one); largest >>= 1)
+	{
+		++shift;
+	}
+
+	for (; largest < uint32_t(Fixed<F>::one / 2); largest <<= 1)
+	{
+		--shift;
+	}
+
+	uint64_t sum = 0;
+
+	for (uint8_t i = 0; i < n; ++i)
+	{
+		int32_t & r = v[i]->raw;
+		// left shift of negative value is undefined, scaling up multiplies, result stays below one
+		r = shift > 0 ? r >> shift : r * (int32_t(1) << -shift);
+		sum += uint64_t(int64_t(r) * r);
+	}
+
+	// sum has 2F fraction bits, so its integer root has F
+	const int64_t norm = isqrt(sum);
+	const int64_t inv  = (int64_t(1) << (2 * F)) / norm;
+
+	for (uint8_t i = 0; i < n; ++i)
+	{
+		v[i]->raw = int32_t((v[i]->raw * inv) >> F);
+	}
+
+	return true;
+}
+
+template <uint8_t F>
+bool normalize(Fixed<F> & a, Fixed<F> & b, Fixed<F> & c)
+{
+	Fixed<F> * const v[3] { &a, &b, &c };
+
+	return normalize(v, 3);
+}
+
+template <uint8_t F>
+bool normalize(Fixed<F> & a, Fixed<F> & b, Fixed<F> & c, Fixed<F> & d)
+{
+	Fixed<F> * const v[4] { &a, &b, &c, &d };
+
+	return normalize(v, 4);
+}
 
 #endif
@@ -0,0 +1,185 @@
+#ifndef matrix_h_
+#define matrix_h_
+
+#include <stdint.h>
+
+// Small fixed size matrices for filters, sizes are template arguments so nothing is allocated.
+// Element loops go through Unroll, which expands them at compile time, so indices are constants
+// and every access is a fixed offset, no loop counters or index arithmetic are left at run time.
+
+// loop bodies have to be inlined, otherwise unrolling turns loop into calls, GCC does not inline lambdas of this size by itself
+#define UNROLLED __attribute__((always_inline))
+
+// calls f(0), f(1) ... f(N - 1)
+template <uint8_t N>
+struct Unroll
+{
+	template <class F>
+	UNROLLED static void each(F f)
+	{
+		Unroll<N - 1>::each(f);
+		f(uint8_t(N - 1));
+	}
+};
+
+template <>
+struct Unroll<0>
+{
+	template <class F>
+	UNROLLED static void each(F) {}
+};
+
+template <typename T, uint8_t N>
+struct Vector
+{
+	T & operator [] (uint8_t i) { return v[i]; }
+	const T & operator [] (uint8_t i) const { return v[i]; }
+
+	void clear() { Unroll<N>::each([&](uint8_t i) UNROLLED { v[i] = T(); }); }
+
+	T v[N];
+};
+
+template <typename T, uint8_t R, uint8_t C>
+struct Matrix
+{
+	T & operator () (uint8_t r, uint8_t c) { return m[r][c]; }
+	const T & operator () (uint8_t r, uint8_t c) const { return m[r][c]; }
+
+	void identity()
+	{
+		Unroll<R>::each([&](uint8_t r) UNROLLED
+		{
+			Unroll<C>::each([&](uint8_t c) UNROLLED { m[r][c] = r == c ? T(1.0f) : T(); });
+		});
+	}
+
+	T m[R][C];
+};
+
+// Symmetric N x N matrix, e.g. covariance, only upper triangle is stored, row after row.
+// (r, c) and (c, r) are the same element, so symmetry holds by construction and never drifts.
+template <typename T, uint8_t N>
+struct Symmetric
+{
+	static_assert(N >= 1 && N <= 22, "Packed index must fit 8 bits");
+
+	static constexpr uint8_t size = N * (N + 1) / 2;
+
+	// row r starts after N + (N - 1) + ... + (N - r + 1) elements, lower triangle is read as upper
+	static constexpr uint8_t index(uint8_t r, uint8_t c)
+	{
+		return r <= c ? r * N - r * (r - 1) / 2 + c - r : c * N - c * (c - 1) / 2 + r - c;
+	}
+
+	T & operator () (uint8_t r, uint8_t c) { return s[index(r, c)]; }
+	const T & operator () (uint8_t r, uint8_t c) const { return s[index(r, c)]; }
+
+	void diagonal(const T * d)
+	{
+		Unroll<N>::each([&](uint8_t r) UNROLLED
+		{
+			Unroll<N>::each([&](uint8_t c) UNROLLED
+			{
+				if (c >= r)
+				{
+					s[index(r, c)] = r == c ? d[r] : T();
+				}
+			});
+		});
+	}
+
+	void addDiagonal(const T * d)
+	{
+		Unroll<N>::each([&](uint8_t i) UNROLLED { s[index(i, i)] += d[i]; });
+	}
+
+	T s[size];
+};
+
+// p = a p a', e.g. covariance through state transition, only upper triangle of result is computed
+template <typename T, uint8_t N>
+void sandwich(Symmetric<T, N> & p, const Matrix<T, N, N> & a)
+{
+	Matrix<T, N, N> ap;
+
+	Unroll<N>::each([&](uint8_t r) UNROLLED
+	{
+		Unroll<N>::each([&](uint8_t c) UNROLLED
+		{
+			T sum = T();
+			Unroll<N>::each([&](uint8_t k) UNROLLED { sum += a(r, k) * p(k, c); });
+			ap(r, c) = sum;
+		});
+	});
+
+	Unroll<N>::each([&](uint8_t r) UNROLLED
+	{
+		Unroll<N>::each([&](uint8_t c) UNROLLED
+		{
+			if (c >= r)
+			{
+				T sum = T();
+				Unroll<N>::each([&](uint8_t k) UNROLLED { sum += ap(r, k) * a(c, k); });
+				p(r, c) = sum;
+			}
+		});
+	});
+}
+
+// Kalman update of error state x and covariance p with one scalar measurement of given variance.
+// Row h of measurement matrix is nonzero only in its first M columns, the rest is skipped.
+// residual is measured minus predicted without x, correction already in x is taken out,
+// so several scalar updates in a row act as one vector update with diagonal noise, without matrix inverse.
+// p - k h p is a rank one downdate, computed on upper triangle only.
+// Return false if innovation variance is not positive, nothing is changed then.
+template <uint8_t M, typename T, uint8_t N>
+bool scalarUpdate(Symmetric<T, N> & p, Vector<T, N> & x, const T (&h)[M], T variance, T residual)
+{
+	static_assert(M >= 1 && M <= N, "Measurement row longer than state");
+
+	// p h'
+	T ph[N];
+
+	Unroll<N>::each([&](uint8_t r) UNROLLED
+	{
+		T sum = T();
+		Unroll<M>::each([&](uint8_t c) UNROLLED { sum += p(r, c) * h[c]; });
+		ph[r] = sum;
+	});
+
+	T s = variance;
+	T innovation = residual;
+
+	Unroll<M>::each([&](uint8_t c) UNROLLED
+	{
+		s += h[c] * ph[c];
+		innovation -= h[c] * x[c];
+	});
+
+	if (!(s > T()))
+	{
+		return false;
+	}
+
+	const T inverse = T(1.0f) / s;
+
+	Unroll<N>::each([&](uint8_t r) UNROLLED
+	{
+		const T k = ph[r] * inverse;
+
+		x[r] += k * innovation;
+
+		Unroll<N>::each([&](uint8_t c) UNROLLED
+		{
+			if (c >= r)
+			{
+				p(r, c) -= k * ph[c];
+			}
+		});
+	});
+
+	return true;
+}
+
+#endif
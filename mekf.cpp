@@ -0,0 +1,216 @@
+#include "mekf.h"
+
+#include "madgwick.h"
+#include "mathhelp.h"
+
+// Noise as standard deviations, continuous ones per square root of second.
+// Gyro noise covers more than L3G4200D white noise, it stands for scale and alignment errors as well.
+constexpr float gyroNoise = deg2rad(0.5f);		// rad/s/sqrt(s)
+constexpr float biasWalk = deg2rad(0.02f);		// rad/s/sqrt(s)
+// directions are unit vectors, noise includes vibration and acceleration of motion
+constexpr float acelNoise = 0.05f;
+constexpr float magnNoise = 0.05f;
+
+// uncertainty after reset, orientation is unknown and gyro bias is already calibrated to a few degrees per second
+constexpr float initialAttitude = 1.0f;			// rad
+constexpr float initialBias = deg2rad(2.0f);	// rad/s
+
+// row of cross product matrix [v x], so [v x] e is v x e
+template <typename T>
+static void crossRow(const T * v, uint8_t row, T (&h)[3])
+{
+	h[row] = T();
+	h[(row + 1) % 3] = -v[(row + 2) % 3];
+	h[(row + 2) % 3] = v[(row + 1) % 3];
+}
+
+template <typename T>
+void MekfEngineT<T>::reset()
+{
+	const T variance[6]
+	{
+		T(initialAttitude * initialAttitude), T(initialAttitude * initialAttitude), T(initialAttitude * initialAttitude),
+		T(initialBias * initialBias), T(initialBias * initialBias), T(initialBias * initialBias),
+	};
+
+	covariance.diagonal(variance);
+
+	gyroBias[0] = 0.0f;
+	gyroBias[1] = 0.0f;
+	gyroBias[2] = 0.0f;
+
+	referenceValid = false;
+}
+
+template <typename T>
+void MekfEngineT<T>::predict(QuartT<T> & quart, FilterInputT<T> input)
+{
+	input.gx() -= gyroBias[0];
+	input.gy() -= gyroBias[1];
+	input.gz() -= gyroBias[2];
+
+	MadgwickQuaternionPredict(quart, input);
+
+	// error transition to first order, attitude error turns against rotation and grows with bias error
+	const T dt = input.deltaT;
+	const T wx = input.gx() * dt, wy = input.gy() * dt, wz = input.gz() * dt;
+
+	Matrix<T, 6, 6> f;
+	f.identity();
+
+	f(0, 1) =  wz;
+	f(0, 2) = -wy;
+	f(1, 0) = -wz;
+	f(1, 2) =  wx;
+	f(2, 0) =  wy;
+	f(2, 1) = -wx;
+
+	f(0, 3) = -dt;
+	f(1, 4) = -dt;
+	f(2, 5) = -dt;
+
+	sandwich(covariance, f);
+
+	const T g = T(gyroNoise * gyroNoise) * dt;
+	const T b = T(biasWalk * biasWalk) * dt;
+	const T noise[6] { g, g, g, b, b, b };
+
+	covariance.addDiagonal(noise);
+}
+
+template <typename T>
+void MekfEngineT<T>::correct(QuartT<T> & quart, FilterInputT<T> input, bool magnFresh)
+{
+	const T q1 = quart.q1(), q2 = quart.q2(), q3 = quart.q3(), q4 = quart.q4();
+
+	T a[3] { input.ax(), input.ay(), input.az() };
+	T m[3] { input.mx(), input.my(), input.mz() };
+
+	if (!normalize(a[0], a[1], a[2]) || !normalize(m[0], m[1], m[2]))
+	{
+		return;
+	}
+
+	// rotation from sensor to Earth frame
+	const T r00 = 1.0f - 2.0f * (q3 * q3 + q4 * q4);
+	const T r01 = 2.0f * (q2 * q3 - q1 * q4);
+	const T r02 = 2.0f * (q2 * q4 + q1 * q3);
+	const T r10 = 2.0f * (q2 * q3 + q1 * q4);
+	const T r11 = 1.0f - 2.0f * (q2 * q2 + q4 * q4);
+	const T r12 = 2.0f * (q3 * q4 - q1 * q2);
+	const T r20 = 2.0f * (q2 * q4 - q1 * q3);
+	const T r21 = 2.0f * (q3 * q4 + q1 * q2);
+	const T r22 = 1.0f - 2.0f * (q2 * q2 + q3 * q3);
+
+	// magnetic field in Earth frame, turned around vertical onto x axis
+	if (magnFresh || !referenceValid)
+	{
+		const T hx = r00 * m[0] + r01 * m[1] + r02 * m[2];
+		const T hy = r10 * m[0] + r11 * m[1] + r12 * m[2];
+
+		bx = sqrt(hx * hx + hy * hy);
+		bz = r20 * m[0] + r21 * m[1] + r22 * m[2];
+		referenceValid = true;
+	}
+
+	// predicted directions of gravity and magnetic field in sensor frame
+	const T v[3] { r20, r21, r22 };
+	const T w[3] { bx * r00 + bz * r20, bx * r01 + bz * r21, bx * r02 + bz * r22 };
+
+	// measured direction is predicted one turned by attitude error e, to first order v + v x e
+	Vector<T, 6> x;
+	x.clear();
+
+	Unroll<3>::each([&](uint8_t i) UNROLLED
+	{
+		T h[3];
+
+		crossRow(v, i, h);
+		scalarUpdate(covariance, x, h, T(acelNoise * acelNoise), a[i] - v[i]);
+	});
+
+	Unroll<3>::each([&](uint8_t i) UNROLLED
+	{
+		T h[3];
+
+		crossRow(w, i, h);
+		scalarUpdate(covariance, x, h, T(magnNoise * magnNoise), m[i] - w[i]);
+	});
+
+	apply(quart, x);
+}
+
+template <typename T>
+void MekfEngineT<T>::correctGravity(QuartT<T> & quart, FilterInputT<T> input)
+{
+	const T q1 = quart.q1(), q2 = quart.q2(), q3 = quart.q3(), q4 = quart.q4();
+
+	T a[3] { input.ax(), input.ay(), input.az() };
+
+	if (!normalize(a[0], a[1], a[2]))
+	{
+		return;
+	}
+
+	// predicted direction of gravity in sensor frame, bottom row of rotation from sensor to Earth frame
+	const T v[3]
+	{
+		2.0f * (q2 * q4 - q1 * q3),
+		2.0f * (q3 * q4 + q1 * q2),
+		1.0f - 2.0f * (q2 * q2 + q3 * q3),
+	};
+
+	Vector<T, 6> x;
+	x.clear();
+
+	Unroll<3>::each([&](uint8_t i) UNROLLED
+	{
+		T h[3];
+
+		crossRow(v, i, h);
+		scalarUpdate(covariance, x, h, T(acelNoise * acelNoise), a[i] - v[i]);
+	});
+
+	apply(quart, x);
+}
+
+template <typename T>
+void MekfEngineT<T>::apply(QuartT<T> & quart, const Vector<T, 6> & x)
+{
+	T q1 = quart.q1(), q2 = quart.q2(), q3 = quart.q3(), q4 = quart.q4();
+
+	// fold attitude error into quaternion, q * (1, e / 2), and bias error into bias
+	const T ex = 0.5f * x[0], ey = 0.5f * x[1], ez = 0.5f * x[2];
+
+	const T p1 = q1 - q2 * ex - q3 * ey - q4 * ez;
+	const T p2 = q2 + q1 * ex + q3 * ez - q4 * ey;
+	const T p3 = q3 + q1 * ey - q2 * ez + q4 * ex;
+	const T p4 = q4 + q1 * ez + q2 * ey - q3 * ex;
+
+	q1 = p1;
+	q2 = p2;
+	q3 = p3;
+	q4 = p4;
+
+	if (!normalize(q1, q2, q3, q4))
+	{
+		return;
+	}
+
+	quart.q1() = q1;
+	quart.q2() = q2;
+	quart.q3() = q3;
+	quart.q4() = q4;
+
+	gyroBias[0] += x[3];
+	gyroBias[1] += x[4];
+	gyroBias[2] += x[5];
+}
+
+// Operation count per call, float or double:
+// predict  ~360 multiplications, ~340 additions, 1 square root, 1 division
+// correct  ~390 multiplications, ~360 additions, 4 square roots, 9 divisions, 1 square root less between magnetometer readings
+// correct gravity  ~210 multiplications, ~180 additions, 2 square roots, 5 divisions
+
+template class MekfEngineT<float>;
+template class MekfEngineT<double>;
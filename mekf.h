@@ -0,0 +1,46 @@
+#ifndef mekf_h_
+#define mekf_h_
+
+#include "quart.h"
+#include "filterinput.h"
+#include "matrix.h"
+
+// Multiplicative extended Kalman filter as fusion engine, see fusion.h.
+// Quaternion is kept outside the filter, Kalman state is small attitude error in sensor frame
+// and gyro bias error, so covariance is 6 x 6 and quaternion stays unit length.
+// Accelerometer and magnetometer axes are folded in as six scalar updates, no matrix is inverted.
+// Instantiated for float and double, covariance is too small for fixed point.
+template <typename T>
+class MekfEngineT
+{
+public:
+	void reset();
+
+	// integrate bias corrected gyroscope and propagate covariance
+	void predict(QuartT<T> & quart, FilterInputT<T> input);
+
+	// Kalman update with accelerometer and magnetometer directions
+	void correct(QuartT<T> & quart, FilterInputT<T> input, bool magnFresh);
+
+	// Kalman update with accelerometer direction only, heading error is left unobserved
+	void correctGravity(QuartT<T> & quart, FilterInputT<T> input);
+
+	// estimated gyro bias, rad/s
+	T bias(uint8_t axis) const { return gyroBias[axis]; }
+
+protected:
+	// fold estimated error state into quaternion and gyro bias
+	void apply(QuartT<T> & quart, const Vector<T, 6> & x);
+
+	// attitude error 0 to 2, rad, then gyro bias error 3 to 5, rad/s
+	Symmetric<T, 6> covariance;
+
+	T gyroBias[3];
+
+	// Earth magnetic field, horizontal and vertical, unit length, only changes with new magnetometer reading
+	T bx;
+	T bz;
+	bool referenceValid = false;
+};
+
+#endif
@@ -0,0 +1,62 @@
+#include "motiongate.h"
+
+void MotionGate::enable()
+{
+	on = true;
+	current = MOTION_ACTIVE;
+}
+
+MotionAction MotionGate::events(uint32_t now, bool activity, bool inactivity)
+{
+	if (!on)
+	{
+		return MOTION_NONE;
+	}
+
+	if (activity)
+	{
+		if (current != MOTION_INACTIVE)
+		{
+			return MOTION_NONE;
+		}
+
+		current = MOTION_WAKING;
+		wokeAt = now;
+
+		return MOTION_WAKE;
+	}
+
+	if (inactivity && current == MOTION_ACTIVE)
+	{
+		current = MOTION_INACTIVE;
+		++sleepCount;
+
+		return MOTION_SLEEP;
+	}
+
+	return MOTION_NONE;
+}
+
+void MotionGate::gyroSample(uint32_t now)
+{
+	if (current != MOTION_WAKING)
+	{
+		return;
+	}
+
+	current = MOTION_ACTIVE;
+	latency = now - wokeAt;
+
+	if (latency > latencyMax)
+	{
+		latencyMax = latency;
+	}
+}
+
+void MotionGate::snapshotBias(const float * bias)
+{
+	for (uint8_t i = 0; i < 3; ++i)
+	{
+		biasSnapshot[i] = bias[i];
+	}
+}
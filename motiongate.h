@@ -0,0 +1,63 @@
+#ifndef motiongate_h_
+#define motiongate_h_
+
+#include <stdint.h>
+
+enum MotionState : uint8_t
+{
+	MOTION_ACTIVE = 0,	// full rate, every sensor on
+	MOTION_INACTIVE,	// gyro and magnetometer off, filter skipped as board is still
+	MOTION_WAKING,		// motion seen, waiting for first gyro sample
+};
+
+enum MotionAction : uint8_t
+{
+	MOTION_NONE = 0,
+	MOTION_SLEEP,	// power sensors down
+	MOTION_WAKE,	// power sensors up
+};
+
+// Decides when board sleeps and wakes from activity and inactivity events of accelerometer motion engine.
+// Only keeps time and state, caller powers sensors, so a host harness can drive it with scripted events.
+// Times are micros(), wrap around is fine.
+class MotionGate
+{
+public:
+	MotionGate() = default;
+
+	void enable();
+	bool enabled() const { return on; }
+
+	// Events reported by accelerometer at given time, return what to do with sensors.
+	// Activity wins when both come at once, waking too often is cheaper than missing motion.
+	MotionAction events(uint32_t now, bool activity, bool inactivity);
+
+	// gyro reading arrived, ends waking
+	void gyroSample(uint32_t now);
+
+	MotionState state() const { return current; }
+
+	// from activity event to first gyro sample of latest wake, microseconds
+	uint32_t wakeLatency() const { return latency; }
+	uint32_t wakeLatencyMax() const { return latencyMax; }
+
+	uint32_t sleeps() const { return sleepCount; }
+
+	// gyro bias when board went to sleep, rad/s, board was still long enough to learn it well
+	void snapshotBias(const float * bias);
+	const float * bias() const { return biasSnapshot; }
+
+protected:
+	bool on = false;
+	MotionState current = MOTION_ACTIVE;
+
+	uint32_t wokeAt = 0;
+
+	uint32_t latency = 0;
+	uint32_t latencyMax = 0;
+	uint32_t sleepCount = 0;
+
+	float biasSnapshot[3] = { 0.0f, 0.0f, 0.0f };
+};
+
+#endif
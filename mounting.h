@@ -0,0 +1,136 @@
+#ifndef mounting_h_
+#define mounting_h_
+
+#include <stdint.h>
+
+// Sensor axis that becomes a board axis, negative ones are flipped.
+enum Axis : int8_t
+{
+	AXIS_NZ = -3,
+	AXIS_NY = -2,
+	AXIS_NX = -1,
+	AXIS_X  =  1,
+	AXIS_Y  =  2,
+	AXIS_Z  =  3,
+};
+
+// sensor axis index 1..3, 0 if not an axis
+constexpr int8_t axisIndex(Axis a)
+{
+	return a >= AXIS_NZ && a <= AXIS_Z ? (a < 0 ? -a : a) : 0;
+}
+
+// 1 for a rotation, -1 for a mirror, 0 if some sensor axis is used twice or not at all
+constexpr int8_t axisHandedness(Axis x, Axis y, Axis z)
+{
+	const int8_t i = axisIndex(x), j = axisIndex(y), k = axisIndex(z);
+
+	if (i == 0 || j == 0 || k == 0 || i == j || j == k || i == k)
+	{
+		return 0;
+	}
+
+	// determinant of signed permutation matrix is product of signs and parity, cyclic orders xyz, yzx, zxy are even
+	const int8_t sign = (x < 0 ? -1 : 1) * (y < 0 ? -1 : 1) * (z < 0 ? -1 : 1);
+
+	return i % 3 + 1 == j ? sign : -sign;
+}
+
+// number of axis triples that are rotations
+constexpr int8_t axisRotations()
+{
+	int8_t n = 0;
+
+	for (int8_t x = AXIS_NZ; x <= AXIS_Z; ++x)
+		for (int8_t y = AXIS_NZ; y <= AXIS_Z; ++y)
+			for (int8_t z = AXIS_NZ; z <= AXIS_Z; ++z)
+				n += axisHandedness(Axis(x), Axis(y), Axis(z)) == 1 ? 1 : 0;
+
+	return n;
+}
+
+// every way to put a box on a table, 6 faces down times 4 headings
+static_assert(axisRotations() == 24, "Axis aligned mountings must be the 24 rotations of a cube");
+
+// Axis aligned mounting, board axis x is sensor axis X and so on, e.g. AxisMap<AXIS_Y, AXIS_NX, AXIS_Z>
+// is sensor turned 90 degrees clockwise around z, seen from above. Only rotations are accepted, a mirror
+// would make the sensor left handed. Axes are picked at compile time, so a permutation costs
+// no instructions and a flip costs one negation.
+template <Axis X = AXIS_X, Axis Y = AXIS_Y, Axis Z = AXIS_Z>
+struct AxisMap
+{
+	static_assert(axisHandedness(X, Y, Z) != 0, "Every sensor axis must be used exactly once");
+	static_assert(axisHandedness(X, Y, Z) == 1, "Mounting must be a rotation, not a mirror");
+
+	// element of rotation matrix from sensor to board frame
+	static constexpr int8_t at(uint8_t row, uint8_t col)
+	{
+		return pick(row == 0 ? X : row == 1 ? Y : Z, col);
+	}
+
+	// in place, from sensor to board frame
+	template <typename T>
+	static void apply(T * v)
+	{
+		const T s[3] { v[0], v[1], v[2] };
+
+		v[0] = take(s, X);
+		v[1] = take(s, Y);
+		v[2] = take(s, Z);
+	}
+
+protected:
+	static constexpr int8_t pick(Axis a, uint8_t col)
+	{
+		return a == col + 1 ? 1 : a == -(col + 1) ? -1 : 0;
+	}
+
+	template <typename T>
+	static T take(const T * s, Axis a)
+	{
+		return a > 0 ? s[a - 1] : negate(s[-a - 1]);
+	}
+
+	static float negate(float v) { return -v; }
+
+	// full scale negative reading has no positive counterpart, it saturates
+	static int16_t negate(int16_t v) { return v == INT16_MIN ? INT16_MAX : int16_t(-v); }
+};
+
+// General fixed mounting, e.g. sensor tilted on its board.
+// Matrix has static constexpr float at(uint8_t row, uint8_t col), the rotation from sensor to board frame.
+// Costs full matrix multiply, so prefer AxisMap when mounting is axis aligned.
+template <class Matrix>
+struct MountRotation
+{
+	static constexpr float at(uint8_t row, uint8_t col) { return Matrix::at(row, col); }
+
+	static void apply(float * v)
+	{
+		const float s[3] { v[0], v[1], v[2] };
+
+		for (uint8_t i = 0; i < 3; ++i)
+		{
+			v[i] = at(i, 0) * s[0] + at(i, 1) * s[1] + at(i, 2) * s[2];
+		}
+	}
+
+	// rounded to nearest and saturated, rotated vector can be longer along an axis than any raw one
+	static void apply(int16_t * v)
+	{
+		float f[3] { float(v[0]), float(v[1]), float(v[2]) };
+
+		apply(f);
+
+		for (uint8_t i = 0; i < 3; ++i)
+		{
+			const float r = f[i] < 0.0f ? f[i] - 0.5f : f[i] + 0.5f;
+
+			v[i] = r >= INT16_MAX ? INT16_MAX : r <= INT16_MIN ? INT16_MIN : int16_t(r);
+		}
+	}
+};
+
+typedef AxisMap<> NoMounting;
+
+#endif
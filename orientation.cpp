@@ -0,0 +1,81 @@
+#include "orientation.h"
+
+#include "mathhelp.h"
+
+#include <math.h>
+
+#if defined(GY80_FAST_TRIG)
+#define ORIENTATION_ATAN2 fastAtan2
+#define ORIENTATION_ASIN  fastAsin
+#else
+#define ORIENTATION_ATAN2 atan2f
+#define ORIENTATION_ASIN  asinf
+#endif
+
+Orientation::Orientation(const Quart & q, const float * acel, float declination) :
+	q(q),
+	declination(declination),
+	state(true)
+{
+	this->acel[0] = acel[0];
+	this->acel[1] = acel[1];
+	this->acel[2] = acel[2];
+}
+
+const float * Orientation::rotation()
+{
+	if (!(cached & CACHED_ROTATION))
+	{
+		const float q1 = q.q1(), q2 = q.q2(), q3 = q.q3(), q4 = q.q4();
+
+		const float q1q1 = q1 * q1, q2q2 = q2 * q2, q3q3 = q3 * q3, q4q4 = q4 * q4;
+
+		matrix[0] = q1q1 + q2q2 - q3q3 - q4q4;
+		matrix[1] = 2.0f * (q2 * q3 - q1 * q4);
+		matrix[2] = 2.0f * (q2 * q4 + q1 * q3);
+
+		matrix[3] = 2.0f * (q2 * q3 + q1 * q4);
+		matrix[4] = q1q1 - q2q2 + q3q3 - q4q4;
+		matrix[5] = 2.0f * (q3 * q4 - q1 * q2);
+
+		matrix[6] = 2.0f * (q2 * q4 - q1 * q3);
+		matrix[7] = 2.0f * (q1 * q2 + q3 * q4);
+		matrix[8] = q1q1 - q2q2 - q3q3 + q4q4;
+
+		cached |= CACHED_ROTATION;
+	}
+
+	return matrix;
+}
+
+const float * Orientation::euler()
+{
+	if (!(cached & CACHED_EULER))
+	{
+		const float * r = rotation();
+
+		angles[0] = rad2deg(ORIENTATION_ATAN2(r[3], r[0])) - declination;
+		angles[1] = rad2deg(-ORIENTATION_ASIN(r[6]));
+		angles[2] = rad2deg(ORIENTATION_ATAN2(r[7], r[8]));
+
+		cached |= CACHED_EULER;
+	}
+
+	return angles;
+}
+
+const float * Orientation::linearAcceleration()
+{
+	if (!(cached & CACHED_LINEAR))
+	{
+		const float * g = gravity();
+
+		linear[0] = acel[0] - g[0];
+		linear[1] = acel[1] - g[1];
+		linear[2] = acel[2] - g[2];
+
+		cached |= CACHED_LINEAR;
+	}
+
+	return linear;
+}
@@ -0,0 +1,65 @@
+#ifndef orientation_h_
+#define orientation_h_
+
+#include <stdint.h>
+
+#include "quart.h"
+
+// Result of one filter update. Quaternion is there right away, everything else is computed on first request and kept.
+// Define GY80_FAST_TRIG to get Euler angles from fastAtan2()/fastAsin() instead of libm.
+class Orientation
+{
+public:
+	// not ok, no update happened
+	Orientation() : state(false) {}
+
+	// acel is latest accelerometer reading in G, declination in degrees is subtracted from yaw
+	Orientation(const Quart & q, const float * acel, float declination);
+
+	bool & ok() { return state; }
+
+	Quart & quart() { return q; }
+
+	// Tait-Bryan angles in degrees, positive z-axis is down toward Earth.
+	// Yaw is angle between sensor x-axis and Earth magnetic North, or true North with declination set.
+	// Pitch is angle between sensor x-axis and Earth ground plane, toward the Earth is positive.
+	// Roll is angle between sensor y-axis and Earth ground plane, y-axis up is positive roll.
+	// Applied in order yaw, pitch, roll, see http://en.wikipedia.org/wiki/Conversion_between_quaternions_and_Euler_angles
+	float yaw()   { return euler()[0]; }
+	float pitch() { return euler()[1]; }
+	float roll()  { return euler()[2]; }
+	const float * euler();
+
+	// row major 3x3, rotates sensor frame vectors into Earth frame
+	const float * rotation();
+
+	// gravity direction in sensor frame, G, same as what accelerometer reads at rest
+	const float * gravity() { return rotation() + 6; }
+
+	// accelerometer reading without gravity, G, sensor frame
+	const float * linearAcceleration();
+
+	// accelerometer reading as given, G, sensor frame
+	const float * acceleration() const { return acel; }
+
+protected:
+	enum : uint8_t
+	{
+		CACHED_ROTATION = 0x01,
+		CACHED_EULER    = 0x02,
+		CACHED_LINEAR   = 0x04,
+	};
+
+	Quart q;
+	float acel[3];
+	float declination;
+
+	uint8_t cached = 0;
+	bool state;
+
+	float matrix[9];
+	float angles[3];
+	float linear[3];
+};
+
+#endif
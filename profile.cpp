@@ -0,0 +1,112 @@
+#include "profile.h"
+
+#include <stdio.h>
+
+static const char * const stageNames[PROFILE_STAGES]
+{
+	"sense",
+	"acel",
+	"gyro",
+	"magn",
+	"filter",
+	"euler",
+	"calibration",
+};
+
+void StageStats::add(uint32_t cycles)
+{
+	++count;
+	sum += cycles;
+
+	if (cycles < min)
+	{
+		min = cycles;
+	}
+
+	if (cycles > max)
+	{
+		max = cycles;
+	}
+
+	// highest set bit, single CLZ instruction on Cortex-M3 and up
+	const uint8_t bit = cycles != 0 ? 31 - __builtin_clz(cycles) : 0;
+
+	++buckets[bit];
+}
+
+void StageStats::clear()
+{
+	*this = StageStats();
+}
+
+uint32_t StageStats::percentile(uint8_t p) const
+{
+	if (count == 0)
+	{
+		return 0;
+	}
+
+	const uint64_t wanted = (uint64_t(count) * p + 99) / 100;
+	uint64_t seen = 0;
+
+	for (uint8_t i = 0; i < 32; ++i)
+	{
+		seen += buckets[i];
+
+		if (seen >= wanted)
+		{
+			// bucket bound, but never beyond what was actually seen
+			const uint32_t bound = i < 31 ? (uint32_t(2) << i) - 1 : UINT32_MAX;
+			return bound < max ? bound : max;
+		}
+	}
+
+	return max;
+}
+
+void Profiler::clear()
+{
+	for (uint8_t i = 0; i < PROFILE_STAGES; ++i)
+	{
+		stats[i].clear();
+	}
+}
+
+size_t Profiler::report(char * buffer, size_t size) const
+{
+	size_t used = 0;
+
+	// keep counting when buffer is full, like snprintf, so caller learns needed size
+	auto put = [&](int n)
+	{
+		if (n > 0)
+		{
+			used += n;
+		}
+	};
+
+	auto rest = [&]() { return used < size ? size - used : 0; };
+	auto at   = [&]() { return used < size ? buffer + used : nullptr; };
+
+	put(snprintf(at(), rest(), "stage,count,min,mean,p50,p90,p99,max,per_second\n"));
+
+	for (uint8_t i = 0; i < PROFILE_STAGES; ++i)
+	{
+		const StageStats & s = stats[i];
+		const uint32_t mean = s.count != 0 ? uint32_t(s.sum / s.count) : 0;
+		const uint32_t perSecond = mean != 0 ? cyclesPerSecond / mean : 0;
+
+		put(snprintf(at(), rest(), "%s,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu\n",
+			stageNames[i],
+			(unsigned long)s.count,
+			(unsigned long)(s.count != 0 ? s.min : 0),
+			(unsigned long)mean,
+			(unsigned long)s.percentile(50),
+			(unsigned long)s.percentile(90),
+			(unsigned long)s.percentile(99),
+			(unsigned long)s.max,
+			(unsigned long)perSecond));
+	}
+
+	return used;
+}
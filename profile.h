@@ -0,0 +1,79 @@
+#ifndef profile_h_
+#define profile_h_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "cyclecount.h"
+
+// Running statistics of one stage in cycles.
+// Percentiles come from power of two buckets, so they are upper bounds within factor of two.
+struct StageStats
+{
+	void add(uint32_t cycles);
+	void clear();
+
+	// smallest bucket bound that has at least p percent of samples below it
+	uint32_t percentile(uint8_t p) const;
+
+	uint32_t count = 0;
+	uint32_t min = UINT32_MAX;
+	uint32_t max = 0;
+	uint64_t sum = 0;
+
+	uint32_t buckets[32] = {}; // bucket i counts samples with highest set bit i
+};
+
+enum ProfileStage : uint8_t
+{
+	PROFILE_SENSE = 0,	// whole Gy80::sense()
+	PROFILE_ACEL,		// ADXL345 status check and read
+	PROFILE_GYRO,		// L3G4200D status check and read
+	PROFILE_MAGN,		// HMC5883L status check and read
+	PROFILE_FILTER,		// scheduler and filter for one gyro sample
+	PROFILE_EULER,		// filter state to orientation result, angles are computed later on request
+	PROFILE_CALIBRATION,	// learning and applying gyro bias or magnetometer calibration for one reading
+	PROFILE_STAGES
+};
+
+class Profiler
+{
+public:
+	StageStats & stage(ProfileStage s) { return stats[s]; }
+	const StageStats & stage(ProfileStage s) const { return stats[s]; }
+
+	void clear();
+
+	// Write CSV into buffer, header line then one line per stage:
+	// stage,count,min,mean,p50,p90,p99,max,per_second
+	// last column is how many times stage fits into one second, 0 when clock rate is unknown.
+	// Return number of characters written, without terminating zero, as snprintf does.
+	size_t report(char * buffer, size_t size) const;
+
+protected:
+	StageStats stats[PROFILE_STAGES];
+};
+
+// times enclosing block into stage statistics
+class ProfileScope
+{
+public:
+	explicit ProfileScope(StageStats & stats) : stats(stats), start(cycles()) {}
+	~ProfileScope() { stats.add(cycles() - start); }
+
+	ProfileScope (const ProfileScope &) = delete;
+	ProfileScope & operator = (const ProfileScope &) = delete;
+
+protected:
+	StageStats & stats;
+	const uint32_t start;
+};
+
+// Gy80 is timed only when built with GY80_PROFILE, otherwise this costs nothing
+#if defined(GY80_PROFILE)
+#define GY80_PROFILE_SCOPE(profiler, s) ProfileScope profileScope_##s((profiler).stage(s))
+#else
+#define GY80_PROFILE_SCOPE(profiler, s)
+#endif
+
+#endif
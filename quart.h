@@ -1,23 +1,550 @@
 #ifndef quart_h_
 #define quart_h_
 
-struct Quart//erion
+#include <math.h>
+
+#include "mathhelp.h"
+#include "matrix.h"
+
+// Vectors and quaternions, header only.
+// Operators return expression templates, nothing is computed until Vec3T or QuartT is assigned or
+// a component is read, so a chain of operations becomes one expression per component, without
+// intermediate vectors or quaternions. Assignment reads every component before it writes,
+// so q = q + ... is fine. Operands are kept by reference, do not keep an expression beyond
+// the statement its operands live in. Scalar is float, double, Fixed<F> or Lanes.
+// Quaternion is q1 + q2 i + q3 j + q4 k, it turns vectors from sensor frame into Earth frame.
+
+// evaluation of expression is always inlined, so compiler sees all of it and shares common terms
+#define QUART_INLINE inline __attribute__((always_inline))
+
+// keeps scalar argument of operators out of template deduction, so 0.5f goes with any scalar type
+template <typename T>
+struct ScalarOf
+{
+	typedef T type;
+};
+
+template <class E, typename T>
+struct Vec3Expr
+{
+	constexpr T x() const { return static_cast<const E &>(*this).x(); }
+	constexpr T y() const { return static_cast<const E &>(*this).y(); }
+	constexpr T z() const { return static_cast<const E &>(*this).z(); }
+};
+
+template <class E, typename T>
+struct QuartExpr
+{
+	constexpr T q1() const { return static_cast<const E &>(*this).q1(); }
+	constexpr T q2() const { return static_cast<const E &>(*this).q2(); }
+	constexpr T q3() const { return static_cast<const E &>(*this).q3(); }
+	constexpr T q4() const { return static_cast<const E &>(*this).q4(); }
+};
+
+template <typename T>
+struct Vec3T : Vec3Expr<Vec3T<T>, T>
+{
+	// how expressions keep this operand
+	typedef const Vec3T & Stored;
+
+	Vec3T() = default;
+	constexpr Vec3T(T x, T y, T z) : v { x, y, z } {}
+
+	template <class E>
+	QUART_INLINE constexpr Vec3T(const Vec3Expr<E, T> & e) : v { e.x(), e.y(), e.z() } {}
+
+	template <class E>
+	QUART_INLINE Vec3T & operator = (const Vec3Expr<E, T> & e)
+	{
+		const T x = e.x(), y = e.y(), z = e.z();
+
+		v[0] = x;
+		v[1] = y;
+		v[2] = z;
+
+		return *this;
+	}
+
+	T & x() { return v[0]; }
+	T & y() { return v[1]; }
+	T & z() { return v[2]; }
+
+	constexpr T x() const { return v[0]; }
+	constexpr T y() const { return v[1]; }
+	constexpr T z() const { return v[2]; }
+
+	T v[3];
+};
+
+template <typename T>
+struct QuartT//erion
+	: QuartExpr<QuartT<T>, T>
 {
-	float & q1() { return q[0]; }
-	float & q2() { return q[1]; }
-	float & q3() { return q[2]; }
-	float & q4() { return q[3]; }
+	typedef const QuartT & Stored;
+
+	QuartT() = default;
+	constexpr QuartT(T q1, T q2, T q3, T q4) : q { q1, q2, q3, q4 } {}
+
+	template <class E>
+	QUART_INLINE constexpr QuartT(const QuartExpr<E, T> & e) : q { e.q1(), e.q2(), e.q3(), e.q4() } {}
+
+	template <class E>
+	QUART_INLINE QuartT & operator = (const QuartExpr<E, T> & e)
+	{
+		const T q1 = e.q1(), q2 = e.q2(), q3 = e.q3(), q4 = e.q4();
+
+		q[0] = q1;
+		q[1] = q2;
+		q[2] = q3;
+		q[3] = q4;
+
+		return *this;
+	}
+
+	T & q1() { return q[0]; }
+	T & q2() { return q[1]; }
+	T & q3() { return q[2]; }
+	T & q4() { return q[3]; }
+
+	constexpr T q1() const { return q[0]; }
+	constexpr T q2() const { return q[1]; }
+	constexpr T q3() const { return q[2]; }
+	constexpr T q4() const { return q[3]; }
 
 protected:
-	float q[4];
+	T q[4];
+};
+
+// vector expressions
+
+template <class A, class B, typename T>
+struct Vec3Sum : Vec3Expr<Vec3Sum<A, B, T>, T>
+{
+	typedef Vec3Sum Stored;
+
+	constexpr Vec3Sum(const A & a, const B & b) : a(a), b(b) {}
+
+	constexpr T x() const { return a.x() + b.x(); }
+	constexpr T y() const { return a.y() + b.y(); }
+	constexpr T z() const { return a.z() + b.z(); }
+
+	typename A::Stored a;
+	typename B::Stored b;
+};
+
+template <class A, class B, typename T>
+struct Vec3Difference : Vec3Expr<Vec3Difference<A, B, T>, T>
+{
+	typedef Vec3Difference Stored;
+
+	constexpr Vec3Difference(const A & a, const B & b) : a(a), b(b) {}
+
+	constexpr T x() const { return a.x() - b.x(); }
+	constexpr T y() const { return a.y() - b.y(); }
+	constexpr T z() const { return a.z() - b.z(); }
+
+	typename A::Stored a;
+	typename B::Stored b;
 };
 
-struct ErrorIntegral : protected Quart
+template <class A, typename T>
+struct Vec3Negated : Vec3Expr<Vec3Negated<A, T>, T>
 {
-	float & e1() { return q1(); }
-	float & e2() { return q2(); }
-	float & e3() { return q3(); }
-	float & e4() { return q4(); }
+	typedef Vec3Negated Stored;
+
+	constexpr explicit Vec3Negated(const A & a) : a(a) {}
+
+	constexpr T x() const { return -a.x(); }
+	constexpr T y() const { return -a.y(); }
+	constexpr T z() const { return -a.z(); }
+
+	typename A::Stored a;
+};
+
+template <class A, typename T>
+struct Vec3Scaled : Vec3Expr<Vec3Scaled<A, T>, T>
+{
+	typedef Vec3Scaled Stored;
+
+	constexpr Vec3Scaled(const A & a, T s) : a(a), s(s) {}
+
+	constexpr T x() const { return a.x() * s; }
+	constexpr T y() const { return a.y() * s; }
+	constexpr T z() const { return a.z() * s; }
+
+	typename A::Stored a;
+	T s;
+};
+
+template <class A, class B, typename T>
+struct Vec3Cross : Vec3Expr<Vec3Cross<A, B, T>, T>
+{
+	typedef Vec3Cross Stored;
+
+	constexpr Vec3Cross(const A & a, const B & b) : a(a), b(b) {}
+
+	constexpr T x() const { return a.y() * b.z() - a.z() * b.y(); }
+	constexpr T y() const { return a.z() * b.x() - a.x() * b.z(); }
+	constexpr T z() const { return a.x() * b.y() - a.y() * b.x(); }
+
+	typename A::Stored a;
+	typename B::Stored b;
+};
+
+// v turned by unit quaternion q, as v + q1 t + u x t with u vector part of q and t = 2 u x v
+template <class Q, class V, typename T>
+struct Vec3Rotated : Vec3Expr<Vec3Rotated<Q, V, T>, T>
+{
+	typedef Vec3Rotated Stored;
+
+	constexpr Vec3Rotated(const Q & q, const V & v) : q(q), v(v) {}
+
+	constexpr T x() const { return v.x() + q.q1() * tx() + (q.q3() * tz() - q.q4() * ty()); }
+	constexpr T y() const { return v.y() + q.q1() * ty() + (q.q4() * tx() - q.q2() * tz()); }
+	constexpr T z() const { return v.z() + q.q1() * tz() + (q.q2() * ty() - q.q3() * tx()); }
+
+	constexpr T tx() const { return T(2.0f) * (q.q3() * v.z() - q.q4() * v.y()); }
+	constexpr T ty() const { return T(2.0f) * (q.q4() * v.x() - q.q2() * v.z()); }
+	constexpr T tz() const { return T(2.0f) * (q.q2() * v.y() - q.q3() * v.x()); }
+
+	typename Q::Stored q;
+	typename V::Stored v;
+};
+
+// Earth axis I in sensor frame, row I of rotation matrix, needs unit quaternion
+template <uint8_t I, class Q, typename T>
+struct Vec3EarthAxis : Vec3Expr<Vec3EarthAxis<I, Q, T>, T>
+{
+	static_assert(I < 3, "Axis is 0, 1 or 2");
+
+	typedef Vec3EarthAxis Stored;
+
+	constexpr explicit Vec3EarthAxis(const Q & q) : q(q) {}
+
+	constexpr T x() const
+	{
+		return I == 0 ? T(1.0f) - T(2.0f) * (q.q3() * q.q3() + q.q4() * q.q4())
+			: I == 1 ? T(2.0f) * (q.q2() * q.q3() + q.q1() * q.q4())
+			: T(2.0f) * (q.q2() * q.q4() - q.q1() * q.q3());
+	}
+
+	constexpr T y() const
+	{
+		return I == 0 ? T(2.0f) * (q.q2() * q.q3() - q.q1() * q.q4())
+			: I == 1 ? T(1.0f) - T(2.0f) * (q.q2() * q.q2() + q.q4() * q.q4())
+			: T(2.0f) * (q.q1() * q.q2() + q.q3() * q.q4());
+	}
+
+	constexpr T z() const
+	{
+		return I == 0 ? T(2.0f) * (q.q2() * q.q4() + q.q1() * q.q3())
+			: I == 1 ? T(2.0f) * (q.q3() * q.q4() - q.q1() * q.q2())
+			: T(1.0f) - T(2.0f) * (q.q2() * q.q2() + q.q3() * q.q3());
+	}
+
+	typename Q::Stored q;
+};
+
+// quaternion expressions
+
+template <class A, class B, typename T>
+struct QuartSum : QuartExpr<QuartSum<A, B, T>, T>
+{
+	typedef QuartSum Stored;
+
+	constexpr QuartSum(const A & a, const B & b) : a(a), b(b) {}
+
+	constexpr T q1() const { return a.q1() + b.q1(); }
+	constexpr T q2() const { return a.q2() + b.q2(); }
+	constexpr T q3() const { return a.q3() + b.q3(); }
+	constexpr T q4() const { return a.q4() + b.q4(); }
+
+	typename A::Stored a;
+	typename B::Stored b;
+};
+
+template <class A, class B, typename T>
+struct QuartDifference : QuartExpr<QuartDifference<A, B, T>, T>
+{
+	typedef QuartDifference Stored;
+
+	constexpr QuartDifference(const A & a, const B & b) : a(a), b(b) {}
+
+	constexpr T q1() const { return a.q1() - b.q1(); }
+	constexpr T q2() const { return a.q2() - b.q2(); }
+	constexpr T q3() const { return a.q3() - b.q3(); }
+	constexpr T q4() const { return a.q4() - b.q4(); }
+
+	typename A::Stored a;
+	typename B::Stored b;
 };
 
+template <class A, typename T>
+struct QuartScaled : QuartExpr<QuartScaled<A, T>, T>
+{
+	typedef QuartScaled Stored;
+
+	constexpr QuartScaled(const A & a, T s) : a(a), s(s) {}
+
+	constexpr T q1() const { return a.q1() * s; }
+	constexpr T q2() const { return a.q2() * s; }
+	constexpr T q3() const { return a.q3() * s; }
+	constexpr T q4() const { return a.q4() * s; }
+
+	typename A::Stored a;
+	T s;
+};
+
+template <class A, typename T>
+struct QuartConjugate : QuartExpr<QuartConjugate<A, T>, T>
+{
+	typedef QuartConjugate Stored;
+
+	constexpr explicit QuartConjugate(const A & a) : a(a) {}
+
+	constexpr T q1() const { return a.q1(); }
+	constexpr T q2() const { return -a.q2(); }
+	constexpr T q3() const { return -a.q3(); }
+	constexpr T q4() const { return -a.q4(); }
+
+	typename A::Stored a;
+};
+
+// Hamilton product
+template <class A, class B, typename T>
+struct QuartProduct : QuartExpr<QuartProduct<A, B, T>, T>
+{
+	typedef QuartProduct Stored;
+
+	constexpr QuartProduct(const A & a, const B & b) : a(a), b(b) {}
+
+	constexpr T q1() const { return a.q1() * b.q1() - a.q2() * b.q2() - a.q3() * b.q3() - a.q4() * b.q4(); }
+	constexpr T q2() const { return a.q1() * b.q2() + a.q2() * b.q1() + a.q3() * b.q4() - a.q4() * b.q3(); }
+	constexpr T q3() const { return a.q1() * b.q3() - a.q2() * b.q4() + a.q3() * b.q1() + a.q4() * b.q2(); }
+	constexpr T q4() const { return a.q1() * b.q4() + a.q2() * b.q3() - a.q3() * b.q2() + a.q4() * b.q1(); }
+
+	typename A::Stored a;
+	typename B::Stored b;
+};
+
+// product with vector taken as quaternion of zero scalar part, zero terms are left out
+template <class A, class V, typename T>
+struct QuartVectorProduct : QuartExpr<QuartVectorProduct<A, V, T>, T>
+{
+	typedef QuartVectorProduct Stored;
+
+	constexpr QuartVectorProduct(const A & a, const V & v) : a(a), v(v) {}
+
+	constexpr T q1() const { return -a.q2() * v.x() - a.q3() * v.y() - a.q4() * v.z(); }
+	constexpr T q2() const { return  a.q1() * v.x() + a.q3() * v.z() - a.q4() * v.y(); }
+	constexpr T q3() const { return  a.q1() * v.y() - a.q2() * v.z() + a.q4() * v.x(); }
+	constexpr T q4() const { return  a.q1() * v.z() + a.q2() * v.y() - a.q3() * v.x(); }
+
+	typename A::Stored a;
+	typename V::Stored v;
+};
+
+template <class V, typename T>
+struct QuartFromParts : QuartExpr<QuartFromParts<V, T>, T>
+{
+	typedef QuartFromParts Stored;
+
+	constexpr QuartFromParts(T s, const V & v) : s(s), v(v) {}
+
+	constexpr T q1() const { return s; }
+	constexpr T q2() const { return v.x(); }
+	constexpr T q3() const { return v.y(); }
+	constexpr T q4() const { return v.z(); }
+
+	T s;
+	typename V::Stored v;
+};
+
+// vector operations
+
+template <class A, class B, typename T>
+constexpr Vec3Sum<A, B, T> operator + (const Vec3Expr<A, T> & a, const Vec3Expr<B, T> & b)
+{
+	return Vec3Sum<A, B, T>(static_cast<const A &>(a), static_cast<const B &>(b));
+}
+
+template <class A, class B, typename T>
+constexpr Vec3Difference<A, B, T> operator - (const Vec3Expr<A, T> & a, const Vec3Expr<B, T> & b)
+{
+	return Vec3Difference<A, B, T>(static_cast<const A &>(a), static_cast<const B &>(b));
+}
+
+template <class A, typename T>
+constexpr Vec3Negated<A, T> operator - (const Vec3Expr<A, T> & a)
+{
+	return Vec3Negated<A, T>(static_cast<const A &>(a));
+}
+
+template <class A, typename T>
+constexpr Vec3Scaled<A, T> operator * (const Vec3Expr<A, T> & a, typename ScalarOf<T>::type s)
+{
+	return Vec3Scaled<A, T>(static_cast<const A &>(a), s);
+}
+
+template <class A, typename T>
+constexpr Vec3Scaled<A, T> operator * (typename ScalarOf<T>::type s, const Vec3Expr<A, T> & a)
+{
+	return Vec3Scaled<A, T>(static_cast<const A &>(a), s);
+}
+
+template <class A, class B, typename T>
+constexpr Vec3Cross<A, B, T> cross(const Vec3Expr<A, T> & a, const Vec3Expr<B, T> & b)
+{
+	return Vec3Cross<A, B, T>(static_cast<const A &>(a), static_cast<const B &>(b));
+}
+
+template <class A, class B, typename T>
+constexpr T dot(const Vec3Expr<A, T> & a, const Vec3Expr<B, T> & b)
+{
+	return a.x() * b.x() + a.y() * b.y() + a.z() * b.z();
+}
+
+// from sensor frame into Earth frame
+template <class Q, class V, typename T>
+constexpr Vec3Rotated<Q, V, T> rotate(const QuartExpr<Q, T> & q, const Vec3Expr<V, T> & v)
+{
+	return Vec3Rotated<Q, V, T>(static_cast<const Q &>(q), static_cast<const V &>(v));
+}
+
+// from Earth frame into sensor frame
+template <class Q, class V, typename T>
+constexpr Vec3Rotated<QuartConjugate<Q, T>, V, T> rotateBack(const QuartExpr<Q, T> & q, const Vec3Expr<V, T> & v)
+{
+	return Vec3Rotated<QuartConjugate<Q, T>, V, T>(QuartConjugate<Q, T>(static_cast<const Q &>(q)), static_cast<const V &>(v));
+}
+
+// rotateBack() of Earth axis I, e.g. earthAxis<2>(q) is where accelerometer at rest points, cheaper than rotating
+template <uint8_t I, class Q, typename T>
+constexpr Vec3EarthAxis<I, Q, T> earthAxis(const QuartExpr<Q, T> & q)
+{
+	return Vec3EarthAxis<I, Q, T>(static_cast<const Q &>(q));
+}
+
+// quaternion operations
+
+template <class A, class B, typename T>
+constexpr QuartSum<A, B, T> operator + (const QuartExpr<A, T> & a, const QuartExpr<B, T> & b)
+{
+	return QuartSum<A, B, T>(static_cast<const A &>(a), static_cast<const B &>(b));
+}
+
+template <class A, class B, typename T>
+constexpr QuartDifference<A, B, T> operator - (const QuartExpr<A, T> & a, const QuartExpr<B, T> & b)
+{
+	return QuartDifference<A, B, T>(static_cast<const A &>(a), static_cast<const B &>(b));
+}
+
+template <class A, typename T>
+constexpr QuartScaled<A, T> operator * (const QuartExpr<A, T> & a, typename ScalarOf<T>::type s)
+{
+	return QuartScaled<A, T>(static_cast<const A &>(a), s);
+}
+
+template <class A, typename T>
+constexpr QuartScaled<A, T> operator * (typename ScalarOf<T>::type s, const QuartExpr<A, T> & a)
+{
+	return QuartScaled<A, T>(static_cast<const A &>(a), s);
+}
+
+template <class A, class B, typename T>
+constexpr QuartProduct<A, B, T> operator * (const QuartExpr<A, T> & a, const QuartExpr<B, T> & b)
+{
+	return QuartProduct<A, B, T>(static_cast<const A &>(a), static_cast<const B &>(b));
+}
+
+template <class A, class V, typename T>
+constexpr QuartVectorProduct<A, V, T> operator * (const QuartExpr<A, T> & a, const Vec3Expr<V, T> & v)
+{
+	return QuartVectorProduct<A, V, T>(static_cast<const A &>(a), static_cast<const V &>(v));
+}
+
+template <class A, typename T>
+constexpr QuartConjugate<A, T> conj(const QuartExpr<A, T> & a)
+{
+	return QuartConjugate<A, T>(static_cast<const A &>(a));
+}
+
+// quaternion of scalar part s and vector part v
+template <class V, typename T>
+constexpr QuartFromParts<V, T> quart(typename ScalarOf<T>::type s, const Vec3Expr<V, T> & v)
+{
+	return QuartFromParts<V, T>(s, static_cast<const V &>(v));
+}
+
+// in place, same arithmetic and result as normalize() of components, false if length is zero
+template <typename T>
+auto normalize(Vec3T<T> & v) -> decltype(normalize(v.x(), v.y(), v.z()))
+{
+	return normalize(v.x(), v.y(), v.z());
+}
+
+template <typename T>
+auto normalize(QuartT<T> & q) -> decltype(normalize(q.q1(), q.q2(), q.q3(), q.q4()))
+{
+	return normalize(q.q1(), q.q2(), q.q3(), q.q4());
+}
+
+// float and double expanded here, so components stay in registers instead of going through memory for a call
+template <class V, typename T>
+static QUART_INLINE bool normalizeFloating(V & v, T square)
+{
+	T norm = sqrt(square);
+
+	if (!isgreater(norm, T(0)))
+	{
+		return false;
+	}
+
+	v = v * (T(1) / norm);
+
+	return true;
+}
+
+inline bool normalize(Vec3T<float> & v) { return normalizeFloating(v, v.x() * v.x() + v.y() * v.y() + v.z() * v.z()); }
+inline bool normalize(Vec3T<double> & v) { return normalizeFloating(v, v.x() * v.x() + v.y() * v.y() + v.z() * v.z()); }
+inline bool normalize(QuartT<float> & q) { return normalizeFloating(q, q.q1() * q.q1() + q.q2() * q.q2() + q.q3() * q.q3() + q.q4() * q.q4()); }
+inline bool normalize(QuartT<double> & q) { return normalizeFloating(q, q.q1() * q.q1() + q.q2() * q.q2() + q.q3() * q.q3() + q.q4() * q.q4()); }
+
+// conversions
+
+// rotation matrix of unit quaternion, turns sensor frame into Earth frame, rows are Earth axes in sensor frame
+template <class Q, typename T>
+constexpr Matrix<T, 3, 3> toMatrix(const QuartExpr<Q, T> & q)
+{
+	return Matrix<T, 3, 3>
+	{{
+		{ earthAxis<0>(q).x(), earthAxis<0>(q).y(), earthAxis<0>(q).z() },
+		{ earthAxis<1>(q).x(), earthAxis<1>(q).y(), earthAxis<1>(q).z() },
+		{ earthAxis<2>(q).x(), earthAxis<2>(q).y(), earthAxis<2>(q).z() },
+	}};
+}
+
+// Tait-Bryan angles yaw, pitch, roll in radians from rotation matrix, applied in that order, see Orientation.
+// float and double only, Orientation has the fast approximations
+template <typename T>
+void toEuler(const Matrix<T, 3, 3> & r, T * angles)
+{
+	angles[0] = atan2(r(1, 0), r(0, 0));
+	angles[1] = -asin(r(2, 0));
+	angles[2] = atan2(r(2, 1), r(2, 2));
+}
+
+template <typename T>
+struct ErrorIntegralT : protected QuartT<T>
+{
+	T & e1() { return this->q1(); }
+	T & e2() { return this->q2(); }
+	T & e3() { return this->q3(); }
+	T & e4() { return this->q4(); }
+};
+
+typedef Vec3T<float> Vec3;
+typedef QuartT<float> Quart;
+typedef ErrorIntegralT<float> ErrorIntegral;
+
 #endif
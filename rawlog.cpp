@@ -0,0 +1,90 @@
+#include "rawlog.h"
+
+#include <string.h>
+
+int RawLogWriter::begin(float acelResolution, float gyroResolution, float magnResolution)
+{
+	RawLogHeader header;
+
+	memcpy(header.magic, "GY80", 4);
+	header.version = RAWLOG_VERSION;
+	header.recordSize = sizeof(RawLogRecord);
+	header.resolution[RAW_ACEL] = acelResolution;
+	header.resolution[RAW_GYRO] = gyroResolution;
+	header.resolution[RAW_MAGN] = magnResolution;
+
+	used = 0;
+	sent = 0;
+	lost = 0;
+
+	const size_t size = sizeof(header);
+
+	return sink(reinterpret_cast<const uint8_t *>(&header), size, context) == size ? 0 : -1;
+}
+
+void RawLogWriter::write(RawSensor sensor, uint32_t time, const int16_t * raw)
+{
+	// block left full by short write, sink gets another chance before record is dropped
+	if (used == blockRecords && flush() != 0)
+	{
+		++lost;
+		return;
+	}
+
+	RawLogRecord & record = block[used++];
+
+	record.time   = time;
+	record.sensor = sensor;
+	record.flags  = 0;
+	record.raw[0] = raw[0];
+	record.raw[1] = raw[1];
+	record.raw[2] = raw[2];
+
+	if (used == blockRecords)
+	{
+		flush();
+	}
+}
+
+int RawLogWriter::flush()
+{
+	if (used == 0)
+	{
+		return 0;
+	}
+
+	const size_t size = used * sizeof(RawLogRecord);
+	const size_t taken = sink(reinterpret_cast<const uint8_t *>(block) + sent, size - sent, context);
+
+	// keep what sink did not take, records after it follow once it is written
+	sent += taken < size - sent ? taken : size - sent;
+
+	if (sent < size)
+	{
+		return -1;
+	}
+
+	used = 0;
+	sent = 0;
+
+	return 0;
+}
+
+RawLogReader::RawLogReader(const void * data, size_t size)
+{
+	if (size < sizeof(RawLogHeader))
+	{
+		return;
+	}
+
+	const RawLogHeader * h = static_cast<const RawLogHeader *>(data);
+
+	if (memcmp(h->magic, "GY80", 4) != 0 || h->version != RAWLOG_VERSION || h->recordSize != sizeof(RawLogRecord))
+	{
+		return;
+	}
+
+	header  = h;
+	first   = reinterpret_cast<const RawLogRecord *>(h + 1);
+	records = (size - sizeof(RawLogHeader)) / sizeof(RawLogRecord);
+}
@@ -0,0 +1,98 @@
+#ifndef rawlog_h_
+#define rawlog_h_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Raw sample log: one RawLogHeader, then RawLogRecord after RawLogRecord in order of time.
+// Everything is little endian as on Teensy and x86, records are fixed size so readers can index them.
+// Version changes whenever layout changes, readers refuse other versions.
+
+constexpr uint16_t RAWLOG_VERSION = 1;
+
+enum RawSensor : uint8_t
+{
+	RAW_ACEL = 0,
+	RAW_GYRO = 1,
+	RAW_MAGN = 2,
+};
+
+struct RawLogHeader
+{
+	char     magic[4];		// "GY80"
+	uint16_t version;		// RAWLOG_VERSION
+	uint16_t recordSize;	// sizeof(RawLogRecord)
+	float    resolution[3];	// physical value per LSB, indexed by RawSensor, G, rad/s and mGauss
+};
+
+struct RawLogRecord
+{
+	uint32_t time;		// micros() of sample
+	uint8_t  sensor;	// RawSensor
+	uint8_t  flags;		// reserved, 0
+	int16_t  raw[3];	// x, y, z as read from sensor
+};
+
+static_assert(sizeof(RawLogHeader) == 20, "Log header layout changed, bump RAWLOG_VERSION");
+static_assert(sizeof(RawLogRecord) == 12, "Log record layout changed, bump RAWLOG_VERSION");
+
+// sink gets bytes to store, returns number of bytes it took
+typedef size_t (*RawLogSink)(const uint8_t * data, size_t size, void * context);
+
+// Collects records into a block and hands full blocks to sink, e.g. SD card file.
+// Bytes sink does not take stay in block and go first on next flush, so a short write never
+// leaves log with a record cut in the middle. Records arriving while block is still full are dropped.
+class RawLogWriter
+{
+public:
+	RawLogWriter(RawLogSink sink, void * context) : sink(sink), context(context) {}
+
+	RawLogWriter (const RawLogWriter &) = delete;
+	RawLogWriter & operator = (const RawLogWriter &) = delete;
+
+	// write header, return 0 on success
+	int begin(float acelResolution, float gyroResolution, float magnResolution);
+
+	void write(RawSensor sensor, uint32_t time, const int16_t * raw);
+
+	// hand partially filled block to sink, return 0 when sink took all of it
+	int flush();
+
+	// records dropped because block was still full
+	uint32_t dropped() const { return lost; }
+
+protected:
+	// 42 records fill one 512 byte card block but for 8 bytes
+	static constexpr uint8_t blockRecords = 42;
+
+	RawLogSink sink;
+	void * context;
+
+	RawLogRecord block[blockRecords];
+	uint8_t used = 0;
+	uint16_t sent = 0; // bytes of block sink already took
+	uint32_t lost = 0;
+};
+
+// Zero-copy view of log in memory, e.g. memory mapped file.
+// Trailing bytes of a record cut short by power loss are ignored.
+class RawLogReader
+{
+public:
+	RawLogReader(const void * data, size_t size);
+
+	bool valid() const { return header != nullptr; }
+
+	const RawLogHeader & info() const { return *header; }
+
+	size_t count() const { return records; }
+
+	const RawLogRecord & operator [] (size_t i) const { return first[i]; }
+
+protected:
+	const RawLogHeader * header = nullptr;
+	const RawLogRecord * first = nullptr;
+	size_t records = 0;
+};
+
+#endif
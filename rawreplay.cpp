@@ -0,0 +1,130 @@
+#if !defined(ARDUINO)
+
+#include "rawreplay.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// replayed part of the map is released in steps of this size
+constexpr size_t releaseStep = 64 * 1024 * 1024;
+
+RawLogReplay::~RawLogReplay()
+{
+	close();
+}
+
+int RawLogReplay::open(const char * path)
+{
+	close();
+
+	const int fd = ::open(path, O_RDONLY);
+
+	if (fd < 0)
+	{
+		return -1;
+	}
+
+	struct stat st;
+
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		::close(fd);
+		return -1;
+	}
+
+	void * m = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd); // map keeps file referenced
+
+	if (m == MAP_FAILED)
+	{
+		return -1;
+	}
+
+	madvise(m, st.st_size, MADV_SEQUENTIAL);
+
+	map = m;
+	mapSize = st.st_size;
+	log = RawLogReader(map, mapSize);
+
+	if (!log.valid())
+	{
+		close();
+		return -1;
+	}
+
+	return 0;
+}
+
+void RawLogReplay::close()
+{
+	if (map != nullptr)
+	{
+		munmap(map, mapSize);
+	}
+
+	map = nullptr;
+	mapSize = 0;
+	log = RawLogReader(nullptr, 0);
+}
+
+size_t RawLogReplay::run(FusionScheduler & fusion, ReplayOutput output, void * context)
+{
+	if (!log.valid() || log.count() == 0)
+	{
+		return 0;
+	}
+
+	const float * resolution = log.info().resolution;
+	const uint8_t * base = static_cast<const uint8_t *>(map);
+	size_t released = 0;
+
+	fusion.reset(log[0].time);
+
+	for (size_t i = 0; i < log.count(); ++i)
+	{
+		const RawLogRecord & r = log[i];
+		const float res = resolution[r.sensor < 3 ? r.sensor : 0];
+
+		const float x = r.raw[0] * res;
+		const float y = r.raw[1] * res;
+		const float z = r.raw[2] * res;
+
+		switch (r.sensor)
+		{
+		case RAW_ACEL:
+			fusion.acel(r.time, x, y, z);
+			break;
+
+		case RAW_MAGN:
+			fusion.magn(r.time, x, y, z);
+			break;
+
+		case RAW_GYRO:
+			fusion.gyro(r.time, x, y, z);
+
+			if (output != nullptr)
+			{
+				output(r.time, fusion.quart(), context);
+			}
+			break;
+
+		default:
+			break; // unknown sensor from newer writer, skip
+		}
+
+		// drop pages already replayed, map stays valid and pages come back from file if touched again
+		const size_t done = reinterpret_cast<const uint8_t *>(&r) - base;
+
+		if (done - released >= releaseStep)
+		{
+			madvise(const_cast<uint8_t *>(base) + released, releaseStep, MADV_DONTNEED);
+			released += releaseStep;
+		}
+	}
+
+	return log.count();
+}
+
+#endif
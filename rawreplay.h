@@ -0,0 +1,38 @@
+#ifndef rawreplay_h_
+#define rawreplay_h_
+
+#include "rawlog.h"
+#include "scheduler.h"
+
+// called after every gyro sample of replay with updated orientation
+typedef void (*ReplayOutput)(uint32_t time, QuartT<FusionScalar> & quart, void * context);
+
+// Host side replay, memory maps a log and streams it through FusionScheduler as fast as it goes.
+// Pages behind the read position are released as replay goes, so memory use stays flat for any log size.
+// POSIX only, not built for Arduino.
+class RawLogReplay
+{
+public:
+	RawLogReplay() = default;
+	~RawLogReplay();
+
+	RawLogReplay (const RawLogReplay &) = delete;
+	RawLogReplay & operator = (const RawLogReplay &) = delete;
+
+	// map log file, return 0 on success
+	int open(const char * path);
+	void close();
+
+	const RawLogReader & reader() const { return log; }
+
+	// reset fusion to time of first record and feed it all records, return number of records fed
+	size_t run(FusionScheduler & fusion, ReplayOutput output, void * context);
+
+protected:
+	void * map = nullptr;
+	size_t mapSize = 0;
+
+	RawLogReader log { nullptr, 0 };
+};
+
+#endif
@@ -0,0 +1,115 @@
+#include "scheduler.h"
+
+// magnetometer reading older than this is not used for correction
+constexpr uint32_t maxMagnAge = 100000; // microseconds
+
+// longest time a single correction step accounts for, so first step after a gap does not overshoot
+constexpr uint32_t maxCorrectStep = 100000; // microseconds
+
+// filter input in scalar type of fusion, magnetometer goes in Gauss so it fits fixed point range
+static FilterInputT<FusionScalar> fusionInput(FilterInput & input)
+{
+	FilterInputT<FusionScalar> result;
+
+	for (uint8_t i = 0; i < 6; ++i)
+	{
+		result.values[i] = FusionScalar(input.values[i]);
+	}
+
+	for (uint8_t i = 6; i < 9; ++i)
+	{
+		result.values[i] = FusionScalar(input.values[i] * 0.001f);
+	}
+
+	result.deltaT = FusionScalar(input.deltaT);
+
+	return result;
+}
+
+void FusionScheduler::reset(uint32_t now)
+{
+	lastGyro = now;
+	lastAcel = now;
+	lastMagn = now;
+	lastCorrect = now;
+
+	acelFresh = false;
+	magnFresh = false;
+	magnValid = false;
+
+	engine.reset();
+
+	q.q1() = 1.0f;
+	q.q2() = 0.0f;
+	q.q3() = 0.0f;
+	q.q4() = 0.0f;
+}
+
+void FusionScheduler::resume(uint32_t now)
+{
+	lastGyro = now;
+	lastCorrect = now;
+
+	acelFresh = false;
+	magnFresh = false;
+	magnValid = false;
+}
+
+void FusionScheduler::acel(uint32_t time, float x, float y, float z)
+{
+	latest.ax() = x;
+	latest.ay() = y;
+	latest.az() = z;
+
+	lastAcel = time;
+	acelFresh = true;
+}
+
+void FusionScheduler::magn(uint32_t time, float x, float y, float z)
+{
+	latest.mx() = x;
+	latest.my() = y;
+	latest.mz() = z;
+
+	lastMagn = time;
+	magnFresh = true;
+	magnValid = true;
+}
+
+void FusionScheduler::gyro(uint32_t time, float x, float y, float z)
+{
+	latest.gx() = x;
+	latest.gy() = y;
+	latest.gz() = z;
+
+	if (magnValid && time - lastMagn > maxMagnAge)
+	{
+		magnValid = false;
+	}
+
+	latest.deltaT = (float(time - lastGyro) / 1000000.0f); // set integration time by time elapsed since last gyro sample
+	lastGyro = time;
+
+	engine.predict(q, fusionInput(latest));
+
+	if (acelFresh && time - lastCorrect >= correctInterval)
+	{
+		const uint32_t sinceCorrect = time - lastCorrect;
+		latest.deltaT = float(sinceCorrect < maxCorrectStep ? sinceCorrect : maxCorrectStep) / 1000000.0f;
+		lastCorrect = time;
+
+		if (magnValid)
+		{
+			// correct with new accelerometer reading and latest magnetometer one, it changes slower
+			engine.correct(q, fusionInput(latest), magnFresh);
+		}
+		else
+		{
+			// no recent magnetometer reading, keep tilt corrected and let heading follow gyro
+			engine.correctGravity(q, fusionInput(latest));
+		}
+
+		acelFresh = false;
+		magnFresh = false;
+	}
+}
@@ -0,0 +1,52 @@
+#ifndef scheduler_h_
+#define scheduler_h_
+
+#include <stdint.h>
+
+#include "quart.h"
+#include "filterinput.h"
+#include "fusion.h"
+
+// Multi-rate scheduling of the filter, sensors report readings whenever they have them.
+// Every gyro sample predicts, fresh accelerometer reading corrects together with latest magnetometer one,
+// or alone while there is no recent magnetometer reading.
+// Times are micros() of sample, wrap around is fine.
+class FusionScheduler
+{
+public:
+	FusionScheduler() = default;
+
+	// start from identity orientation at given time
+	void reset(uint32_t now);
+
+	// keep orientation after gap in readings, e.g. sensors powered down, next gyro step starts at given time
+	void resume(uint32_t now);
+
+	void acel(uint32_t time, float x, float y, float z); // G
+	void magn(uint32_t time, float x, float y, float z); // mGauss
+	void gyro(uint32_t time, float x, float y, float z); // rad/s, advances filter
+
+	// minimal time between accelerometer/magnetometer corrections, 0 corrects on every fresh reading
+	void setCorrectionInterval(uint32_t micros) { correctInterval = micros; }
+
+	QuartT<FusionScalar> & quart() { return q; }
+
+protected:
+	// latest reading of every sensor
+	FilterInput latest;
+
+	uint32_t lastGyro;
+	uint32_t lastAcel;
+	uint32_t lastMagn;
+	uint32_t lastCorrect;
+	uint32_t correctInterval = 0;
+
+	bool acelFresh;
+	bool magnFresh;
+	bool magnValid;
+
+	QuartT<FusionScalar> q;
+	FusionEngine engine;
+};
+
+#endif
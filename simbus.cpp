@@ -0,0 +1,161 @@
+#include "simbus.h"
+
+int SimBus::attach(SimDevice & device)
+{
+	if (deviceCount >= maxDevices)
+	{
+		return -1;
+	}
+
+	devices[deviceCount++] = &device;
+
+	return 0;
+}
+
+SimDevice * SimBus::find(uint8_t address)
+{
+	for (uint8_t i = 0; i < deviceCount; ++i)
+	{
+		if (devices[i]->address == address)
+		{
+			return devices[i];
+		}
+	}
+
+	return nullptr;
+}
+
+void SimBus::phase(uint8_t bytes, bool stop)
+{
+	// start condition, address byte, payload, stop condition
+	const uint32_t bits = 1 + 9 * (1 + bytes) + (stop ? 1 : 0);
+	const uint32_t wire = (bits * 1000000 + bitRate - 1) / bitRate;
+
+	phaseEnd = clock + setupTime + wire;
+	busyTime += wire;
+}
+
+int SimBus::start(I2cTransaction & t)
+{
+	remaining = latency;
+	active = true;
+
+	if (bitRate > 0)
+	{
+		addressPhase = t.read;
+		phase(t.read ? 1 : 1 + t.count, !t.read);
+	}
+
+	if (stallNext > 0)
+	{
+		--stallNext;
+		stalled = true;
+	}
+
+	return 0;
+}
+
+int SimBus::poll(I2cTransaction & t)
+{
+	clock += pollTime;
+
+	if (stalled)
+	{
+		return XFER_ACTIVE;
+	}
+
+	if (bitRate > 0)
+	{
+		if (int32_t(clock - phaseEnd) < 0)
+		{
+			return XFER_ACTIVE;
+		}
+
+		if (addressPhase)
+		{
+			addressPhase = false;
+			phase(t.count, true);
+			return XFER_ACTIVE;
+		}
+	}
+	else if (remaining > 0)
+	{
+		--remaining;
+		return XFER_ACTIVE;
+	}
+
+	// finished either way
+	active = false;
+
+	if (nakNext > 0)
+	{
+		--nakNext;
+		return XFER_ERROR;
+	}
+
+	SimDevice * device = find(t.address);
+
+	if (device == nullptr)
+	{
+		return XFER_ERROR; // address not acknowledged
+	}
+
+	uint8_t reg = t.subAddress & device->registerMask;
+
+	for (uint8_t i = 0; i < t.count; ++i, ++reg)
+	{
+		if (t.read)
+		{
+			t.data[i] = device->readRegister(reg);
+		}
+		else
+		{
+			device->writeRegister(reg, t.data[i]);
+		}
+	}
+
+	return XFER_DONE;
+}
+
+void SimBus::recover()
+{
+	stalled = false;
+	active = false;
+	++recoveries;
+}
+
+int SimBus::notifyOnDone(I2cNotify n, void * context)
+{
+	notify = n;
+	notifyContext = context;
+
+	return 0;
+}
+
+void SimBus::advance(uint32_t micros)
+{
+	const uint32_t end = clock + micros;
+
+	// handler polls, so it sees phase finished, starts next one or next transaction, or leaves bus idle
+	while (notify != nullptr && bitRate > 0 && active && !stalled && int32_t(end - phaseEnd) >= 0)
+	{
+		const uint32_t ended = phaseEnd;
+
+		if (int32_t(phaseEnd - clock) > 0)
+		{
+			clock = phaseEnd;
+		}
+
+		notify(notifyContext);
+
+		if (active && phaseEnd == ended)
+		{
+			break; // bus did not move on, e.g. engine is inside service()
+		}
+	}
+
+	if (int32_t(end - clock) > 0)
+	{
+		clock = end;
+	}
+}
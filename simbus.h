@@ -0,0 +1,87 @@
+#ifndef simbus_h_
+#define simbus_h_
+
+#include "i2cbus.h"
+
+// register map of simulated slave, override read/write to model side effects
+class SimDevice
+{
+public:
+	// registerMask strips flags from sub address, e.g. 0x7F for auto increment bit of L3G4200D
+	explicit SimDevice(uint8_t address, uint8_t registerMask = 0xFF) :
+		address(address), registerMask(registerMask) {}
+	virtual ~SimDevice() = default;
+
+	virtual uint8_t readRegister(uint8_t reg) { return regs[reg]; }
+	virtual void writeRegister(uint8_t reg, uint8_t value) { regs[reg] = value; }
+
+	const uint8_t address;
+	const uint8_t registerMask;
+
+	uint8_t regs[256] = {};
+};
+
+// bus backend that serves transactions from simulated devices, no hardware needed
+class SimBus : public I2cBus
+{
+public:
+	SimBus() = default;
+	virtual ~SimBus() = default;
+
+	// return 0 on success, -1 if there is no space left
+	int attach(SimDevice &);
+
+	virtual int start(I2cTransaction &);
+	virtual int poll(I2cTransaction &);
+	virtual void recover();
+	virtual uint32_t now() { return clock; }
+
+	// number of poll() calls a transaction stays active, to model bus time
+	uint16_t latency = 0;
+
+	// simulated microseconds one poll() takes, clock moves on poll() and advance()
+	uint32_t pollTime = 10;
+	uint32_t clock = 0;
+
+	// Wire time model, used instead of latency when bitRate is set. Transfer goes on by itself as clock moves,
+	// like controller hardware. Reads have two phases as in WireBus, sub address and then data after restart,
+	// data phase starts only at next poll(). Every phase takes setupTime plus 9 bits per byte, start and stop.
+	uint32_t bitRate = 0;		// bits per second, e.g. 400000
+	uint16_t setupTime = 0;		// microseconds of controller setup per phase
+	uint32_t busyTime = 0;		// microseconds wire was busy so far
+
+	// Simulated time spent elsewhere, e.g. filter math, bus keeps going meanwhile.
+	// With wire time model and notifyOnDone(), completion interrupt comes as each phase ends on the way.
+	void advance(uint32_t micros);
+
+	// completion interrupt, only with wire time model
+	virtual int notifyOnDone(I2cNotify, void *);
+
+	// fault injection, each counts down by one for every transaction it hits
+	uint16_t nakNext = 0;	// transactions not acknowledged
+	uint16_t stallNext = 0;	// transactions that never finish, like slave holding SDA low, until recover()
+
+	uint16_t recoveries = 0;
+
+protected:
+	SimDevice * find(uint8_t address);
+
+	// begin phase of given bytes after address, with or without stop
+	void phase(uint8_t bytes, bool stop);
+
+	bool stalled = false;
+	bool active = false;		// transaction started and not finished
+	bool addressPhase = false;	// read transaction is still sending sub address
+	uint32_t phaseEnd = 0;
+
+	I2cNotify notify = nullptr;
+	void * notifyContext = nullptr;
+
+	static constexpr uint8_t maxDevices = 8;
+
+	SimDevice * devices[maxDevices] = {};
+	uint8_t deviceCount = 0;
+	uint16_t remaining = 0;
+};
+
+#endif
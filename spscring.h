@@ -0,0 +1,84 @@
+#ifndef spscring_h_
+#define spscring_h_
+
+#include <stdint.h>
+#include <atomic>
+
+// Fixed capacity single producer single consumer queue, no allocation, no locks.
+// Producer may be an interrupt handler, e.g. data ready ISR pushing raw samples for main loop,
+// or main loop pushing fused outputs for slow consumer like serial printing or SD logging.
+// Exactly one context calls push(), exactly one calls pop(), statistics may be read from anywhere.
+template <typename T, uint16_t N>
+class SpscRing
+{
+	static_assert(N >= 2 && (N & (N - 1)) == 0, "Capacity must be power of two");
+
+public:
+	SpscRing() = default;
+
+	SpscRing (const SpscRing &) = delete;
+	SpscRing & operator = (const SpscRing &) = delete;
+
+	// producer side, return false and count overflow if ring is full, item is then lost
+	bool push(const T & item)
+	{
+		const uint32_t h = head.load(std::memory_order_relaxed);
+		const uint32_t used = h - tail.load(std::memory_order_acquire);
+
+		if (used >= N)
+		{
+			overflow.store(overflow.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			return false;
+		}
+
+		items[h & (N - 1)] = item;
+		head.store(h + 1, std::memory_order_release);
+
+		if (used + 1 > highWaterMark.load(std::memory_order_relaxed))
+		{
+			highWaterMark.store(used + 1, std::memory_order_relaxed);
+		}
+
+		return true;
+	}
+
+	// consumer side, return false if ring is empty
+	bool pop(T & item)
+	{
+		const uint32_t t = tail.load(std::memory_order_relaxed);
+
+		if (t == head.load(std::memory_order_acquire))
+		{
+			return false;
+		}
+
+		item = items[t & (N - 1)];
+		tail.store(t + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	uint32_t size() const { return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire); }
+	static constexpr uint32_t capacity() { return N; }
+
+	// items lost because ring was full
+	uint32_t overflows() const { return overflow.load(std::memory_order_relaxed); }
+
+	// most items ever held at once
+	uint32_t highWater() const { return highWaterMark.load(std::memory_order_relaxed); }
+
+	// items accepted by push() since start, together with overflows() accounts for every item offered
+	uint32_t pushed() const { return head.load(std::memory_order_acquire); }
+
+protected:
+	T items[N];
+
+	// free running counters, index is counter modulo N
+	std::atomic<uint32_t> head { 0 };	// written by producer only
+	std::atomic<uint32_t> tail { 0 };	// written by consumer only
+
+	std::atomic<uint32_t> overflow { 0 };		// written by producer only
+	std::atomic<uint32_t> highWaterMark { 0 };	// written by producer only
+};
+
+#endif
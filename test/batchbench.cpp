@@ -0,0 +1,77 @@
+// Throughput of batch Madgwick update over SIMD lanes against scalar update of every unit.
+// Build with CXXFLAGS="-O2 -mavx" for 8 lanes, default x86-64 build has SSE2 and 4 lanes.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "madgwick.h"
+#include "madgwickbatch.h"
+#include "lanes.h"
+
+#include "bench.h"
+
+constexpr size_t units = 1024;
+
+static float q[4][units];
+static float input[9][units];
+static float deltaT[units];
+
+int main()
+{
+	srand(1);
+
+	for (size_t i = 0; i < units; ++i)
+	{
+		q[0][i] = 1.0f;
+		q[1][i] = q[2][i] = q[3][i] = 0.0f;
+		deltaT[i] = 0.005f;
+
+		for (uint8_t k = 0; k < 9; ++k)
+		{
+			input[k][i] = (rand() / float(RAND_MAX) - 0.5f) * (k < 3 ? 2.0f : k < 6 ? 1.0f : 600.0f);
+		}
+	}
+
+	float * const qp[4] { q[0], q[1], q[2], q[3] };
+	const float * const ip[9] { input[0], input[1], input[2], input[3], input[4], input[5], input[6], input[7], input[8] };
+
+	const double batch = benchNanos(200, [&](uint32_t)
+	{
+		MadgwickQuaternionUpdateBatch(qp, ip, deltaT, units);
+		benchKeep(q);
+	}) / units;
+
+	const double scalar = benchNanos(200, [&](uint32_t)
+	{
+		for (size_t i = 0; i < units; ++i)
+		{
+			Quart x(q[0][i], q[1][i], q[2][i], q[3][i]);
+			FilterInput f;
+
+			for (uint8_t k = 0; k < 9; ++k)
+			{
+				f.values[k] = input[k][i];
+			}
+
+			f.deltaT = deltaT[i];
+
+			MadgwickQuaternionUpdate(x, f);
+
+			q[0][i] = x.q1();
+			q[1][i] = x.q2();
+			q[2][i] = x.q3();
+			q[3][i] = x.q4();
+		}
+
+		benchKeep(q);
+	}) / units;
+
+#if defined(GY80_LANES)
+	printf("%d lanes ", GY80_LANES);
+#else
+	printf("no lanes ");
+#endif
+	printf("batch %5.1f M updates/s  scalar %5.1f M updates/s  %.1fx\n", 1e3 / batch, 1e3 / scalar, scalar / batch);
+
+	return 0;
+}
@@ -0,0 +1,119 @@
+// Batch Madgwick update over SIMD lanes against scalar update of every unit.
+// Unit count is not a multiple of lanes, so tail runs too, some units have no accelerometer or
+// magnetometer reading or sit at rest where gradient vanishes. Lanes have to give same bits as scalar
+// calls for ordinary units, and stay within float resolution of quaternion for every unit.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "madgwick.h"
+#include "madgwickbatch.h"
+#include "lanes.h"
+
+#include "check.h"
+
+constexpr size_t units = 1003;
+constexpr uint32_t steps = 300;
+
+static float q[4][units];
+static float expected[4][units];
+static float input[9][units];
+static float deltaT[units];
+
+static float noise(float range)
+{
+	return (rand() / float(RAND_MAX) - 0.5f) * range;
+}
+
+int main()
+{
+	srand(1);
+
+	for (size_t i = 0; i < units; ++i)
+	{
+		q[0][i] = 1.0f;
+		q[1][i] = q[2][i] = q[3][i] = 0.0f;
+		deltaT[i] = 0.005f;
+	}
+
+	memcpy(expected, q, sizeof(q));
+
+	float * const qp[4] { q[0], q[1], q[2], q[3] };
+	const float * const ip[9] { input[0], input[1], input[2], input[3], input[4], input[5], input[6], input[7], input[8] };
+
+	for (uint32_t step = 0; step < steps; ++step)
+	{
+		for (uint8_t k = 0; k < 9; ++k)
+		{
+			for (size_t i = 0; i < units; ++i)
+			{
+				input[k][i] = noise(k < 3 ? 2.0f : k < 6 ? 1.0f : 600.0f);
+			}
+		}
+
+		// unit without accelerometer, unit without magnetometer, both in groups of otherwise fine units
+		input[0][7] = input[1][7] = input[2][7] = 0.0f;
+		input[6][21] = input[7][21] = input[8][21] = 0.0f;
+
+		// unit at rest, gravity and field point where filter expects them, gradient comes close to zero
+		input[0][40] = 0.0f;
+		input[1][40] = 0.0f;
+		input[2][40] = 1.0f;
+		input[3][40] = input[4][40] = input[5][40] = 0.0f;
+		input[6][40] = 300.0f;
+		input[7][40] = 0.0f;
+		input[8][40] = 0.0f;
+
+		MadgwickQuaternionUpdateBatch(qp, ip, deltaT, units);
+
+		for (size_t i = 0; i < units; ++i)
+		{
+			Quart x(expected[0][i], expected[1][i], expected[2][i], expected[3][i]);
+			FilterInput f;
+
+			for (uint8_t k = 0; k < 9; ++k)
+			{
+				f.values[k] = input[k][i];
+			}
+
+			f.deltaT = deltaT[i];
+
+			MadgwickQuaternionUpdate(x, f);
+
+			expected[0][i] = x.q1();
+			expected[1][i] = x.q2();
+			expected[2][i] = x.q3();
+			expected[3][i] = x.q4();
+		}
+	}
+
+	size_t identical = 0;
+	float worst = 0.0f;
+
+	for (size_t i = 0; i < units; ++i)
+	{
+		bool same = true;
+
+		for (uint8_t k = 0; k < 4; ++k)
+		{
+			same = same && memcmp(&q[k][i], &expected[k][i], sizeof(float)) == 0;
+			worst = fmaxf(worst, fabsf(q[k][i] - expected[k][i]));
+		}
+
+		identical += same;
+	}
+
+#if defined(GY80_LANES)
+	printf("%d lanes, ", GY80_LANES);
+#else
+	printf("no lanes, ");
+#endif
+	printf("%zu of %zu units bit identical, largest difference %.2e\n", identical, units, worst);
+
+	// only unit at rest may differ
+	CHECK(identical >= units - 1);
+	CHECK(worst < 1e-6f);
+
+	return checkResult();
+}
@@ -0,0 +1,51 @@
+#ifndef bench_h_
+#define bench_h_
+
+#include <stdint.h>
+#include <time.h>
+
+// Host timing for benchmarks. Each run calls f given number of times, best run counts,
+// so other load on the machine shows least.
+
+inline double benchSeconds()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// nanoseconds per call, best of several runs
+template <class F>
+double benchNanos(uint32_t calls, F f, uint8_t runs = 5)
+{
+	double best = 0.0;
+
+	for (uint8_t r = 0; r < runs; ++r)
+	{
+		const double start = benchSeconds();
+
+		for (uint32_t i = 0; i < calls; ++i)
+		{
+			f(i);
+		}
+
+		const double took = (benchSeconds() - start) * 1e9 / calls;
+
+		if (r == 0 || took < best)
+		{
+			best = took;
+		}
+	}
+
+	return best;
+}
+
+// keeps result alive so compiler does not drop the work
+template <typename T>
+inline void benchKeep(const T & value)
+{
+	asm volatile("" : : "g"(&value) : "memory");
+}
+
+#endif
@@ -0,0 +1,36 @@
+// BMP085 temperature and pressure compensation against the worked example of the datasheet.
+
+#include <stdio.h>
+
+#include "BMP085.h"
+
+#include "check.h"
+
+int main()
+{
+	// calibration, raw readings and results from the datasheet calculation example, oss 0
+	const Bmp085Calibration cal = { 408, -72, -14383, 32741, 32757, 23153, 6190, 4, -32768, -8711, 2868 };
+
+	int32_t temperature = 0, pressure = 0;
+	BMP085Base::compensate(cal, 27898, 23843, 0, temperature, pressure);
+
+	printf("temperature %.1f C, pressure %d Pa\n", temperature / 10.0, (int)pressure);
+	CHECK(temperature == 150);
+	CHECK(pressure == 69964);
+
+	// pressure rises with raw reading at every oversampling, temperature does not depend on it
+	for (uint8_t oss = 0; oss <= 3; ++oss)
+	{
+		int32_t last = 0;
+		for (int32_t up = 20000 << oss; up < 40000 << oss; up += 97)
+		{
+			int32_t t, p;
+			BMP085Base::compensate(cal, 27898, up, oss, t, p);
+			CHECK(t == 150);
+			CHECK(p > last);
+			last = p;
+		}
+	}
+
+	return checkResult();
+}
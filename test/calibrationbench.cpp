@@ -0,0 +1,88 @@
+// Cost of online calibration per reading. Gyro offset while still and while moving, magnetometer fit when
+// reading is skipped as too close to last used one and when every reading is used, which is the worst case.
+// Host nanoseconds, on Teensy the fit step is float multiplications and 2 divisions.
+
+#include <math.h>
+#include <stdio.h>
+
+#include "calibration.h"
+
+#include "bench.h"
+
+constexpr uint32_t samples = 1 << 18;
+
+static float still[4096][3];
+static float moving[4096][3];
+static float turns[4096][3];
+
+int main()
+{
+	for (uint32_t i = 0; i < 4096; ++i)
+	{
+		const float t = i / 800.0f;
+
+		still[i][0] = 0.02f + 0.001f * sinf(97.0f * t);
+		still[i][1] = -0.01f + 0.001f * cosf(89.0f * t);
+		still[i][2] = 0.03f;
+
+		moving[i][0] = 1.5f * sinf(3.0f * t);
+		moving[i][1] = 0.8f * cosf(2.0f * t);
+		moving[i][2] = 0.3f * sinf(5.0f * t);
+
+		// neighbours far apart on ellipsoid, every reading is used
+		const float u = 1.0f - 2.0f * (i * 0.618034f - floorf(i * 0.618034f));
+		const float phi = i * 2.39996f;
+		const float r = sqrtf(1.0f - u * u);
+
+		turns[i][0] = 120.0f + 450.0f * r * cosf(phi);
+		turns[i][1] = -80.0f + 500.0f * r * sinf(phi);
+		turns[i][2] = 60.0f + 550.0f * u;
+	}
+
+	GyroBias g;
+
+	const double gyroStill = benchNanos(samples, [&](uint32_t i)
+	{
+		float x = still[i & 4095][0], y = still[i & 4095][1], z = still[i & 4095][2];
+
+		g.acel(0.0f, 0.0f, 1.0f);
+		g.apply(x, y, z);
+		benchKeep(x);
+	});
+
+	const bool learning = g.still();
+
+	const double gyroMoving = benchNanos(samples, [&](uint32_t i)
+	{
+		float x = moving[i & 4095][0], y = moving[i & 4095][1], z = moving[i & 4095][2];
+
+		g.acel(0.3f * moving[i & 4095][1], 0.0f, 1.0f);
+		g.apply(x, y, z);
+		benchKeep(x);
+	});
+
+	MagnCalibration m;
+
+	const double magnUsed = benchNanos(samples, [&](uint32_t i)
+	{
+		float x = turns[i & 4095][0], y = turns[i & 4095][1], z = turns[i & 4095][2];
+
+		m.apply(x, y, z);
+		benchKeep(x);
+	});
+
+	const double magnSkipped = benchNanos(samples, [&](uint32_t)
+	{
+		float x = turns[0][0], y = turns[0][1], z = turns[0][2];
+
+		m.apply(x, y, z);
+		benchKeep(x);
+	});
+
+	printf("GyroBias  still %5.1f ns  moving %5.1f ns per reading, learned while still %s\n",
+		gyroStill, gyroMoving, learning ? "yes" : "no");
+	printf("MagnCalibration  every reading used %5.1f ns  skipped %5.1f ns per reading, fit %s\n",
+		magnUsed, magnSkipped, m.valid() ? "valid" : "not valid");
+
+	return 0;
+}
@@ -0,0 +1,218 @@
+// Online calibration. Magnetometer fit on readings from a full sphere of turns finds known hard iron offsets and
+// soft iron gains, turns about one axis only for a long time never give a fit, never overflow, and full turns
+// afterwards still do. Gyro offset is learned while board lies still and left alone while it moves.
+
+#include <math.h>
+#include <stdio.h>
+
+#include "calibration.h"
+
+#include "check.h"
+
+// uniform noise in [-1, 1), same on every host
+static float noise()
+{
+	static uint32_t state = 12345;
+
+	state = state * 1664525u + 1013904223u;
+
+	return int32_t(state) * (1.0f / 2147483648.0f);
+}
+
+static const float center[3] { 120.0f, -80.0f, 60.0f };	// mGauss
+static const float radius[3] { 450.0f, 500.0f, 550.0f };
+
+// i-th of evenly spread directions on the sphere, stretched to ellipsoid, with given noise in mGauss
+static void ellipsoid(uint32_t i, float amplitude, float & x, float & y, float & z)
+{
+	const float golden = 0.618034f;
+	const float u = 1.0f - 2.0f * (i * golden - floorf(i * golden));
+	const float phi = i * 2.39996f;
+	const float r = sqrtf(1.0f - u * u);
+
+	x = center[0] + radius[0] * r * cosf(phi) + amplitude * noise();
+	y = center[1] + radius[1] * r * sinf(phi) + amplitude * noise();
+	z = center[2] + radius[2] * u + amplitude * noise();
+}
+
+// fit against known ellipsoid, offset in mGauss and gain relative
+static bool fits(const MagnCalibration & m, float offsetTolerance, float gainTolerance)
+{
+	const float mean = (radius[0] + radius[1] + radius[2]) / 3.0f;
+
+	for (uint8_t i = 0; i < 3; ++i)
+	{
+		if (!(fabsf(m.offset()[i] - center[i]) < offsetTolerance)
+			|| !(fabsf(m.scale()[i] * radius[i] / mean - 1.0f) < gainTolerance))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void sphere()
+{
+	MagnCalibration m;
+	uint32_t first = 0;
+
+	for (uint32_t i = 0; i < 20000; ++i)
+	{
+		float x, y, z;
+		ellipsoid(i, 0.0f, x, y, z);
+		m.apply(x, y, z);
+
+		if (m.valid() && first == 0)
+		{
+			first = i;
+		}
+	}
+
+	printf("full turns: fit valid after %u readings, offset %.2f %.2f %.2f mG, gain %.5f %.5f %.5f\n",
+		unsigned(first), m.offset()[0], m.offset()[1], m.offset()[2], m.scale()[0], m.scale()[1], m.scale()[2]);
+
+	CHECK(m.valid());
+	CHECK(first > 0 && first < 2000);
+	CHECK(fits(m, 0.5f, 0.001f));
+
+	// corrected readings lie on sphere of mean radius
+	const float mean = (radius[0] + radius[1] + radius[2]) / 3.0f;
+	float worst = 0.0f;
+
+	for (uint32_t i = 0; i < 100; ++i)
+	{
+		float x, y, z;
+		ellipsoid(i * 37, 0.0f, x, y, z);
+		m.apply(x, y, z);
+		worst = fmaxf(worst, fabsf(sqrtf(x * x + y * y + z * z) - mean));
+	}
+
+	CHECK(worst < 1.0f);
+
+	// noise of a few mGauss, as HMC5883L gives
+	MagnCalibration n;
+
+	for (uint32_t i = 0; i < 20000; ++i)
+	{
+		float x, y, z;
+		ellipsoid(i, 5.0f, x, y, z);
+		n.apply(x, y, z);
+	}
+
+	printf("full turns with 5 mG noise: offset %.2f %.2f %.2f mG, gain %.5f %.5f %.5f\n",
+		n.offset()[0], n.offset()[1], n.offset()[2], n.scale()[0], n.scale()[1], n.scale()[2]);
+
+	CHECK(n.valid());
+	CHECK(fits(n, 5.0f, 0.01f));
+}
+
+// board turns about z only, z offset and scale cannot be told apart from field along z
+static void planar()
+{
+	MagnCalibration m;
+	uint32_t valid = 0;
+	bool finite = true;
+
+	for (uint32_t i = 0; i < 200000; ++i)
+	{
+		const float a = i * 0.1f;
+		float x = 300.0f * cosf(a) + 50.0f;
+		float y = 250.0f * sinf(a) - 30.0f;
+		float z = 400.0f;
+
+		m.apply(x, y, z);
+
+		valid += m.valid();
+		finite = finite && isfinite(x) && isfinite(y) && isfinite(z)
+			&& isfinite(m.offset()[0]) && isfinite(m.scale()[0]);
+	}
+
+	printf("turns about z only: fit valid for %u of 200000 readings\n", unsigned(valid));
+
+	CHECK(finite);
+	CHECK(valid == 0);
+
+	// full turns later still give the fit
+	for (uint32_t i = 0; i < 20000; ++i)
+	{
+		float x, y, z;
+		ellipsoid(i, 0.0f, x, y, z);
+		m.apply(x, y, z);
+	}
+
+	CHECK(m.valid());
+	CHECK(fits(m, 0.5f, 0.001f));
+}
+
+static void gyro()
+{
+	GyroBias g;
+	const float bias[3] { 0.02f, -0.01f, 0.03f };	// rad/s
+
+	// lying still, 0.01 rad/s gyro noise, 0.005 G accelerometer noise
+	for (uint32_t i = 0; i < 3000; ++i)
+	{
+		g.acel(0.005f * noise(), 0.005f * noise(), 1.0f + 0.005f * noise());
+
+		float x = bias[0] + 0.01f * noise();
+		float y = bias[1] + 0.01f * noise();
+		float z = bias[2] + 0.01f * noise();
+
+		g.apply(x, y, z);
+	}
+
+	printf("still: offset %.5f %.5f %.5f rad/s\n", g.bias()[0], g.bias()[1], g.bias()[2]);
+
+	CHECK(g.still());
+
+	for (uint8_t i = 0; i < 3; ++i)
+	{
+		CHECK_NEAR(g.bias()[i], bias[i], 0.001f);
+	}
+
+	// turning and shaken, offset stays
+	const float learned[3] { g.bias()[0], g.bias()[1], g.bias()[2] };
+
+	for (uint32_t i = 0; i < 3000; ++i)
+	{
+		const float t = i / 800.0f;
+
+		g.acel(0.3f * sinf(7.0f * t), 0.2f * cosf(5.0f * t), 1.0f);
+
+		float x = bias[0] + 1.5f * sinf(3.0f * t);
+		float y = bias[1] + 0.8f * cosf(2.0f * t);
+		float z = bias[2];
+
+		g.apply(x, y, z);
+
+		CHECK(!g.still());
+	}
+
+	for (uint8_t i = 0; i < 3; ++i)
+	{
+		CHECK(g.bias()[i] == learned[i]);
+	}
+
+	// steady turn about vertical with accelerometer still, too fast to be an offset
+	GyroBias h;
+
+	for (uint32_t i = 0; i < 3000; ++i)
+	{
+		h.acel(0.0f, 0.0f, 1.0f);
+
+		float x = 0.0f, y = 0.0f, z = 1.0f;
+		h.apply(x, y, z);
+	}
+
+	CHECK(h.bias()[2] == 0.0f);
+}
+
+int main()
+{
+	sphere();
+	planar();
+	gyro();
+
+	return checkResult();
+}
@@ -0,0 +1,45 @@
+#ifndef check_h_
+#define check_h_
+
+#include <stdio.h>
+#include <math.h>
+
+// Minimal checks for host tests: failures are printed and counted, checkResult() is exit code of main().
+
+static unsigned checkFailures = 0;
+
+#define CHECK(condition) checkTrue((condition), #condition, __FILE__, __LINE__)
+#define CHECK_NEAR(value, expected, tolerance) checkNear((value), (expected), (tolerance), #value, __FILE__, __LINE__)
+
+inline bool checkTrue(bool ok, const char * what, const char * file, int line)
+{
+	if (!ok)
+	{
+		printf("%s:%d: failed %s\n", file, line, what);
+		++checkFailures;
+	}
+
+	return ok;
+}
+
+inline bool checkNear(double value, double expected, double tolerance, const char * what, const char * file, int line)
+{
+	const bool ok = fabs(value - expected) <= tolerance;
+
+	if (!ok)
+	{
+		printf("%s:%d: %s is %g, expected %g within %g\n", file, line, what, value, expected, tolerance);
+		++checkFailures;
+	}
+
+	return ok;
+}
+
+inline int checkResult()
+{
+	printf(checkFailures == 0 ? "ok\n" : "%u failed\n", checkFailures);
+
+	return checkFailures == 0 ? 0 : 1;
+}
+
+#endif
@@ -0,0 +1,58 @@
+// Cost of decimators per input sample, one axis and Decimate3 on three axes as Gy80 runs it.
+// Host nanoseconds, on Teensy CIC stays integer adds while float FIR and biquads depend on FPU.
+
+#include <math.h>
+#include <stdio.h>
+
+#include "decimate.h"
+#include "fixed.h"
+
+#include "bench.h"
+
+constexpr uint32_t samples = 1 << 20;
+
+static int16_t input[4096][3];
+
+template <class D>
+void bench(const char * name, D d)
+{
+	typename D::Sample out = typename D::Sample();
+
+	const double one = benchNanos(samples, [&](uint32_t i)
+	{
+		d.push(typename D::Sample(input[i & 4095][0]), out);
+		benchKeep(out);
+	});
+
+	Decimate3<D> three;
+	float out3[3];
+
+	const double all = benchNanos(samples, [&](uint32_t i)
+	{
+		three.push(input[i & 4095], out3);
+		benchKeep(out3);
+	});
+
+	printf("%-34s %6.2f ns per sample, %6.2f ns per three axis sample\n", name, one, all);
+}
+
+int main()
+{
+	// noisy rotation, 16 bit counts
+	for (uint16_t i = 0; i < 4096; ++i)
+	{
+		for (uint8_t a = 0; a < 3; ++a)
+		{
+			input[i][a] = int16_t(8000.0 * sin(0.01 * i * (a + 1)) + (i * 7919 + a * 104729) % 512 - 256);
+		}
+	}
+
+	bench("CicDecimator<8, 3>", CicDecimator<8, 3>());
+	bench("CicDecimator<4, 5>", CicDecimator<4, 5>());
+	bench("FirDecimator<float, 32, 8>", FirDecimator<float, 32, 8>());
+	bench("FirDecimator<Fixed<12>, 32, 8>", FirDecimator<Fixed<12>, 32, 8>());
+	bench("BiquadDecimator<float, 2, 8>", BiquadDecimator<float, 2, 8>());
+	bench("BiquadDecimator<Fixed<16>, 2, 8>", BiquadDecimator<Fixed<16>, 2, 8>());
+
+	return 0;
+}
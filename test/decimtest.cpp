@@ -0,0 +1,190 @@
+// Frequency response of decimators. Sine of 16 bit counts goes in, amplitude of what comes out at
+// output rate is measured by projection on the frequency it lands on, aliased or not, and compared with
+// the response the design should have: sinc^N for CIC, transform of coefficients for FIR, Butterworth for biquads.
+
+#include <math.h>
+#include <stdio.h>
+
+#include "decimate.h"
+#include "fixed.h"
+
+#include "check.h"
+
+constexpr uint16_t outputs = 1024;	// measured outputs, tones have whole cycles in them
+constexpr uint16_t settle = 256;	// outputs skipped while filter settles
+constexpr double amplitude = 12000.0;
+
+// gain at input frequency f, fraction of input rate, f has to land on whole cycles over measured outputs
+template <class D>
+double measure(D d, double f)
+{
+	double c = 0.0, s = 0.0;
+	uint32_t n = 0;
+	uint32_t taken = 0;
+
+	while (taken < settle + outputs)
+	{
+		const int16_t in = int16_t(lrint(amplitude * sin(2.0 * M_PI * f * n)));
+		++n;
+
+		typename D::Sample out;
+
+		if (!d.push(typename D::Sample(in), out))
+		{
+			continue;
+		}
+
+		if (taken >= settle)
+		{
+			// output j belongs to input n - 1, phase is taken from input time
+			const double phase = 2.0 * M_PI * f * (n - 1);
+			const double y = double(float(out)) * D::outputScale();
+
+			c += y * cos(phase);
+			s += y * sin(phase);
+		}
+
+		++taken;
+	}
+
+	return 2.0 * sqrt(c * c + s * s) / outputs / amplitude;
+}
+
+// tones that land on whole numbers of cycles over the measured outputs, band m of input rate, bin k
+static double tone(uint8_t r, uint16_t m, int16_t k)
+{
+	return (m + double(k) / outputs) / r;
+}
+
+static double cicResponse(double f, uint8_t r, uint8_t n)
+{
+	return f == 0.0 ? 1.0 : pow(fabs(sin(M_PI * f * r) / (r * sin(M_PI * f))), n);
+}
+
+static double firResponse(double f, uint8_t taps, float cutoff)
+{
+	float h[64];
+	firLowpass(h, taps, cutoff);
+
+	double c = 0.0, s = 0.0;
+
+	for (uint8_t i = 0; i < taps; ++i)
+	{
+		c += h[i] * cos(2.0 * M_PI * f * i);
+		s += h[i] * sin(2.0 * M_PI * f * i);
+	}
+
+	return sqrt(c * c + s * s);
+}
+
+// bilinear transform warps frequency by tangent
+static double butterworthResponse(double f, uint8_t sections, float cutoff)
+{
+	const double ratio = tan(M_PI * f) / tan(M_PI * cutoff);
+
+	return 1.0 / sqrt(1.0 + pow(ratio, 4 * sections));
+}
+
+static double db(double gain)
+{
+	return 20.0 * log10(gain > 1e-9 ? gain : 1e-9);
+}
+
+// after restart, first input gives output at once and it is that input, whatever came before,
+// within DC gain of rounded coefficients
+template <class D>
+void checkRestart(D d)
+{
+	typename D::Sample out = typename D::Sample();
+
+	for (int16_t i = 0; i < 1000; ++i)
+	{
+		d.push(typename D::Sample(int16_t(i * 37)), out);
+	}
+
+	d.restart();
+
+	CHECK(d.push(typename D::Sample(int16_t(-5000)), out));
+	CHECK(fabs(double(float(out)) * D::outputScale() + 5000.0) < 5.0);
+
+	// then on at full rate, steady on constant input
+	for (uint8_t i = 1; i < 4 * D::factor; ++i)
+	{
+		CHECK(d.push(typename D::Sample(int16_t(-5000)), out) == (i % D::factor == 0));
+	}
+
+	CHECK(fabs(double(float(out)) * D::outputScale() + 5000.0) < 5.0);
+}
+
+template <class D, class Expect>
+void sweep(const char * name, D d, Expect expect, double tolerance)
+{
+	const uint8_t r = D::factor;
+
+	double worst = 0.0;
+	double passEdge = 0.0;
+	double passAt = 0.0;
+	double aliasWorst = 0.0;
+
+	// pass band and band that aliases onto it, bins up to 0.45 of output rate
+	for (uint16_t m = 0; m <= 2; ++m)
+	{
+		for (int16_t k = 16; k <= outputs * 45 / 100; k += 64)
+		{
+			const double f = m == 0 ? tone(r, 0, k) : tone(r, m, -k);
+			const double measured = measure(d, f);
+			const double expected = expect(f);
+
+			const double error = fabs(measured - expected);
+			worst = error > worst ? error : worst;
+
+			if (m == 0)
+			{
+				passEdge = measured;
+				passAt = double(k) / outputs;
+			}
+			else if (measured > aliasWorst)
+			{
+				aliasWorst = measured;
+			}
+		}
+	}
+
+	printf("%-34s %6.2f dB at %.2f of output rate, aliases %7.2f dB or less, largest gain error %.2g\n",
+		name, db(passEdge), passAt, db(aliasWorst), worst);
+
+	CHECK(worst < tolerance);
+}
+
+int main()
+{
+	// CIC, shape is fixed, zeros at multiples of output rate, integer math is exact
+	sweep("CicDecimator<8, 3>", CicDecimator<8, 3>(), [](double f) { return cicResponse(f, 8, 3); }, 1e-4);
+	sweep("CicDecimator<4, 5>", CicDecimator<4, 5>(), [](double f) { return cicResponse(f, 4, 5); }, 1e-4);
+
+	// FIR, response is transform of its coefficients
+	const float fc = 0.4f / 8;
+	sweep("FirDecimator<float, 32, 8>", FirDecimator<float, 32, 8>(), [=](double f) { return firResponse(f, 32, fc); }, 1e-4);
+	sweep("FirDecimator<Fixed<12>, 32, 8>", FirDecimator<Fixed<12>, 32, 8>(), [=](double f) { return firResponse(f, 32, fc); }, 1e-3);
+
+	// biquads, Butterworth of order 4
+	sweep("BiquadDecimator<float, 2, 8>", BiquadDecimator<float, 2, 8>(), [=](double f) { return butterworthResponse(f, 2, fc); }, 1e-4);
+	sweep("BiquadDecimator<Fixed<16>, 2, 4>", BiquadDecimator<Fixed<16>, 2, 4>(), [](double f) { return butterworthResponse(f, 2, 0.1f); }, 1e-4);
+
+	checkRestart(CicDecimator<8, 3>());
+	checkRestart(CicDecimator<4, 5>());
+	checkRestart(FirDecimator<float, 32, 8>());
+	checkRestart(FirDecimator<Fixed<12>, 32, 8>());
+	checkRestart(BiquadDecimator<float, 2, 8>());
+	checkRestart(BiquadDecimator<Fixed<16>, 2, 4>());
+
+	// design goals, independent of formulas above
+	FirDecimator<float, 32, 8> fir;
+	CHECK(fabs(measure(fir, tone(8, 0, 16)) - 1.0) < 0.01);		// pass band flat
+	CHECK(measure(fir, tone(8, 1, -64)) < 0.01);				// aliasing band down 40 dB
+
+	BiquadDecimator<float, 2, 8> biquad;
+	CHECK(fabs(db(measure(biquad, fc)) + 3.01) < 0.1);			// -3 dB at cutoff
+
+	return checkResult();
+}
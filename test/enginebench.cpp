@@ -0,0 +1,64 @@
+// Cost of fusion engines: predict, correct with and without fresh magnetometer and correctGravity,
+// float on host. Accuracy of the same engines is compared by enginetest.
+
+#include <stdio.h>
+
+#include "fusion.h"
+
+#include "bench.h"
+#include "motion.h"
+
+constexpr uint32_t samples = 4096;
+constexpr float rate = 400.0f;
+
+static FilterInput inputs[samples];
+
+template <class Engine>
+void bench(const char * name)
+{
+	Engine engine;
+	engine.reset();
+
+	Quart q;
+
+	const double predict = benchNanos(samples, [&](uint32_t i)
+	{
+		engine.predict(q, inputs[i]);
+		benchKeep(q);
+	});
+
+	const double correct = benchNanos(samples, [&](uint32_t i)
+	{
+		engine.correct(q, inputs[i], true);
+		benchKeep(q);
+	});
+
+	const double reuse = benchNanos(samples, [&](uint32_t i)
+	{
+		engine.correct(q, inputs[i], false);
+		benchKeep(q);
+	});
+
+	const double gravity = benchNanos(samples, [&](uint32_t i)
+	{
+		engine.correctGravity(q, inputs[i]);
+		benchKeep(q);
+	});
+
+	printf("%-9s predict %6.1f ns  correct %6.1f ns, %6.1f ns with old field  correctGravity %6.1f ns\n",
+		name, predict, correct, reuse, gravity);
+}
+
+int main()
+{
+	for (uint32_t i = 0; i < samples; ++i)
+	{
+		inputs[i] = motionSample(i, rate);
+	}
+
+	bench<MadgwickEngineT<float>>("madgwick");
+	bench<MahonyEngineT<float>>("mahony");
+	bench<MekfEngineT<float>>("mekf");
+
+	return 0;
+}
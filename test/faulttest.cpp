@@ -0,0 +1,187 @@
+// Fault injection on SimBus: not acknowledged transfers, stalled ones that time out,
+// retries, recover() and bus going on afterwards, for engine alone and for board sensing through it.
+
+#include <stdio.h>
+
+#include "simboard.h"
+
+#include "check.h"
+
+// device that counts register accesses, retried transfers read again
+class CountingDevice : public SimDevice
+{
+public:
+	explicit CountingDevice(uint8_t address) : SimDevice(address) {}
+
+	virtual uint8_t readRegister(uint8_t reg)
+	{
+		++reads;
+		return SimDevice::readRegister(reg);
+	}
+
+	uint32_t reads = 0;
+};
+
+static uint8_t callbacks = 0;
+static int8_t callbackStatus = XFER_QUEUED;
+
+static void done(I2cTransaction & t)
+{
+	++callbacks;
+	callbackStatus = t.status;
+}
+
+static void engineFaults()
+{
+	SimBus sim;
+	CountingDevice device(0x40);
+	I2cEngine engine(sim);
+
+	sim.attach(device);
+	device.regs[0x10] = 0x5A;
+	device.regs[0x11] = 0xA5;
+
+	uint8_t data[2];
+	I2cTransaction t;
+	t.callback = done;
+
+	// one NACK, first retry gets through
+	t.prepareRead(0x40, 0x10, 2, data);
+	sim.nakNext = 1;
+	engine.submit(t);
+	CHECK(engine.wait(t) == XFER_DONE);
+	CHECK(data[0] == 0x5A && data[1] == 0xA5);
+	CHECK(callbacks == 1 && callbackStatus == XFER_DONE);
+	CHECK(sim.nakNext == 0);
+
+	// NACK on every attempt, fails after retries, callback sees failure once
+	sim.nakNext = t.retries + 1;
+	engine.submit(t);
+	CHECK(engine.wait(t) == XFER_ERROR);
+	CHECK(callbacks == 2 && callbackStatus == XFER_ERROR);
+	CHECK(sim.nakNext == 0);
+
+	// no such device
+	I2cTransaction missing;
+	uint8_t byte;
+	missing.prepareRead(0x41, 0x00, 1, &byte);
+	engine.submit(missing);
+	CHECK(engine.wait(missing) == XFER_ERROR);
+
+	// stall, slave holds bus until timeout, recover() frees it, retry reads
+	device.reads = 0;
+	sim.stallNext = 1;
+	sim.recoveries = 0;
+
+	uint32_t start = sim.clock;
+	engine.submit(t);
+	CHECK(engine.wait(t) == XFER_DONE);
+	CHECK(sim.recoveries == 1);
+	CHECK(device.reads == 2);
+	CHECK(sim.clock - start > t.timeout);
+	CHECK(sim.clock - start <= t.timeout + 4 * sim.pollTime);
+
+	// stall on every attempt, times out, bounded by (retries + 1) * timeout
+	sim.stallNext = t.retries + 1;
+	sim.recoveries = 0;
+
+	start = sim.clock;
+	engine.submit(t);
+	CHECK(engine.wait(t) == XFER_TIMEOUT);
+	CHECK(callbackStatus == XFER_TIMEOUT);
+	CHECK(sim.recoveries == t.retries + 1);
+	CHECK(sim.clock - start <= (t.retries + 1u) * (t.timeout + 2 * sim.pollTime));
+	printf("stall of every attempt timed out after %u us, %u recoveries\n", (unsigned)(sim.clock - start), sim.recoveries);
+
+	// queue behind failed one goes on, transaction without retries gives up at once
+	I2cTransaction first, second;
+	uint8_t a, b;
+	first.prepareRead(0x40, 0x10, 1, &a);
+	first.retries = 0;
+	second.prepareRead(0x40, 0x11, 1, &b);
+
+	sim.stallNext = 1;
+	sim.recoveries = 0;
+	engine.submit(first);
+	engine.submit(second);
+	CHECK(engine.wait(second) == XFER_DONE);
+	CHECK(first.status == XFER_TIMEOUT);
+	CHECK(b == 0xA5);
+	CHECK(sim.recoveries == 1);
+	CHECK(engine.idle());
+
+	// same with wire time model, timeout counts from start of transfer
+	sim.bitRate = 400000;
+	sim.setupTime = 5;
+	sim.stallNext = 1;
+	sim.recoveries = 0;
+	engine.submit(t);
+	CHECK(engine.wait(t) == XFER_DONE);
+	CHECK(data[0] == 0x5A && data[1] == 0xA5);
+	CHECK(sim.recoveries == 1);
+
+	sim.nakNext = 1;
+	engine.submit(t);
+	CHECK(engine.wait(t) == XFER_DONE);
+}
+
+// board keeps sensing through faults, every fault costs at most a few samples
+static void boardFaults()
+{
+	static SimBoard sim;
+	static Gy80 board(sim.engine);
+
+	hostClock = &sim;
+
+	CHECK(board.init() == 0);
+
+	static SampleTrack track;
+	board.setDecimation(RAW_GYRO, SampleTrack::stage, &track);
+
+	sim.restart();
+
+	uint32_t updates = 0;
+
+	for (uint32_t i = 0; i < 4000; ++i)
+	{
+		// one fault every 40 loops, by turns NACK beyond retries, single NACK and stall
+		if (i % 40 == 20)
+		{
+			switch (i / 40 % 3)
+			{
+			case 0: sim.nakNext = 3; break;
+			case 1: sim.nakNext = 1; break;
+			case 2: sim.stallNext = 1; break;
+			}
+		}
+
+		sim.run(400);
+
+		if (board.sense().ok())
+		{
+			++updates;
+		}
+	}
+
+	const uint32_t faults = 100;
+
+	printf("board: %u updates, gyro %u taken %u gaps %u duplicates, %u recoveries\n",
+		(unsigned)updates, (unsigned)track.count, (unsigned)track.gaps, (unsigned)track.duplicates, sim.recoveries);
+
+	CHECK(sim.nakNext == 0 && sim.stallNext == 0);
+	CHECK(sim.recoveries >= faults / 3);
+	CHECK(track.duplicates == 0);
+	CHECK(track.gaps <= 3 * faults);
+	CHECK(track.count + track.gaps >= 4000 * 400 / 1250 - 2);
+	CHECK(updates > 0);
+
+	hostClock = nullptr;
+}
+
+int main()
+{
+	engineFaults();
+	boardFaults();
+
+	return checkResult();
+}
@@ -0,0 +1,138 @@
+// Fixed<24> filter against float filter, and fixed point normalize at edges of range.
+// Correction is a step of fixed length beta deltaT along normalised gradient. Close to rest gradient is
+// tiny and its direction is set by rounding, in float as in fixed point, so single steps may go
+// different ways. Largest difference is held to one such step, mean one has to stay near rounding.
+
+#include "madgwick.h"
+#include "mathhelp.h"
+
+#include "check.h"
+#include "motion.h"
+
+constexpr uint32_t samples = 20000;
+constexpr float rate = 800.0f;
+
+// beta of madgwick.cpp
+constexpr float beta = 0.8660254f * deg2rad(40.0f);
+
+typedef Fixed<24> Q24;
+
+template <typename T>
+static QuartT<T> start()
+{
+	QuartT<T> q;
+
+	q.q1() = 0.9f;
+	q.q2() = 0.3f;
+	q.q3() = 0.2f;
+	q.q4() = 0.2f;
+
+	normalize(q.q1(), q.q2(), q.q3(), q.q4());
+
+	return q;
+}
+
+// whole update on every sample
+static void update()
+{
+	Quart f = start<float>();
+	QuartT<Q24> x = start<Q24>();
+
+	float worst = 0.0f;
+	double sum = 0.0;
+
+	for (uint32_t i = 0; i < samples; ++i)
+	{
+		MadgwickQuaternionUpdate(f, motionSampleT<float>(i, rate));
+		MadgwickQuaternionUpdate(x, motionSampleT<Q24>(i, rate));
+
+		const float d = quartDifference(f, x);
+		worst = fmaxf(worst, d);
+		sum += d;
+	}
+
+	printf("update   mean difference %.2e largest %.2e\n", sum / samples, worst);
+	CHECK(sum / samples < 2e-5);
+	CHECK(worst < beta / rate);
+}
+
+// predict on every sample, correct on every fourth, as FusionScheduler does
+static void multiRate()
+{
+	Quart f = start<float>();
+	QuartT<Q24> x = start<Q24>();
+	MadgwickReference rf;
+	MadgwickReferenceT<Q24> rx;
+
+	float worst = 0.0f;
+	double sum = 0.0;
+
+	for (uint32_t i = 0; i < samples; ++i)
+	{
+		FilterInput in = motionSampleT<float>(i, rate);
+		FilterInputT<Q24> ix = motionSampleT<Q24>(i, rate);
+
+		MadgwickQuaternionPredict(f, in);
+		MadgwickQuaternionPredict(x, ix);
+
+		if (i % 4 == 0)
+		{
+			in.deltaT = 4.0f / rate;
+			ix.deltaT = Q24(4.0f / rate);
+
+			MadgwickQuaternionCorrect(f, in, rf, i % 16 == 0);
+			MadgwickQuaternionCorrect(x, ix, rx, i % 16 == 0);
+		}
+
+		const float d = quartDifference(f, x);
+		worst = fmaxf(worst, d);
+		sum += d;
+	}
+
+	printf("split    mean difference %.2e largest %.2e\n", sum / samples, worst);
+	CHECK(sum / samples < 2e-5);
+	CHECK(worst < beta * 4.0f / rate);
+}
+
+// vector of given raw components comes out unit length and same direction
+static void normalized(int32_t a, int32_t b, int32_t c)
+{
+	Q24 x = Q24::fromRaw(a), y = Q24::fromRaw(b), z = Q24::fromRaw(c);
+
+	if (!CHECK(normalize(x, y, z)))
+	{
+		return;
+	}
+
+	const double length = sqrt(double(a) * a + double(b) * b + double(c) * c);
+
+	CHECK_NEAR(float(x), a / length, 1e-6);
+	CHECK_NEAR(float(y), b / length, 1e-6);
+	CHECK_NEAR(float(z), c / length, 1e-6);
+}
+
+static void normalizeRange()
+{
+	// shortest vectors, scaled up by up to 23 bits, negative components included
+	normalized(1, 0, 0);
+	normalized(-1, 0, 0);
+	normalized(-1, 1, -1);
+	normalized(3, -5, 7);
+
+	// around one and longest ones
+	normalized(Q24::one, -Q24::one / 2, Q24::one / 3);
+	normalized(INT32_MAX, -INT32_MAX, 12345);
+	normalized(INT32_MIN, 0, 1);
+
+	Q24 x, y, z;
+	CHECK(!normalize(x, y, z));
+}
+
+int main()
+{
+	update();
+	multiRate();
+	normalizeRange();
+
+	return checkResult();
+}
@@ -0,0 +1,132 @@
+// Gy80Group on several simulated buses. Buses run at the same time, so bus time of one group sense
+// has to stay that of one board however many boards there are. A board with runaway gyro has to be outvoted.
+
+#include <stdio.h>
+
+#include "gy80group.h"
+#include "simbus.h"
+
+#include "check.h"
+#include "motion.h"
+
+// board at rest whose sensors always have data, each on a bus of its own that takes time to transfer
+struct StillBoard
+{
+	StillBoard() : engine(bus), acel(ADXL345::addressLow), gyro(L3G4200D::addressHigh, 0x7F), magn(0x1E), pres(0x77), board(engine)
+	{
+		acel.regs[0x00] = 0xE5;
+		acel.regs[0x30] = 0x80;	// data ready
+		acel.regs[0x37] = 0x40;	// 1 g on z
+		gyro.regs[0x0F] = 0xD3;
+		gyro.regs[0x27] = 0x08;
+		magn.regs[0x0A] = 'H';
+		magn.regs[0x0B] = '4';
+		magn.regs[0x0C] = '3';
+		magn.regs[0x09] = 0x01;
+		magn.regs[0x03] = 0x01;	// x, big endian
+
+		pres.regs[0xD0] = 0x55;
+
+		for (uint8_t reg = 0xAA; reg < 0xC0; ++reg)
+		{
+			pres.regs[reg] = 0x11;
+		}
+
+		bus.attach(acel);
+		bus.attach(gyro);
+		bus.attach(magn);
+		bus.attach(pres);
+
+		bus.latency = 20;
+	}
+
+	SimBus bus;
+	I2cEngine engine;
+	SimDevice acel, gyro, magn, pres;
+	Gy80 board;
+};
+
+constexpr uint8_t boards = 3;
+constexpr uint32_t senses = 100;
+
+int main()
+{
+	static StillBoard still[boards];
+
+	for (StillBoard & s : still)
+	{
+		CHECK(s.board.init() == 0);
+	}
+
+	// one board alone
+	uint32_t start = still[0].bus.clock;
+
+	for (uint32_t k = 0; k < senses; ++k)
+	{
+		still[0].board.sense();
+	}
+
+	const uint32_t single = still[0].bus.clock - start;
+
+	printf("single board   %6u us bus time per %u senses\n", (unsigned)single, (unsigned)senses);
+
+	// groups of one to all boards, time of group is that of its slowest bus
+	for (uint8_t n = 1; n <= boards; ++n)
+	{
+		Gy80Group group;
+		uint32_t starts[boards];
+
+		for (uint8_t i = 0; i < n; ++i)
+		{
+			CHECK(group.add(still[i].board) == 0);
+			starts[i] = still[i].bus.clock;
+		}
+
+		uint32_t ok = 0;
+
+		for (uint32_t k = 0; k < senses; ++k)
+		{
+			ok += group.sense().ok();
+		}
+
+		uint32_t slowest = 0;
+
+		for (uint8_t i = 0; i < n; ++i)
+		{
+			const uint32_t took = still[i].bus.clock - starts[i];
+			slowest = took > slowest ? took : slowest;
+		}
+
+		printf("group of %u     %6u us bus time, %u ok, outvoted %x\n", n, (unsigned)slowest, (unsigned)ok, group.outvoted());
+
+		CHECK(ok == senses);
+		CHECK(group.outvoted() == 0);
+		CHECK(slowest <= single + single / 10);
+	}
+
+	// third board turns at about 250 dps around z, other two outvote it
+	Gy80Group group;
+
+	for (StillBoard & s : still)
+	{
+		group.add(s.board);
+	}
+
+	still[2].gyro.regs[0x2D] = 0x20;
+
+	Orientation o;
+
+	for (uint32_t k = 0; k < 2000; ++k)
+	{
+		o = group.sense();
+	}
+
+	Orientation good = still[0].board.sense();
+
+	printf("runaway board: outvoted %x, group differs from good board by %g\n", group.outvoted(), quartDifference(o.quart(), good.quart()));
+
+	CHECK(group.outvoted() == 0x4);
+	CHECK(quartDifference(o.quart(), good.quart()) < 0.01f);
+
+	return checkResult();
+}
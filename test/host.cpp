@@ -0,0 +1,83 @@
+#include <Arduino.h>
+#include <i2c_t3.h>
+
+#include "host.h"
+
+i2c_t3 Wire;
+i2c_t3 Wire1;
+i2c_t3 Wire2;
+
+SimBus * hostClock = nullptr;
+
+// clock outside simulations, every reading is 100 microseconds later so code waiting for time goes on
+static uint32_t hostMicros = 0;
+
+// pins with interrupt handlers, as attachInterrupt() got them
+constexpr uint8_t hostPins = 64;
+
+static int pinLevel[hostPins];
+static void (*pinHandler[hostPins])(void);
+static int pinEdge[hostPins];
+
+uint32_t micros()
+{
+	if (hostClock != nullptr)
+	{
+		return hostClock->clock;
+	}
+
+	return hostMicros += 100;
+}
+
+void hostPin(uint8_t pin, int level)
+{
+	const int previous = pinLevel[pin];
+	pinLevel[pin] = level;
+
+	if (pinHandler[pin] == nullptr || previous == level)
+	{
+		return;
+	}
+
+	if (pinEdge[pin] == CHANGE || (pinEdge[pin] == RISING && level == HIGH) || (pinEdge[pin] == FALLING && level == LOW))
+	{
+		pinHandler[pin]();
+	}
+}
+
+uint32_t millis()
+{
+	return micros() / 1000;
+}
+
+void delay(uint32_t)
+{
+}
+
+void delayMicroseconds(uint32_t)
+{
+}
+
+void pinMode(uint8_t, uint8_t)
+{
+}
+
+void digitalWrite(uint8_t, uint8_t)
+{
+}
+
+int digitalRead(uint8_t pin)
+{
+	return pinLevel[pin];
+}
+
+void attachInterrupt(uint8_t interrupt, void (*isr)(void), int mode)
+{
+	pinHandler[interrupt] = isr;
+	pinEdge[interrupt] = mode;
+}
+
+void detachInterrupt(uint8_t interrupt)
+{
+	pinHandler[interrupt] = nullptr;
+}
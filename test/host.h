@@ -0,0 +1,16 @@
+#ifndef host_h_
+#define host_h_
+
+#include <stdint.h>
+
+#include "simbus.h"
+
+// Test side of host stand-ins in host.cpp.
+
+// micros() follows clock of this bus while set, otherwise it moves 100 microseconds on every call
+extern SimBus * hostClock;
+
+// drive pin to level, interrupt handler attached to pin runs at once if level change matches its mode
+void hostPin(uint8_t pin, int level);
+
+#endif
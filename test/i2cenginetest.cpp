@@ -0,0 +1,314 @@
+// I2cEngine queue on SimBus: transactions run in order of submission, submitFirst() goes right behind
+// the active one, callbacks may submit again, and with completion interrupt the bus goes on through
+// a chain of transfers while nobody calls service(), as long as the main loop spends time elsewhere.
+
+#include <stdio.h>
+
+#include "i2cbus.h"
+#include "simbus.h"
+
+#include "check.h"
+
+// order callbacks ran in, by context of transaction
+static uint8_t order[16];
+static uint8_t finished = 0;
+
+static void record(I2cTransaction & t)
+{
+	if (finished < sizeof(order))
+	{
+		order[finished] = uint8_t(reinterpret_cast<uintptr_t>(t.context));
+	}
+
+	++finished;
+}
+
+struct Queue
+{
+	I2cTransaction t[4];
+	uint8_t data[4];
+
+	Queue()
+	{
+		for (uint8_t i = 0; i < 4; ++i)
+		{
+			t[i].prepareRead(0x40, i, 1, &data[i]);
+			t[i].callback = record;
+			t[i].context = reinterpret_cast<void *>(uintptr_t(i));
+		}
+	}
+};
+
+static bool ordered(const uint8_t * expected, uint8_t n)
+{
+	if (finished != n)
+	{
+		return false;
+	}
+
+	for (uint8_t i = 0; i < n; ++i)
+	{
+		if (order[i] != expected[i])
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void fifo()
+{
+	SimBus sim;
+	SimDevice device(0x40);
+	I2cEngine engine(sim);
+
+	sim.attach(device);
+	sim.latency = 3;
+
+	for (uint8_t i = 0; i < 4; ++i)
+	{
+		device.regs[i] = 0x10 + i;
+	}
+
+	Queue q;
+	finished = 0;
+
+	for (I2cTransaction & t : q.t)
+	{
+		CHECK(engine.submit(t) == 0);
+	}
+
+	// queued transaction is not queued twice
+	CHECK(engine.submit(q.t[1]) == -1);
+	CHECK(engine.submitFirst(q.t[2]) == -1);
+
+	CHECK(engine.wait(q.t[3]) == XFER_DONE);
+	CHECK(engine.idle());
+
+	const uint8_t expected[] { 0, 1, 2, 3 };
+	CHECK(ordered(expected, 4));
+	CHECK(q.data[0] == 0x10 && q.data[3] == 0x13);
+}
+
+static void first()
+{
+	SimBus sim;
+	SimDevice device(0x40);
+	I2cEngine engine(sim);
+
+	sim.attach(device);
+	sim.latency = 3;
+
+	// nothing active, goes to head
+	Queue q;
+	finished = 0;
+
+	engine.submit(q.t[0]);
+	engine.submit(q.t[1]);
+	engine.submitFirst(q.t[2]);
+	engine.wait(q.t[1]);
+
+	const uint8_t idle[] { 2, 0, 1 };
+	CHECK(ordered(idle, 3));
+
+	// active transaction is not overtaken, first submitted goes right behind it
+	finished = 0;
+
+	engine.submit(q.t[0]);
+	engine.submit(q.t[1]);
+	engine.service();
+	CHECK(q.t[0].status == XFER_ACTIVE);
+
+	engine.submitFirst(q.t[2]);
+	engine.submitFirst(q.t[3]);
+	engine.wait(q.t[1]);
+
+	const uint8_t busy[] { 0, 3, 2, 1 };
+	CHECK(ordered(busy, 4));
+
+	// submitted first behind active one as last in queue, later submit goes behind it
+	finished = 0;
+
+	engine.submit(q.t[0]);
+	engine.service();
+	engine.submitFirst(q.t[1]);
+	engine.submit(q.t[2]);
+	engine.wait(q.t[2]);
+
+	const uint8_t tail[] { 0, 1, 2 };
+	CHECK(ordered(tail, 3));
+	CHECK(engine.idle());
+}
+
+// status and data read of a sensor as Gy80Base chains them: status callback puts data read first,
+// data callback submits status again, given number of times
+struct Chain
+{
+	I2cEngine * engine;
+	I2cTransaction status;
+	I2cTransaction data;
+	I2cTransaction other;	// queued behind status, data read overtakes it
+	uint8_t statusByte;
+	uint8_t dataBytes[6];
+	uint8_t otherByte;
+	uint8_t rounds;
+	uint8_t overtaken = 0;
+
+	explicit Chain(I2cEngine & e, uint8_t rounds) : engine(&e), rounds(rounds)
+	{
+		status.prepareRead(0x40, 0x30, 1, &statusByte);
+		data.prepareRead(0x40, 0x32, 6, dataBytes);
+		other.prepareRead(0x41, 0x00, 1, &otherByte);
+		status.callback = statusDone;
+		data.callback = dataDone;
+		other.callback = otherDone;
+		status.context = this;
+		data.context = this;
+		other.context = this;
+	}
+
+	static void statusDone(I2cTransaction & t)
+	{
+		Chain & c = *static_cast<Chain *>(t.context);
+
+		c.engine->submitFirst(c.data);
+	}
+
+	static void dataDone(I2cTransaction & t)
+	{
+		Chain & c = *static_cast<Chain *>(t.context);
+
+		if (--c.rounds > 0)
+		{
+			c.engine->submit(c.status);
+		}
+	}
+
+	static void otherDone(I2cTransaction & t)
+	{
+		Chain & c = *static_cast<Chain *>(t.context);
+
+		// data read of first round went ahead, it counted rounds down already
+		c.overtaken = c.data.finished() && c.rounds < 10;
+	}
+};
+
+static void resubmit()
+{
+	SimBus sim;
+	SimDevice device(0x40);
+	SimDevice other(0x41);
+	I2cEngine engine(sim);
+
+	sim.attach(device);
+	sim.attach(other);
+	sim.latency = 2;
+
+	Chain c(engine, 10);
+
+	engine.submit(c.status);
+	engine.submit(c.other);
+
+	while (!engine.idle())
+	{
+		engine.service();
+	}
+
+	CHECK(c.rounds == 0);
+	CHECK(c.overtaken);
+	CHECK(c.status.status == XFER_DONE && c.data.status == XFER_DONE);
+}
+
+// transfers go on from completion interrupt, main loop only spends time
+static void interrupt()
+{
+	SimBus sim;
+	SimDevice device(0x40);
+	SimDevice other(0x41);
+	I2cEngine engine(sim);
+
+	sim.attach(device);
+	sim.attach(other);
+	sim.bitRate = 400000;
+	sim.setupTime = 5;
+
+	CHECK(engine.useCompletionInterrupt() == 0);
+
+	Chain c(engine, 10);
+
+	// first transaction starts at submit, bus is idle
+	const uint32_t start = sim.clock;
+	engine.submit(c.status);
+	engine.submit(c.other);
+	CHECK(c.status.status == XFER_ACTIVE);
+
+	// 10 rounds of status and data read, about 340 us a round at 400 kHz, and one other read
+	sim.advance(5000);
+
+	CHECK(engine.idle());
+	CHECK(c.rounds == 0);
+	CHECK(c.overtaken);
+	CHECK(c.data.status == XFER_DONE);
+
+	const uint32_t busy = sim.busyTime;
+	printf("interrupt driven chain of 21 reads: bus busy %u us of %u us\n", (unsigned)busy, (unsigned)(sim.clock - start));
+
+	// stalled transfer gives no interrupt, service() in main loop times it out and the retry goes on by itself
+	Queue q;
+	finished = 0;
+
+	sim.stallNext = 1;
+	engine.submit(q.t[0]);
+	engine.submit(q.t[1]);
+	sim.advance(q.t[0].timeout + 100);
+	CHECK(finished == 0);
+
+	engine.service();
+	CHECK(sim.recoveries == 1);
+	CHECK(q.t[0].status == XFER_ACTIVE);
+
+	sim.advance(1000);
+
+	const uint8_t expected[] { 0, 1 };
+	CHECK(ordered(expected, 2));
+	CHECK(engine.idle());
+}
+
+// bus that can only be polled
+class PolledBus : public I2cBus
+{
+public:
+	virtual int start(I2cTransaction &) { return 0; }
+	virtual int poll(I2cTransaction &) { return XFER_DONE; }
+	virtual void recover() {}
+	virtual uint32_t now() { return 0; }
+};
+
+static void polledOnly()
+{
+	PolledBus bus;
+	I2cEngine engine(bus);
+
+	CHECK(engine.useCompletionInterrupt() == -1);
+
+	// stays polled, nothing runs before service()
+	Queue q;
+	finished = 0;
+
+	engine.submit(q.t[0]);
+	CHECK(q.t[0].status == XFER_QUEUED);
+	CHECK(engine.wait(q.t[0]) == XFER_DONE);
+	CHECK(finished == 1);
+}
+
+int main()
+{
+	fifo();
+	first();
+	resubmit();
+	interrupt();
+	polledOnly();
+
+	return checkResult();
+}
@@ -0,0 +1,251 @@
+#ifndef madgwicklegacy_h_
+#define madgwicklegacy_h_
+
+#include "madgwick.h"
+#include "mathhelp.h"
+
+// Madgwick filter as it was written out by hand before quart.h, kept here unchanged apart from names
+// as reference for rewritetest and rewritebench.
+
+#define AX input.ax()
+#define AY input.ay()
+#define AZ input.az()
+#define GX input.gx()
+#define GY input.gy()
+#define GZ input.gz()
+#define MX input.mx()
+#define MY input.my()
+#define MZ input.mz()
+
+constexpr float legacyBeta = sqrt(3.0f / 4.0f) * deg2rad(40.0f);
+
+template <typename T>
+inline void LegacyMadgwickQuaternionUpdate(QuartT<T>& quart, FilterInputT<T> input)
+{
+	// local copies of previous values
+	T q1 = quart.q1(), q2 = quart.q2(), q3 = quart.q3(), q4 = quart.q4(); 
+
+	// auxiliary variables to avoid repeated arithmetic
+	T hx, hy, _2bx, _2bz;
+	T s1, s2, s3, s4;
+	T qDot1, qDot2, qDot3, qDot4;
+	T _2q1mx;
+	T _2q1my;
+	T _2q1mz;
+	T _2q2mx;
+	T _4bx;
+	T _4bz;
+	T _2q1 = 2.0f * q1;
+	T _2q2 = 2.0f * q2;
+	T _2q3 = 2.0f * q3;
+	T _2q4 = 2.0f * q4;
+	T _2q1q3 = 2.0f * q1 * q3;
+	T _2q3q4 = 2.0f * q3 * q4;
+	T q1q1 = q1 * q1;
+	T q1q2 = q1 * q2;
+	T q1q3 = q1 * q3;
+	T q1q4 = q1 * q4;
+	T q2q2 = q2 * q2;
+	T q2q3 = q2 * q3;
+	T q2q4 = q2 * q4;
+	T q3q3 = q3 * q3;
+	T q3q4 = q3 * q4;
+	T q4q4 = q4 * q4;
+
+	// normalise accelerometer measurement
+	if (!normalize(AX, AY, AZ))
+	{
+		return;
+	}
+
+	// normalise magnetometer measurement
+	if (!normalize(MX, MY, MZ))
+	{
+		return;
+	}
+
+	// reference direction of Earth's magnetic field
+	_2q1mx = 2.0f * q1 * MX;
+	_2q1my = 2.0f * q1 * MY;
+	_2q1mz = 2.0f * q1 * MZ;
+	_2q2mx = 2.0f * q2 * MX;
+
+	hx = MX * q1q1 - _2q1my * q4 + _2q1mz * q3 + MX * q2q2 + _2q2 * MY * q3 + _2q2 * MZ * q4 - MX * q3q3 - MX * q4q4;
+	hy = _2q1mx * q4 + MY * q1q1 - _2q1mz * q2 + _2q2mx * q3 - MY * q2q2 + MY * q3q3 + _2q3 * MZ * q4 - MY * q4q4;
+
+	_2bx = sqrt(hx * hx + hy * hy);
+	_2bz = -_2q1mx * q3 + _2q1my * q2 + MZ * q1q1 + _2q2mx * q4 - MZ * q2q2 + _2q3 * MY * q4 - MZ * q3q3 + MZ * q4q4;
+	_4bx = 2.0f * _2bx;
+	_4bz = 2.0f * _2bz;
+
+	// gradient decent algorithm corrective step
+	s1 = -_2q3 * (2.0f * q2q4 - _2q1q3 - AX) + _2q2 * (2.0f * q1q2 + _2q3q4 - AY) - _2bz * q3 * (_2bx * (0.5f - q3q3 - q4q4) + _2bz * (q2q4 - q1q3) - MX) + (-_2bx * q4 + _2bz * q2) * (_2bx * (q2q3 - q1q4) + _2bz * (q1q2 + q3q4) - MY) + _2bx * q3 * (_2bx * (q1q3 + q2q4) + _2bz * (0.5f - q2q2 - q3q3) - MZ);
+	s2 = _2q4 * (2.0f * q2q4 - _2q1q3 - AX) + _2q1 * (2.0f * q1q2 + _2q3q4 - AY) - 4.0f * q2 * (1.0f - 2.0f * q2q2 - 2.0f * q3q3 - AZ) + _2bz * q4 * (_2bx * (0.5f - q3q3 - q4q4) + _2bz * (q2q4 - q1q3) - MX) + (_2bx * q3 + _2bz * q1) * (_2bx * (q2q3 - q1q4) + _2bz * (q1q2 + q3q4) - MY) + (_2bx * q4 - _4bz * q2) * (_2bx * (q1q3 + q2q4) + _2bz * (0.5f - q2q2 - q3q3) - MZ);
+	s3 = -_2q1 * (2.0f * q2q4 - _2q1q3 - AX) + _2q4 * (2.0f * q1q2 + _2q3q4 - AY) - 4.0f * q3 * (1.0f - 2.0f * q2q2 - 2.0f * q3q3 - AZ) + (-_4bx * q3 - _2bz * q1) * (_2bx * (0.5f - q3q3 - q4q4) + _2bz * (q2q4 - q1q3) - MX) + (_2bx * q2 + _2bz * q4) * (_2bx * (q2q3 - q1q4) + _2bz * (q1q2 + q3q4) - MY) + (_2bx * q1 - _4bz * q3) * (_2bx * (q1q3 + q2q4) + _2bz * (0.5f - q2q2 - q3q3) - MZ);
+	s4 = _2q2 * (2.0f * q2q4 - _2q1q3 - AX) + _2q3 * (2.0f * q1q2 + _2q3q4 - AY) + (-_4bx * q4 + _2bz * q2) * (_2bx * (0.5f - q3q3 - q4q4) + _2bz * (q2q4 - q1q3) - MX) + (-_2bx * q1 + _2bz * q3) * (_2bx * (q2q3 - q1q4) + _2bz * (q1q2 + q3q4) - MY) + _2bx * q2 * (_2bx * (q1q3 + q2q4) + _2bz * (0.5f - q2q2 - q3q3) - MZ);
+
+	// normalise step magnitude
+	bool magOk = normalize(s1, s2, s3, s4);
+	
+	// if magnetometer measurement is missing, then don't correct
+	if (!magOk)
+	{
+		s1 = 0.0f;
+		s2 = 0.0f;
+		s3 = 0.0f;
+		s4 = 0.0f;
+	}
+
+	// compute rate of change of quaternion
+	qDot1 = 0.5f * (-q2 * GX - q3 * GY - q4 * GZ) - legacyBeta * s1;
+	qDot2 = 0.5f * ( q1 * GX + q3 * GZ - q4 * GY) - legacyBeta * s2;
+	qDot3 = 0.5f * ( q1 * GY - q2 * GZ + q4 * GX) - legacyBeta * s3;
+	qDot4 = 0.5f * ( q1 * GZ + q2 * GY - q3 * GX) - legacyBeta * s4;
+
+	// integrate to yield quaternion
+	q1 += qDot1 * input.deltaT;
+	q2 += qDot2 * input.deltaT;
+	q3 += qDot3 * input.deltaT;
+	q4 += qDot4 * input.deltaT;
+
+	// normalise quaternion
+	if (!normalize(q1, q2, q3, q4))
+	{
+		return;
+	}
+
+	quart.q1() = q1;
+	quart.q2() = q2;
+	quart.q3() = q3;
+	quart.q4() = q4;
+}
+
+template <typename T>
+inline void LegacyMadgwickQuaternionPredict(QuartT<T>& quart, FilterInputT<T> input)
+{
+	// local copies of previous values
+	T q1 = quart.q1(), q2 = quart.q2(), q3 = quart.q3(), q4 = quart.q4(); 
+
+	// compute rate of change of quaternion
+	const T qDot1 = 0.5f * (-q2 * GX - q3 * GY - q4 * GZ);
+	const T qDot2 = 0.5f * ( q1 * GX + q3 * GZ - q4 * GY);
+	const T qDot3 = 0.5f * ( q1 * GY - q2 * GZ + q4 * GX);
+	const T qDot4 = 0.5f * ( q1 * GZ + q2 * GY - q3 * GX);
+
+	// integrate to yield quaternion
+	q1 += qDot1 * input.deltaT;
+	q2 += qDot2 * input.deltaT;
+	q3 += qDot3 * input.deltaT;
+	q4 += qDot4 * input.deltaT;
+
+	// normalise quaternion
+	if (!normalize(q1, q2, q3, q4))
+	{
+		return;
+	}
+
+	quart.q1() = q1;
+	quart.q2() = q2;
+	quart.q3() = q3;
+	quart.q4() = q4;
+}
+
+template <typename T>
+inline void LegacyMadgwickQuaternionCorrect(QuartT<T>& quart, FilterInputT<T> input, MadgwickReferenceT<T>& reference, bool magnFresh)
+{
+	// local copies of previous values
+	T q1 = quart.q1(), q2 = quart.q2(), q3 = quart.q3(), q4 = quart.q4(); 
+
+	// auxiliary variables to avoid repeated arithmetic
+	T s1, s2, s3, s4;
+	T _2q1 = 2.0f * q1;
+	T _2q2 = 2.0f * q2;
+	T _2q3 = 2.0f * q3;
+	T _2q4 = 2.0f * q4;
+	T _2q1q3 = 2.0f * q1 * q3;
+	T _2q3q4 = 2.0f * q3 * q4;
+	T q1q1 = q1 * q1;
+	T q1q2 = q1 * q2;
+	T q1q3 = q1 * q3;
+	T q1q4 = q1 * q4;
+	T q2q2 = q2 * q2;
+	T q2q3 = q2 * q3;
+	T q2q4 = q2 * q4;
+	T q3q3 = q3 * q3;
+	T q3q4 = q3 * q4;
+	T q4q4 = q4 * q4;
+
+	// normalise accelerometer measurement
+	if (!normalize(AX, AY, AZ))
+	{
+		return;
+	}
+
+	// normalise magnetometer measurement
+	if (!normalize(MX, MY, MZ))
+	{
+		return;
+	}
+
+	// reference direction of Earth's magnetic field, only changes with new magnetometer reading
+	if (magnFresh || !reference.valid)
+	{
+		T _2q1mx = 2.0f * q1 * MX;
+		T _2q1my = 2.0f * q1 * MY;
+		T _2q1mz = 2.0f * q1 * MZ;
+		T _2q2mx = 2.0f * q2 * MX;
+
+		T hx = MX * q1q1 - _2q1my * q4 + _2q1mz * q3 + MX * q2q2 + _2q2 * MY * q3 + _2q2 * MZ * q4 - MX * q3q3 - MX * q4q4;
+		T hy = _2q1mx * q4 + MY * q1q1 - _2q1mz * q2 + _2q2mx * q3 - MY * q2q2 + MY * q3q3 + _2q3 * MZ * q4 - MY * q4q4;
+
+		reference._2bx = sqrt(hx * hx + hy * hy);
+		reference._2bz = -_2q1mx * q3 + _2q1my * q2 + MZ * q1q1 + _2q2mx * q4 - MZ * q2q2 + _2q3 * MY * q4 - MZ * q3q3 + MZ * q4q4;
+		reference.valid = true;
+	}
+
+	const T _2bx = reference._2bx;
+	const T _2bz = reference._2bz;
+	const T _4bx = 2.0f * _2bx;
+	const T _4bz = 2.0f * _2bz;
+
+	// gradient decent algorithm corrective step
+	s1 = -_2q3 * (2.0f * q2q4 - _2q1q3 - AX) + _2q2 * (2.0f * q1q2 + _2q3q4 - AY) - _2bz * q3 * (_2bx * (0.5f - q3q3 - q4q4) + _2bz * (q2q4 - q1q3) - MX) + (-_2bx * q4 + _2bz * q2) * (_2bx * (q2q3 - q1q4) + _2bz * (q1q2 + q3q4) - MY) + _2bx * q3 * (_2bx * (q1q3 + q2q4) + _2bz * (0.5f - q2q2 - q3q3) - MZ);
+	s2 = _2q4 * (2.0f * q2q4 - _2q1q3 - AX) + _2q1 * (2.0f * q1q2 + _2q3q4 - AY) - 4.0f * q2 * (1.0f - 2.0f * q2q2 - 2.0f * q3q3 - AZ) + _2bz * q4 * (_2bx * (0.5f - q3q3 - q4q4) + _2bz * (q2q4 - q1q3) - MX) + (_2bx * q3 + _2bz * q1) * (_2bx * (q2q3 - q1q4) + _2bz * (q1q2 + q3q4) - MY) + (_2bx * q4 - _4bz * q2) * (_2bx * (q1q3 + q2q4) + _2bz * (0.5f - q2q2 - q3q3) - MZ);
+	s3 = -_2q1 * (2.0f * q2q4 - _2q1q3 - AX) + _2q4 * (2.0f * q1q2 + _2q3q4 - AY) - 4.0f * q3 * (1.0f - 2.0f * q2q2 - 2.0f * q3q3 - AZ) + (-_4bx * q3 - _2bz * q1) * (_2bx * (0.5f - q3q3 - q4q4) + _2bz * (q2q4 - q1q3) - MX) + (_2bx * q2 + _2bz * q4) * (_2bx * (q2q3 - q1q4) + _2bz * (q1q2 + q3q4) - MY) + (_2bx * q1 - _4bz * q3) * (_2bx * (q1q3 + q2q4) + _2bz * (0.5f - q2q2 - q3q3) - MZ);
+	s4 = _2q2 * (2.0f * q2q4 - _2q1q3 - AX) + _2q3 * (2.0f * q1q2 + _2q3q4 - AY) + (-_4bx * q4 + _2bz * q2) * (_2bx * (0.5f - q3q3 - q4q4) + _2bz * (q2q4 - q1q3) - MX) + (-_2bx * q1 + _2bz * q3) * (_2bx * (q2q3 - q1q4) + _2bz * (q1q2 + q3q4) - MY) + _2bx * q2 * (_2bx * (q1q3 + q2q4) + _2bz * (0.5f - q2q2 - q3q3) - MZ);
+
+	// normalise step magnitude, nothing to correct if it is zero
+	if (!normalize(s1, s2, s3, s4))
+	{
+		return;
+	}
+
+	// step against gradient for time elapsed since previous correction
+	q1 -= legacyBeta * s1 * input.deltaT;
+	q2 -= legacyBeta * s2 * input.deltaT;
+	q3 -= legacyBeta * s3 * input.deltaT;
+	q4 -= legacyBeta * s4 * input.deltaT;
+
+	// normalise quaternion
+	if (!normalize(q1, q2, q3, q4))
+	{
+		return;
+	}
+
+	quart.q1() = q1;
+	quart.q2() = q2;
+	quart.q3() = q3;
+	quart.q4() = q4;
+}
+
+#undef AX
+#undef AY
+#undef AZ
+#undef GX
+#undef GY
+#undef GZ
+#undef MX
+#undef MY
+#undef MZ
+
+#endif
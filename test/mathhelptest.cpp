@@ -0,0 +1,72 @@
+// fastAtan2 and fastAsin against libm in double over their whole range, largest error has to stay within
+// the bounds mathhelp.h gives, 0.0016 rad and 0.00007 rad.
+
+#include <math.h>
+#include <stdio.h>
+
+#include "mathhelp.h"
+
+#include "check.h"
+
+constexpr uint32_t steps = 200000;
+
+static void atan2Sweep()
+{
+	// angle all around the circle, vector lengths from tiny to large, ratio does not depend on them
+	const float lengths[] { 1e-3f, 1.0f, 1e3f };
+	double worst = 0.0;
+
+	for (uint32_t i = 0; i <= steps; ++i)
+	{
+		const double angle = -M_PI + 2.0 * M_PI * i / steps;
+
+		for (float length : lengths)
+		{
+			const float y = float(length * sin(angle));
+			const float x = float(length * cos(angle));
+
+			double e = fabs(fastAtan2(y, x) - atan2(double(y), double(x)));
+
+			// -pi and pi are the same direction
+			if (e > M_PI)
+			{
+				e = fabs(e - 2.0 * M_PI);
+			}
+
+			worst = fmax(worst, e);
+		}
+	}
+
+	printf("fastAtan2 largest error %.6f rad\n", worst);
+
+	CHECK(worst <= 0.0016);
+	CHECK(fastAtan2(0.0f, 0.0f) == 0.0f);
+}
+
+static void asinSweep()
+{
+	double worst = 0.0;
+
+	for (uint32_t i = 0; i <= steps; ++i)
+	{
+		const float x = float(-1.0 + 2.0 * i / steps);
+
+		worst = fmax(worst, fabs(fastAsin(x) - asin(double(x))));
+	}
+
+	printf("fastAsin largest error %.7f rad\n", worst);
+
+	CHECK(worst <= 0.00007);
+
+	// readings a little outside of range, as rounding gives them, clamp
+	CHECK(fastAsin(1.0001f) == float(PI / 2));
+	CHECK(fastAsin(-1.0001f) == -float(PI / 2));
+}
+
+int main()
+{
+	atan2Sweep();
+	asinSweep();
+
+	return checkResult();
+}
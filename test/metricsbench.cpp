@@ -0,0 +1,87 @@
+// Cost of GY80_METRICS. Built twice, bin/metricsbench with plain library and bin/metricsbench-on
+// with GY80_METRICS, difference of their lines is the overhead. Bus is SimBus, so times are host time
+// of engine, simulation and counters, not wire time.
+
+#include <stdio.h>
+
+#include "simboard.h"
+
+#include "bench.h"
+
+constexpr uint32_t calls = 200000;
+
+int main()
+{
+	static SimBoard sim;
+	static Gy80 board(sim.engine);
+
+	hostClock = &sim;
+
+	if (board.init() != 0)
+	{
+		printf("init failed\n");
+		return 1;
+	}
+
+#if defined(GY80_METRICS)
+	printf("GY80_METRICS on\n");
+#else
+	printf("GY80_METRICS off\n");
+#endif
+
+	// one histogram entry, counters use the same StageStats in both builds
+	StageStats stats;
+
+	const double add = benchNanos(calls, [&](uint32_t i) { stats.add(i * 2654435761u); benchKeep(stats); });
+
+	// one accelerometer data read through engine
+	uint8_t data[6];
+	I2cTransaction t;
+
+	const double xfer = benchNanos(calls, [&](uint32_t)
+	{
+		t.prepareRead(0x53, 0x32, sizeof(data), data);
+		sim.engine.submit(t);
+		sim.engine.wait(t);
+		benchKeep(data);
+	});
+
+	// sense() at 400 us loop, sensors give 800, 800 and 75 samples per second
+	sim.restart();
+
+	float angles = 0.0f;
+
+	const double sense = benchNanos(calls / 4, [&](uint32_t)
+	{
+		sim.run(400);
+
+		Orientation o = board.sense();
+
+		if (o.ok())
+		{
+			angles += o.yaw();
+		}
+	});
+
+	benchKeep(angles);
+
+	printf("histogram entry  %6.1f ns\n", add);
+	printf("I2C transaction  %6.1f ns\n", xfer);
+	printf("sense()          %6.1f ns\n", sense);
+
+#if defined(GY80_METRICS)
+	const MetricsSnapshot m = board.metrics();
+	printf("counted %u transactions, %u bytes, %u errors\n", (unsigned)m.bus.transactions, (unsigned)m.bus.bytes, (unsigned)m.bus.errors);
+
+	// loop of 400 us takes gyro samples of 1250 us up to one loop late
+	const StageStats & d = m.sense.deltaT;
+	const StageStats & j = m.sense.jitter;
+	printf("gyro interval mean %.1f us, min %u max %u, jitter p50 %u p90 %u p99 %u us\n",
+		double(d.sum) / d.count, (unsigned)d.min, (unsigned)d.max,
+		(unsigned)j.percentile(50), (unsigned)j.percentile(90), (unsigned)j.percentile(99));
+#endif
+
+	hostClock = nullptr;
+
+	return 0;
+}
@@ -0,0 +1,68 @@
+#ifndef motion_h_
+#define motion_h_
+
+#include <math.h>
+
+#include "filterinput.h"
+#include "quart.h"
+
+// Readings of a board turning slowly on all axes with some vibration, same every run.
+// Accelerometer in G, gyro in rad/s, magnetometer in Gauss, i is sample number at given rate.
+inline FilterInput motionSample(uint32_t i, float rate)
+{
+	const float t = i / rate;
+
+	FilterInput in;
+
+	in.ax() = 0.1f * sinf(t) + 0.01f * sinf(97.0f * t);
+	in.ay() = 0.05f + 0.01f * cosf(89.0f * t);
+	in.az() = 0.98f;
+	in.gx() = 0.3f * sinf(0.7f * t);
+	in.gy() = 0.1f;
+	in.gz() = -0.2f * cosf(t);
+	in.mx() = 0.25f;
+	in.my() = 0.03f + 0.02f * sinf(0.3f * t);
+	in.mz() = 0.4f;
+	in.deltaT = 1.0f / rate;
+
+	return in;
+}
+
+// same in scalar type of filter
+template <typename T>
+inline FilterInputT<T> motionSampleT(uint32_t i, float rate)
+{
+	const FilterInput in = motionSample(i, rate);
+
+	FilterInputT<T> result;
+
+	for (uint8_t k = 0; k < 9; ++k)
+	{
+		result.values[k] = T(in.values[k]);
+	}
+
+	result.deltaT = T(in.deltaT);
+
+	return result;
+}
+
+// largest difference of quaternion components, q and -q are same orientation
+template <typename A, typename B>
+inline float quartDifference(const QuartT<A> & a, const QuartT<B> & b)
+{
+	const float x[4] { float(a.q1()), float(a.q2()), float(a.q3()), float(a.q4()) };
+	const float y[4] { float(b.q1()), float(b.q2()), float(b.q3()), float(b.q4()) };
+
+	float plus = 0.0f;
+	float minus = 0.0f;
+
+	for (uint8_t i = 0; i < 4; ++i)
+	{
+		plus = fmaxf(plus, fabsf(x[i] - y[i]));
+		minus = fmaxf(minus, fabsf(x[i] + y[i]));
+	}
+
+	return fminf(plus, minus);
+}
+
+#endif
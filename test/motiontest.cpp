@@ -0,0 +1,165 @@
+// Motion gate with data ready interrupts on simulated board. Activity and inactivity share ADXL345 INT1
+// with data ready, so status is read once per accelerometer edge instead of once per sense(). Gyro decimation
+// starts over on wake, first output after it holds nothing from before sleep.
+
+#include "simboard.h"
+
+#include "check.h"
+
+constexpr uint8_t acelPin = 2;
+constexpr uint8_t gyroPin = 3;
+constexpr uint8_t magnPin = 4;
+
+// gyro decimation that notes what restart did
+struct Recorder
+{
+	Decimate3<FirDecimator<float, 16, 4>> decimate;
+
+	uint32_t outputs = 0;
+	bool restarted = false;
+	bool pushed = false;	// input came since restart
+	bool answered = false;	// output came since restart
+	bool atOnce = false;	// first input after restart gave output
+	int16_t firstRaw = 0;
+	float firstOut = 0.0f;
+
+	static bool stage(const int16_t * raw, float * out, void * context)
+	{
+		Recorder & r = *static_cast<Recorder *>(context);
+
+		const bool first = r.restarted && !r.pushed;
+
+		if (first)
+		{
+			r.firstRaw = raw[0];
+			r.pushed = true;
+		}
+
+		if (!r.decimate.push(raw, out))
+		{
+			return false;
+		}
+
+		++r.outputs;
+
+		if (r.restarted && !r.answered)
+		{
+			r.firstOut = out[0];
+			r.answered = true;
+			r.atOnce = first;
+		}
+
+		return true;
+	}
+
+	static void restart(void * context)
+	{
+		Recorder & r = *static_cast<Recorder *>(context);
+
+		r.decimate.restart();
+		r.restarted = true;
+	}
+};
+
+int main()
+{
+	static SimBoard sim;
+	static Gy80 board(sim.engine);
+	static Recorder recorder;
+
+	hostClock = &sim;
+
+	// gyro stops with power down bit, magnetometer in idle mode
+	sim.gyro.power(0x20, 0x08, 0x08);
+	sim.magn.power(0x02, 0x03, 0x00);
+
+	if (!CHECK(board.init() == 0))
+	{
+		return checkResult();
+	}
+
+	board.setDecimation(RAW_GYRO, Recorder::stage, &recorder, Recorder::restart);
+
+	sim.acel.connect(acelPin, SimSensor::LINE_LEVEL);
+	sim.gyro.connect(gyroPin, SimSensor::LINE_LEVEL);
+	sim.magn.connect(magnPin, SimSensor::LINE_PULSE);
+
+	CHECK(board.initInterrupts(acelPin, gyroPin, magnPin) == 0);
+	CHECK(board.initMotionGate(16, 4, 5) == 0);
+	CHECK((sim.acel.regs[0x2F] & 0x18) == 0);	// activity and inactivity on INT1
+
+	// active, status is read for accelerometer samples only
+	const uint32_t senses = 2000;
+	uint32_t acelBefore = sim.acel.produced();
+	uint32_t readsBefore = sim.acel.statusReads;
+
+	for (uint32_t i = 0; i < senses; ++i)
+	{
+		sim.run(400);
+		board.sense();
+	}
+
+	const uint32_t acelSamples = sim.acel.produced() - acelBefore;
+	const uint32_t statusReads = sim.acel.statusReads - readsBefore;
+
+	printf("active: %u senses, %u accelerometer samples, %u status reads\n", (unsigned)senses, (unsigned)acelSamples, (unsigned)statusReads);
+
+	CHECK(statusReads <= acelSamples + 1);
+	CHECK(board.motionGate().state() == MOTION_ACTIVE);
+	CHECK(recorder.outputs > 0);
+
+	// inactivity comes on INT1 while data ready line may be up or down
+	sim.acel.raise(ADXL345::inactivityBit);
+
+	for (uint32_t i = 0; i < 10; ++i)
+	{
+		sim.run(400);
+		board.sense();
+	}
+
+	CHECK(board.motionGate().state() == MOTION_INACTIVE);
+	CHECK(board.motionGate().sleeps() == 1);
+	CHECK((sim.gyro.regs[0x20] & 0x08) == 0);
+	CHECK(sim.magn.regs[0x02] == 0x02);
+
+	const uint32_t outputsAsleep = recorder.outputs;
+
+	readsBefore = sim.acel.statusReads;
+
+	for (uint32_t i = 0; i < senses; ++i)
+	{
+		sim.run(400);
+		board.sense();
+	}
+
+	printf("asleep: %u status reads, %u gyro outputs\n", (unsigned)(sim.acel.statusReads - readsBefore), (unsigned)(recorder.outputs - outputsAsleep));
+
+	CHECK(recorder.outputs == outputsAsleep);
+	CHECK(!recorder.restarted);
+
+	// activity wakes, first gyro sample after wake gives output at once and it is that sample alone
+	sim.acel.raise(ADXL345::activityBit);
+
+	const uint32_t wokeAt = sim.clock;
+
+	for (uint32_t i = 0; i < 20; ++i)
+	{
+		sim.run(400);
+		board.sense();
+	}
+
+	printf("awake: wake latency %u us, first gyro output %g from sample %d\n", (unsigned)board.motionGate().wakeLatency(), recorder.firstOut, recorder.firstRaw);
+
+	CHECK(board.motionGate().state() == MOTION_ACTIVE);
+	CHECK((sim.gyro.regs[0x20] & 0x08) != 0);
+	CHECK(sim.magn.regs[0x02] == 0x00);
+	CHECK(recorder.restarted && recorder.answered);
+	CHECK(recorder.atOnce);
+	CHECK(fabsf(recorder.firstOut - recorder.firstRaw) < 0.01f);
+	CHECK(board.motionGate().wakeLatency() <= 1250 + 400);
+	CHECK(sim.clock - wokeAt < 20 * 400 + 2000);
+
+	hostClock = nullptr;
+
+	return checkResult();
+}
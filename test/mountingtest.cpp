@@ -0,0 +1,155 @@
+// AxisMap and MountRotation. All 24 axis aligned mountings are instantiated and checked against
+// their rotation matrix, against MountRotation of the same matrix and at int16 full scale, where a flip saturates.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "mounting.h"
+
+#include "check.h"
+
+// the 24 rotations in order of enumeration
+struct RotationTable
+{
+	constexpr RotationTable() : x(), y(), z()
+	{
+		uint8_t n = 0;
+
+		for (int8_t i = AXIS_NZ; i <= AXIS_Z; ++i)
+			for (int8_t j = AXIS_NZ; j <= AXIS_Z; ++j)
+				for (int8_t k = AXIS_NZ; k <= AXIS_Z; ++k)
+					if (axisHandedness(Axis(i), Axis(j), Axis(k)) == 1)
+					{
+						x[n] = Axis(i);
+						y[n] = Axis(j);
+						z[n] = Axis(k);
+						++n;
+					}
+	}
+
+	Axis x[24], y[24], z[24];
+};
+
+constexpr RotationTable rotations;
+
+static uint32_t seed = 12345;
+
+static int16_t randomCount()
+{
+	seed = seed * 1664525u + 1013904223u;
+	return int16_t(seed >> 16);
+}
+
+// matrices of all mountings, to check they differ
+static int8_t matrices[24][9];
+
+template <uint8_t I>
+static void checkRotation()
+{
+	typedef AxisMap<rotations.x[I], rotations.y[I], rotations.z[I]> Map;
+	typedef MountRotation<Map> Rotation;
+
+	// matrix is orthonormal with determinant 1
+	int8_t m[3][3];
+
+	for (uint8_t r = 0; r < 3; ++r)
+		for (uint8_t c = 0; c < 3; ++c)
+			m[r][c] = matrices[I][r * 3 + c] = Map::at(r, c);
+
+	for (uint8_t a = 0; a < 3; ++a)
+		for (uint8_t b = 0; b < 3; ++b)
+			CHECK(m[a][0] * m[b][0] + m[a][1] * m[b][1] + m[a][2] * m[b][2] == (a == b ? 1 : 0));
+
+	const int det = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+		- m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+		+ m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+	CHECK(det == 1);
+
+	for (uint16_t n = 0; n < 1000; ++n)
+	{
+		// float, AxisMap is matrix product exactly, as is MountRotation of it
+		const float s[3] { randomCount() * 0.01f, randomCount() * 0.01f, randomCount() * 0.01f };
+		float a[3] { s[0], s[1], s[2] }, b[3] { s[0], s[1], s[2] };
+
+		Map::apply(a);
+		Rotation::apply(b);
+
+		for (uint8_t r = 0; r < 3; ++r)
+		{
+			CHECK(a[r] == m[r][0] * s[0] + m[r][1] * s[1] + m[r][2] * s[2]);
+			CHECK(a[r] == b[r]);
+		}
+
+		// counts, full scale ends come up often
+		int16_t raw[3] { randomCount(), randomCount(), randomCount() };
+
+		if (n % 4 == 0)
+		{
+			raw[n / 4 % 3] = n % 8 == 0 ? INT16_MIN : INT16_MAX;
+		}
+
+		int16_t c[3] { raw[0], raw[1], raw[2] }, d[3] { raw[0], raw[1], raw[2] };
+
+		Map::apply(c);
+		Rotation::apply(d);
+
+		for (uint8_t r = 0; r < 3; ++r)
+		{
+			int32_t e = m[r][0] * raw[0] + m[r][1] * raw[1] + m[r][2] * raw[2];
+			e = e > INT16_MAX ? INT16_MAX : e;
+
+			CHECK(c[r] == e);
+			CHECK(c[r] == d[r]);
+		}
+	}
+}
+
+template <uint8_t... I>
+struct Rotations
+{
+	static void check()
+	{
+		const int dummy[] { (checkRotation<I>(), 0)... };
+		(void)dummy;
+	}
+};
+
+// 45 degrees around z, rotated full scale vector is longer along y than any raw one
+struct Turn45
+{
+	static constexpr float at(uint8_t row, uint8_t col)
+	{
+		return row == 2 || col == 2 ? (row == col ? 1.0f : 0.0f) : (row == col ? 0.70710678f : row == 0 ? -0.70710678f : 0.70710678f);
+	}
+};
+
+int main()
+{
+	Rotations<0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23>::check();
+
+	// every mounting is a different one
+	uint8_t same = 0;
+
+	for (uint8_t i = 0; i < 24; ++i)
+		for (uint8_t j = i + 1; j < 24; ++j)
+			same += memcmp(matrices[i], matrices[j], sizeof(matrices[i])) == 0;
+
+	CHECK(same == 0);
+
+	// saturation of general rotation, rounding to nearest
+	int16_t v[3] { INT16_MAX, INT16_MAX, 100 };
+	MountRotation<Turn45>::apply(v);
+	CHECK(v[0] == 0 && v[1] == INT16_MAX && v[2] == 100);
+
+	int16_t w[3] { INT16_MIN, INT16_MIN, INT16_MIN };
+	MountRotation<Turn45>::apply(w);
+	CHECK(w[0] == 0 && w[1] == INT16_MIN && w[2] == INT16_MIN);
+
+	int16_t u[3] { 3, 1, 0 };
+	MountRotation<Turn45>::apply(u);
+	CHECK(u[0] == 1 && u[1] == 3);
+
+	printf("24 mountings checked\n");
+
+	return checkResult();
+}
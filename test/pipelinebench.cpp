@@ -0,0 +1,193 @@
+// Gy80::sense() against Gy80Base::sensePipelined(), built with GY80_PIPELINE.
+// One board on SimBoard with wire timing and completion interrupts, sensors produce samples at rates of their own,
+// math time is charged per reading on simulated clock, bus goes on from interrupts meanwhile, so numbers are
+// same on every host. Prints filter steps per second, gyro samples missed and latency from gyro sample to
+// orientation computed from it. sense() is shown polled and with completion interrupt, which gains it nothing.
+// Fails if board does not sense, or does not go back to sense() after pipelined run.
+
+#include <stdio.h>
+
+#include "gy-80.h"
+
+#include "simboard.h"
+
+struct Config
+{
+	uint32_t bitRate;	// bits per second
+	uint16_t filter;	// microseconds of math per gyro reading, runs filter step
+};
+
+constexpr uint16_t setupTime = 5;	// microseconds of controller setup per transfer phase
+constexpr uint16_t pollTime = 1;	// microseconds one bus poll takes
+constexpr uint16_t acelCost = 15;	// microseconds of math per accelerometer reading
+constexpr uint16_t magnCost = 40;
+constexpr uint32_t duration = 2000000;
+
+struct Result
+{
+	uint32_t steps = 0;
+	uint32_t missed = 0;
+	float rate = 0.0f;
+	float latency = 0.0f;
+	uint32_t latencyMax = 0;
+	float busLoad = 0.0f;
+};
+
+// decimation stage in front of filter, charges math time of reading to simulated clock
+// and notes production time of sample
+struct Charge
+{
+	SimBoard * board;
+	SimSensor * sensor;
+	uint16_t cost;
+	uint32_t sampleTime; // of reading taken last
+
+	static bool stage(const int16_t * raw, float * out, void * context)
+	{
+		Charge & c = *static_cast<Charge *>(context);
+
+		c.board->advance(c.cost);
+		c.sampleTime = c.sensor->sampleTime(raw[0]);
+
+		out[0] = 0.0f;
+		out[1] = raw[1];
+		out[2] = raw[2];
+
+		return true;
+	}
+};
+
+static int simulate(const Config & config, bool pipelined, bool interrupt, Result & result)
+{
+	// about 800 Hz, 800 Hz and 75 Hz, sensors have clocks of their own, so they drift against each other
+	SimBoard sim(1247, 1263, 13333);
+	Gy80 board(sim.engine);
+
+	hostClock = &sim;
+
+	// set up on untimed bus, only sensing is measured
+	if (board.init() != 0)
+	{
+		hostClock = nullptr;
+		return -1;
+	}
+
+	sim.bitRate = config.bitRate;
+	sim.setupTime = setupTime;
+	sim.pollTime = pollTime;
+
+	if (interrupt && sim.engine.useCompletionInterrupt() != 0)
+	{
+		hostClock = nullptr;
+		return -1;
+	}
+
+	Charge charges[3]
+	{
+		{ &sim, &sim.acel, acelCost, 0 },
+		{ &sim, &sim.gyro, config.filter, 0 },
+		{ &sim, &sim.magn, magnCost, 0 },
+	};
+
+	board.setDecimation(RAW_ACEL, Charge::stage, &charges[RAW_ACEL]);
+	board.setDecimation(RAW_GYRO, Charge::stage, &charges[RAW_GYRO]);
+	board.setDecimation(RAW_MAGN, Charge::stage, &charges[RAW_MAGN]);
+
+	sim.restart();
+
+	const uint32_t start = sim.clock;
+	const uint32_t busy = sim.busyTime;
+
+	uint64_t latencySum = 0;
+
+	while (sim.clock - start < duration)
+	{
+		Orientation o = pipelined ? board.sensePipelined() : board.sense();
+
+		if (o.ok())
+		{
+			const uint32_t latency = sim.clock - charges[RAW_GYRO].sampleTime;
+
+			latencySum += latency;
+
+			if (latency > result.latencyMax)
+			{
+				result.latencyMax = latency;
+			}
+
+			++result.steps;
+		}
+	}
+
+	const float elapsed = float(sim.clock - start);
+
+	result.missed = sim.gyro.missed;
+	result.rate = result.steps * 1000000.0f / elapsed;
+	result.latency = result.steps > 0 ? float(latencySum) / result.steps : 0.0f;
+	result.busLoad = float(sim.busyTime - busy) / elapsed;
+
+	if (pipelined)
+	{
+		board.stopPipeline();
+
+		if (!sim.engine.idle())
+		{
+			hostClock = nullptr;
+			return -1;
+		}
+
+		// sense() works again, 16 gyro samples in 20 ms, at least 12 taken even with slowest filter
+		const uint32_t stop = sim.clock;
+		uint32_t ok = 0;
+
+		while (sim.clock - stop < 20000)
+		{
+			ok += board.sense().ok();
+		}
+
+		if (ok < 10)
+		{
+			hostClock = nullptr;
+			return -1;
+		}
+	}
+
+	hostClock = nullptr;
+
+	return result.steps > 0 ? 0 : -1;
+}
+
+int main()
+{
+	static const Config configs[]
+	{
+		{ 400000, 30 }, { 400000, 150 }, { 400000, 400 }, { 400000, 600 }, { 400000, 800 },
+		{ 1000000, 30 }, { 1000000, 150 }, { 1000000, 400 }, { 1000000, 800 },
+	};
+
+	// sensePipelined() turns completion interrupt on by itself
+	static const char * const names[3] { "sense() polled", "sense() irq", "pipelined" };
+
+	for (const Config & config : configs)
+	{
+		for (uint8_t way = 0; way < 3; ++way)
+		{
+			const bool pipelined = way == 2;
+			const bool interrupt = way == 1;
+
+			Result r;
+
+			if (simulate(config, pipelined, interrupt, r) != 0)
+			{
+				printf("board does not sense\n");
+				return 1;
+			}
+
+			printf("%4u kHz filter %3u us %-14s %6.1f steps/s missed %4u latency %6.1f us max %5u bus load %3.0f%%\n",
+				unsigned(config.bitRate / 1000), unsigned(config.filter), names[way],
+				r.rate, unsigned(r.missed), r.latency, unsigned(r.latencyMax), r.busLoad * 100.0f);
+		}
+	}
+
+	return 0;
+}
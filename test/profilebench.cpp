@@ -0,0 +1,51 @@
+// Stages of Gy80::sense() on simulated bus. Library is built with GY80_PROFILE for this one.
+// Prints Profiler::report() CSV, host counts nanoseconds, so per_second is how often a stage fits in a second.
+// Bus transfers cost only host time of engine and SimBus here, on target the same report comes with wire time.
+
+#include <stdio.h>
+
+#include "simboard.h"
+
+constexpr uint32_t senses = 200000;
+
+int main()
+{
+	static SimBoard sim;
+	static Gy80 board(sim.engine);
+
+	hostClock = &sim;
+
+	if (board.init() != 0)
+	{
+		printf("init failed\n");
+		return 1;
+	}
+
+	sim.restart();
+	board.profile().clear();
+
+	float angles = 0.0f;
+
+	for (uint32_t i = 0; i < senses; ++i)
+	{
+		// main loop comes round every 400 us, sensors give 800, 800 and 75 samples per second
+		sim.run(400);
+
+		Orientation o = board.sense();
+
+		if (o.ok())
+		{
+			angles += o.yaw() + o.pitch() + o.roll();
+		}
+	}
+
+	static char report[1024];
+
+	const size_t size = board.profile().report(report, sizeof(report));
+
+	fwrite(report, 1, size < sizeof(report) ? size : sizeof(report) - 1, stdout);
+
+	hostClock = nullptr;
+
+	return isfinite(angles) ? 0 : 1;
+}
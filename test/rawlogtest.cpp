@@ -0,0 +1,161 @@
+// Raw log written through a sink that takes short counts, read back and replayed.
+// Every record that was not dropped has to come back whole, in order, at its place in the file.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "rawlog.h"
+#include "rawreplay.h"
+
+#include "check.h"
+
+constexpr uint32_t records = 5000;
+
+// appends to file, takes fewer bytes than offered on most calls, cut falls anywhere in a record
+struct ShortSink
+{
+	FILE * file;
+	uint32_t calls;
+	uint32_t refusals; // calls that took nothing
+};
+
+static size_t shortSink(const uint8_t * data, size_t size, void * context)
+{
+	ShortSink & s = *static_cast<ShortSink *>(context);
+
+	++s.calls;
+
+	// header goes through whole
+	if (s.calls == 1)
+	{
+		return fwrite(data, 1, size, s.file);
+	}
+
+	size_t take = size;
+
+	switch (s.calls % 5)
+	{
+	case 0:
+		take = 0; // card busy
+		++s.refusals;
+		break;
+
+	case 1:
+		take = size / 3 + 5;
+		break;
+
+	case 2:
+		take = 7;
+		break;
+
+	default:
+		break;
+	}
+
+	take = take < size ? take : size;
+
+	return fwrite(data, 1, take, s.file);
+}
+
+struct Replayed
+{
+	uint32_t gyro;
+};
+
+static void replayed(uint32_t, QuartT<FusionScalar> & quart, void * context)
+{
+	++static_cast<Replayed *>(context)->gyro;
+
+	CHECK(isfinite(float(quart.q1())));
+}
+
+int main()
+{
+	char path[] = "/tmp/rawlogtestXXXXXX";
+	const int fd = mkstemp(path);
+
+	if (!CHECK(fd >= 0))
+	{
+		return checkResult();
+	}
+
+	ShortSink sink { fdopen(fd, "wb"), 0, 0 };
+	RawLogWriter writer(shortSink, &sink);
+
+	CHECK(writer.begin(0.004f, 0.0003f, 0.92f) == 0);
+
+	uint32_t gyro = 0;
+
+	for (uint32_t i = 0; i < records; ++i)
+	{
+		const RawSensor sensor = RawSensor(i % 3);
+		const int16_t raw[3] { int16_t(i), int16_t(i >> 16), int16_t(-int16_t(i)) };
+
+		writer.write(sensor, i * 100, raw);
+
+		// explicit flush now and then, cuts blocks short as a logger does at end of a burst
+		if (i % 97 == 0)
+		{
+			writer.flush();
+		}
+
+		gyro += sensor == RAW_GYRO;
+	}
+
+	// sink keeps taking short counts, retry until all is out
+	for (uint8_t i = 0; i < 100 && writer.flush() != 0; ++i)
+	{
+	}
+
+	CHECK(writer.flush() == 0);
+	fclose(sink.file);
+
+	RawLogReplay replay;
+
+	if (!CHECK(replay.open(path) == 0))
+	{
+		unlink(path);
+		return checkResult();
+	}
+
+	const RawLogReader & log = replay.reader();
+
+	printf("%u sink calls, %u refused, %zu records read, %u dropped\n",
+		unsigned(sink.calls), unsigned(sink.refusals), log.count(), unsigned(writer.dropped()));
+
+	CHECK(log.count() + writer.dropped() == records);
+	CHECK(sink.refusals > 0);
+
+	// records carry their number, dropped ones leave gaps but each record is whole and in order
+	uint32_t previous = 0;
+	uint32_t replayedGyro = 0;
+
+	for (size_t i = 0; i < log.count(); ++i)
+	{
+		const RawLogRecord & r = log[i];
+		const uint32_t n = r.time / 100;
+
+		const bool whole = r.time % 100 == 0 && r.sensor == n % 3 && r.flags == 0 &&
+			r.raw[0] == int16_t(n) && r.raw[1] == int16_t(n >> 16) && r.raw[2] == int16_t(-int16_t(n));
+
+		if (!CHECK(whole) || !CHECK(i == 0 || n > previous))
+		{
+			break;
+		}
+
+		previous = n;
+		replayedGyro += r.sensor == RAW_GYRO;
+	}
+
+	FusionScheduler fusion;
+	Replayed out { 0 };
+
+	CHECK(replay.run(fusion, replayed, &out) == log.count());
+	CHECK(out.gyro == replayedGyro);
+	CHECK(replayedGyro <= gyro);
+
+	unlink(path);
+
+	return checkResult();
+}
@@ -0,0 +1,77 @@
+// Madgwick steps written with quart.h against the hand expanded code they replaced.
+// Same inputs as scalarbench, rewritetest checks both give the same quaternions.
+
+#include <stdio.h>
+
+#include "madgwick.h"
+
+#include "bench.h"
+#include "madgwicklegacy.h"
+#include "motion.h"
+
+constexpr uint32_t samples = 4096;
+constexpr float rate = 800.0f;
+
+template <typename T>
+static void run(const char * name)
+{
+	static FilterInputT<T> inputs[samples];
+
+	for (uint32_t i = 0; i < samples; ++i)
+	{
+		inputs[i] = motionSampleT<T>(i, rate);
+	}
+
+	QuartT<T> q(T(1.0f), T(), T(), T());
+	MadgwickReferenceT<T> reference;
+
+	const double update = benchNanos(samples, [&](uint32_t i)
+	{
+		MadgwickQuaternionUpdate(q, inputs[i]);
+		benchKeep(q);
+	});
+
+	const double legacyUpdate = benchNanos(samples, [&](uint32_t i)
+	{
+		LegacyMadgwickQuaternionUpdate(q, inputs[i]);
+		benchKeep(q);
+	});
+
+	const double predict = benchNanos(samples, [&](uint32_t i)
+	{
+		MadgwickQuaternionPredict(q, inputs[i]);
+		benchKeep(q);
+	});
+
+	const double legacyPredict = benchNanos(samples, [&](uint32_t i)
+	{
+		LegacyMadgwickQuaternionPredict(q, inputs[i]);
+		benchKeep(q);
+	});
+
+	const double correct = benchNanos(samples, [&](uint32_t i)
+	{
+		MadgwickQuaternionCorrect(q, inputs[i], reference, i % 4 == 0);
+		benchKeep(q);
+	});
+
+	reference.valid = false;
+
+	const double legacyCorrect = benchNanos(samples, [&](uint32_t i)
+	{
+		LegacyMadgwickQuaternionCorrect(q, inputs[i], reference, i % 4 == 0);
+		benchKeep(q);
+	});
+
+	printf("%-9s update %6.1f ns (was %6.1f)  predict %6.1f ns (was %6.1f)  correct %6.1f ns (was %6.1f)\n",
+		name, update, legacyUpdate, predict, legacyPredict, correct, legacyCorrect);
+}
+
+int main()
+{
+	run<float>("float");
+	run<double>("double");
+	run<Fixed<24>>("Fixed<24>");
+
+	return 0;
+}
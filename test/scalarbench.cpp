@@ -0,0 +1,55 @@
+// Madgwick steps in float, double and Fixed<24>. Host numbers only rank the types against each other,
+// float and double both run on FPU here, Fixed<24> shows cost of integer arithmetic a core without FPU pays.
+
+#include <stdio.h>
+
+#include "madgwick.h"
+
+#include "bench.h"
+#include "motion.h"
+
+constexpr uint32_t samples = 4096;
+constexpr float rate = 800.0f;
+
+template <typename T>
+static void run(const char * name)
+{
+	static FilterInputT<T> inputs[samples];
+
+	for (uint32_t i = 0; i < samples; ++i)
+	{
+		inputs[i] = motionSampleT<T>(i, rate);
+	}
+
+	QuartT<T> q(T(1.0f), T(), T(), T());
+	MadgwickReferenceT<T> reference;
+
+	const double update = benchNanos(samples, [&](uint32_t i)
+	{
+		MadgwickQuaternionUpdate(q, inputs[i]);
+		benchKeep(q);
+	});
+
+	const double predict = benchNanos(samples, [&](uint32_t i)
+	{
+		MadgwickQuaternionPredict(q, inputs[i]);
+		benchKeep(q);
+	});
+
+	const double correct = benchNanos(samples, [&](uint32_t i)
+	{
+		MadgwickQuaternionCorrect(q, inputs[i], reference, i % 4 == 0);
+		benchKeep(q);
+	});
+
+	printf("%-9s update %6.1f ns  predict %6.1f ns  correct %6.1f ns\n", name, update, predict, correct);
+}
+
+int main()
+{
+	run<float>("float");
+	run<double>("double");
+	run<Fixed<24>>("Fixed<24>");
+
+	return 0;
+}
@@ -0,0 +1,303 @@
+#ifndef simboard_h_
+#define simboard_h_
+
+#include "gy-80.h"
+#include "simbus.h"
+
+#include "host.h"
+
+// Simulated GY-80 for host tests, sensors on SimBus produce samples by bus clock.
+// Reading first data register takes newest sample, x axis of data holds its number so tests can tell
+// which sample a reading came from, y and z hold fixed values.
+class SimSensor : public SimDevice
+{
+public:
+	enum Line : uint8_t
+	{
+		LINE_NONE,
+		LINE_LEVEL,	// high while sample is unread, ADXL345 INT1 and L3G4200D INT2
+		LINE_PULSE,	// low pulse for every sample, HMC5883L DRDY
+	};
+
+	SimSensor(SimBus & bus, uint8_t address, uint8_t registerMask, uint8_t status, uint8_t readyBit, uint8_t data, bool bigEndian, uint32_t period) :
+		SimDevice(address, registerMask), bus(bus), status(status), readyBit(readyBit), data(data), bigEndian(bigEndian), period(period) {}
+
+	virtual uint8_t readRegister(uint8_t reg)
+	{
+		const uint32_t produced = this->produced();
+
+		if (reg == status)
+		{
+			// reading status clears events, line stays up only for unread sample
+			const uint8_t s = (produced > taken ? readyBit : 0) | events;
+
+			events = 0;
+			++statusReads;
+
+			if (line == LINE_LEVEL && produced <= taken)
+			{
+				hostPin(pin, LOW);
+			}
+
+			return s;
+		}
+
+		if (reg == data && produced > taken)
+		{
+			missed += produced - taken - 1;
+			taken = produced;
+
+			regs[data + (bigEndian ? 1 : 0)] = uint8_t(produced);
+			regs[data + (bigEndian ? 0 : 1)] = uint8_t(produced >> 8);
+
+			// reading data lowers level line at once
+			if (line == LINE_LEVEL)
+			{
+				hostPin(pin, LOW);
+			}
+		}
+
+		return regs[reg];
+	}
+
+	virtual void writeRegister(uint8_t reg, uint8_t value)
+	{
+		SimDevice::writeRegister(reg, value);
+
+		if (powerMask == 0 || reg != powerReg)
+		{
+			return;
+		}
+
+		const bool off = (value & powerMask) != powerOn;
+
+		if (off && !asleep)
+		{
+			sleptAt = bus.clock;
+		}
+		else if (!off && asleep)
+		{
+			sleepTime += bus.clock - sleptAt;
+		}
+
+		asleep = off;
+	}
+
+	// sensor makes samples only while bits of mask in register have given value, e.g. power down bit
+	void power(uint8_t reg, uint8_t mask, uint8_t on)
+	{
+		powerReg = reg;
+		powerMask = mask;
+		powerOn = on;
+	}
+
+	// samples so far, none while powered down
+	uint32_t produced() const { return ((asleep ? sleptAt : bus.clock) - sleepTime) / period; }
+
+	// status bits besides data ready, e.g. ADXL345 activity, kept until status is read and raising level line
+	void raise(uint8_t bits)
+	{
+		events |= bits;
+		drive();
+	}
+
+	// data ready line of sensor goes to pin
+	void connect(uint8_t to, Line kind)
+	{
+		pin = to;
+		line = kind;
+		pulsed = produced();
+
+		hostPin(pin, kind == LINE_PULSE ? HIGH : LOW);
+	}
+
+	// drive line for samples produced up to now
+	void drive()
+	{
+		const uint32_t produced = this->produced();
+
+		if (line == LINE_LEVEL)
+		{
+			hostPin(pin, produced > taken || events != 0 ? HIGH : LOW);
+		}
+		else if (line == LINE_PULSE)
+		{
+			for (; pulsed < produced; ++pulsed)
+			{
+				hostPin(pin, LOW);
+				hostPin(pin, HIGH);
+			}
+		}
+	}
+
+	// clock time sample of given x axis reading was produced, for sensor that never slept
+	// and sample less than 65536 periods old
+	uint32_t sampleTime(int16_t x) const
+	{
+		const uint32_t produced = this->produced();
+
+		return (produced - uint16_t(produced - uint16_t(x))) * period;
+	}
+
+	// forget samples so far
+	void restart()
+	{
+		taken = produced();
+		pulsed = taken;
+		missed = 0;
+	}
+
+	// start counting missed samples again, sample stream goes on
+	void clearCounts()
+	{
+		missed = 0;
+	}
+
+	uint32_t missed = 0; // samples replaced by next one before they were read
+	uint32_t statusReads = 0;
+
+protected:
+	SimBus & bus;
+
+	const uint8_t status;
+	const uint8_t readyBit;
+	const uint8_t data;
+	const bool bigEndian;
+	const uint32_t period;
+
+	uint32_t taken = 0;
+	uint32_t pulsed = 0;
+
+	Line line = LINE_NONE;
+	uint8_t pin = 0;
+
+	uint8_t events = 0;
+
+	uint8_t powerReg = 0;
+	uint8_t powerMask = 0;
+	uint8_t powerOn = 0;
+	bool asleep = false;
+	uint32_t sleptAt = 0;
+	uint32_t sleepTime = 0;
+};
+
+// Board at rest on simulated bus, devices answer identity checks of init().
+// Lines move whenever simulated clock does, so data ready edges may come in the middle of a transfer.
+class SimBoard : public SimBus
+{
+public:
+	explicit SimBoard(uint32_t acelPeriod = 1250, uint32_t gyroPeriod = 1250, uint32_t magnPeriod = 13333) :
+		acel(*this, ADXL345::addressLow, 0xFF, 0x30, 0x80, 0x32, false, acelPeriod),
+		gyro(*this, L3G4200D::addressHigh, 0x7F, 0x27, 0x08, 0x28, false, gyroPeriod),
+		magn(*this, 0x1E, 0xFF, 0x09, 0x01, 0x03, true, magnPeriod),
+		pres(0x77),
+		engine(*this)
+	{
+		acel.regs[0x00] = 0xE5;
+		acel.regs[0x37] = 0x01;
+		gyro.regs[0x0F] = 0xD3;
+		magn.regs[0x0A] = 'H';
+		magn.regs[0x0B] = '4';
+		magn.regs[0x0C] = '3';
+		magn.regs[0x05] = 0xFE;	// z, y follows, big endian
+		magn.regs[0x06] = 0x80;
+		magn.regs[0x08] = 0x80;
+		pres.regs[0xD0] = 0x55;
+
+		for (uint8_t reg = 0xAA; reg < 0xC0; ++reg)
+		{
+			pres.regs[reg] = 0x11;
+		}
+
+		attach(acel);
+		attach(gyro);
+		attach(magn);
+		attach(pres);
+	}
+
+	virtual int poll(I2cTransaction & t)
+	{
+		const int result = SimBus::poll(t);
+
+		drive();
+
+		return result;
+	}
+
+	// time spent outside bus, e.g. main loop doing other work
+	void run(uint32_t micros)
+	{
+		advance(micros);
+		drive();
+	}
+
+	void drive()
+	{
+		acel.drive();
+		gyro.drive();
+		magn.drive();
+	}
+
+	void restart()
+	{
+		acel.restart();
+		gyro.restart();
+		magn.restart();
+	}
+
+	SimSensor acel;
+	SimSensor gyro;
+	SimSensor magn;
+	SimDevice pres;
+
+	I2cEngine engine;
+};
+
+// Decimation stage that passes readings on and notes which samples arrived, see Gy80Base::setDecimation().
+struct SampleTrack
+{
+	uint32_t count = 0;
+	uint32_t duplicates = 0;	// same sample taken again
+	uint32_t gaps = 0;			// samples between two taken ones that never arrived
+	int16_t last = 0;
+	bool started = false;
+
+	// start counting again, gap to sample taken last still counts
+	void clearCounts()
+	{
+		count = 0;
+		duplicates = 0;
+		gaps = 0;
+	}
+
+	static bool stage(const int16_t * raw, float * out, void * context)
+	{
+		SampleTrack & t = *static_cast<SampleTrack *>(context);
+
+		if (t.started)
+		{
+			const int16_t step = int16_t(raw[0] - t.last);
+
+			if (step <= 0)
+			{
+				++t.duplicates;
+			}
+			else
+			{
+				t.gaps += step - 1;
+			}
+		}
+
+		t.last = raw[0];
+		t.started = true;
+		++t.count;
+
+		out[0] = 0.0f;
+		out[1] = raw[1];
+		out[2] = raw[2];
+
+		return true;
+	}
+};
+
+#endif
@@ -0,0 +1,26 @@
+// Program for code size comparison of library revisions, see size target in Makefile.
+// Runs init(), sense() and split sense on Wire, uses only calls every revision since the split has.
+
+#include "gy-80.h"
+
+int main()
+{
+	Gy80 board;
+	int r = board.init();
+
+	for (uint8_t i = 0; i < 10; ++i)
+	{
+		r += board.sense().ok();
+	}
+
+	board.startSense();
+
+	while (!board.senseReady())
+	{
+		board.engine().service();
+	}
+
+	r += board.finishSense().ok();
+
+	return r;
+}
@@ -0,0 +1,79 @@
+// Madgwick update in one piece against predict and correct steps it was split into.
+// Prints time per gyro sample of: whole update on every sample, predict and correct on every sample,
+// and predict on every sample with correct on every fourth one, as FusionScheduler runs accelerometer
+// at quarter of gyro rate.
+
+#include <stdio.h>
+
+#include "madgwick.h"
+
+#include "bench.h"
+#include "motion.h"
+
+constexpr uint32_t samples = 4096;
+constexpr float rate = 800.0f;
+
+static FilterInput inputs[samples];
+
+static Quart start()
+{
+	Quart q;
+
+	q.q1() = 0.9f;
+	q.q2() = 0.3f;
+	q.q3() = 0.2f;
+	q.q4() = 0.2f;
+
+	return q;
+}
+
+int main()
+{
+	for (uint32_t i = 0; i < samples; ++i)
+	{
+		inputs[i] = motionSample(i, rate);
+	}
+
+	Quart q = start();
+	MadgwickReference reference;
+
+	const double update = benchNanos(samples, [&](uint32_t i)
+	{
+		MadgwickQuaternionUpdate(q, inputs[i]);
+		benchKeep(q);
+	});
+
+	q = start();
+	reference.valid = false;
+
+	const double split = benchNanos(samples, [&](uint32_t i)
+	{
+		MadgwickQuaternionPredict(q, inputs[i]);
+		MadgwickQuaternionCorrect(q, inputs[i], reference, true);
+		benchKeep(q);
+	});
+
+	q = start();
+	reference.valid = false;
+
+	const double multiRate = benchNanos(samples, [&](uint32_t i)
+	{
+		MadgwickQuaternionPredict(q, inputs[i]);
+
+		if (i % 4 == 0)
+		{
+			FilterInput c = inputs[i];
+			c.deltaT = 4.0f / rate;
+
+			MadgwickQuaternionCorrect(q, c, reference, i % 16 == 0);
+		}
+
+		benchKeep(q);
+	});
+
+	printf("madgwick update every sample              %6.1f ns/sample\n", update);
+	printf("madgwick predict and correct every sample %6.1f ns/sample\n", split);
+	printf("madgwick correct every 4th sample         %6.1f ns/sample, %.2fx update\n", multiRate, update / multiRate);
+
+	return 0;
+}
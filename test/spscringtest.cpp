@@ -0,0 +1,172 @@
+// SpscRing with producer and consumer on two threads.
+// Items are several words wide with a check word, so a slot read while it is written shows up.
+// First pass producer waits when ring is full, every item has to arrive once and in order.
+// Second pass producer never waits, dropped and received items have to add up to offered ones.
+// Build with CXXFLAGS="-O1 -g -fsanitize=thread" LDFLAGS=-fsanitize=thread to let TSan watch it too.
+
+#include <thread>
+
+#include "spscring.h"
+
+#include "check.h"
+
+constexpr uint32_t items = 4000000;
+
+struct Item
+{
+	uint32_t sequence;
+	uint32_t payload[3];
+	uint32_t check;
+};
+
+static Item make(uint32_t sequence)
+{
+	Item item;
+
+	item.sequence = sequence;
+	item.payload[0] = sequence * 2654435761u;
+	item.payload[1] = ~sequence;
+	item.payload[2] = sequence ^ 0x5A5A5A5Au;
+	item.check = item.sequence ^ item.payload[0] ^ item.payload[1] ^ item.payload[2];
+
+	return item;
+}
+
+static bool intact(const Item & item)
+{
+	return item.check == (item.sequence ^ item.payload[0] ^ item.payload[1] ^ item.payload[2]) &&
+		item.payload[1] == ~item.sequence;
+}
+
+static SpscRing<Item, 64> ring;
+static std::atomic<bool> finished { false };
+
+struct Received
+{
+	uint32_t count = 0;
+	uint32_t torn = 0;
+	uint32_t outOfOrder = 0;
+	uint32_t gaps = 0; // items skipped between two received ones
+};
+
+// consumer on this thread until producer is done and ring is empty, slow now and then in lossy pass
+static Received consume(bool slow)
+{
+	Received r;
+	uint32_t next = 0;
+	Item item;
+
+	for (;;)
+	{
+		if (!ring.pop(item))
+		{
+			if (finished.load(std::memory_order_acquire) && ring.size() == 0)
+			{
+				break;
+			}
+
+			std::this_thread::yield();
+			continue;
+		}
+
+		r.torn += !intact(item);
+
+		if (item.sequence < next)
+		{
+			++r.outOfOrder;
+		}
+		else
+		{
+			r.gaps += item.sequence - next;
+			next = item.sequence + 1;
+		}
+
+		++r.count;
+
+		if (slow && r.count % 1024 == 0)
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	return r;
+}
+
+static void lossless()
+{
+	finished = false;
+
+	std::thread producer([]
+	{
+		for (uint32_t i = 0; i < items; ++i)
+		{
+			const Item item = make(i);
+
+			while (!ring.push(item))
+			{
+				std::this_thread::yield(); // lets consumer run on single core host
+			}
+		}
+
+		finished.store(true, std::memory_order_release);
+	});
+
+	const Received r = consume(false);
+	producer.join();
+
+	printf("waiting producer  received %u torn %u out of order %u gaps %u high water %u\n",
+		unsigned(r.count), unsigned(r.torn), unsigned(r.outOfOrder), unsigned(r.gaps), unsigned(ring.highWater()));
+
+	CHECK(r.count == items);
+	CHECK(r.torn == 0);
+	CHECK(r.outOfOrder == 0);
+	CHECK(r.gaps == 0);
+	CHECK(ring.pushed() == items);
+	CHECK(ring.highWater() <= ring.capacity());
+}
+
+static void lossy()
+{
+	finished = false;
+
+	const uint32_t pushedBefore = ring.pushed();
+	const uint32_t overflowsBefore = ring.overflows();
+
+	std::thread producer([pushedBefore]
+	{
+		for (uint32_t i = 0; i < items; ++i)
+		{
+			ring.push(make(pushedBefore + i));
+
+			// bursts longer than ring, consumer gets to run between them even on single core
+			if (i % 256 == 255)
+			{
+				std::this_thread::yield();
+			}
+		}
+
+		finished.store(true, std::memory_order_release);
+	});
+
+	Received r = consume(true);
+	producer.join();
+
+	const uint32_t dropped = ring.overflows() - overflowsBefore;
+
+	printf("dropping producer received %u torn %u out of order %u dropped %u\n",
+		unsigned(r.count), unsigned(r.torn), unsigned(r.outOfOrder), unsigned(dropped));
+
+	CHECK(r.torn == 0);
+	CHECK(r.outOfOrder == 0);
+	CHECK(r.count + dropped == items);
+	CHECK(ring.pushed() - pushedBefore == r.count);
+	CHECK(ring.highWater() == ring.capacity());
+}
+
+int main()
+{
+	lossless();
+	lossy();
+
+	return checkResult();
+}
@@ -0,0 +1,84 @@
+// Cost of vibration spectrum: realFftPower() against direct DFT of the same size,
+// and VibrationMonitor::push() per three axis sample, which spreads one FFT per axis over the window.
+
+#include <math.h>
+#include <stdio.h>
+
+#include "vibration.h"
+
+#include "bench.h"
+
+static float data[1024], work[1024], twiddle[1024], power[513];
+
+// power spectrum by definition, what the FFT saves
+static void directPower(const float * x, uint16_t n, const float * twiddle, float * power)
+{
+	const uint16_t half = n / 2;
+
+	for (uint16_t k = 0; k <= half; ++k)
+	{
+		float re = 0.0f, im = 0.0f;
+
+		for (uint16_t i = 0, j = 0; i < n; ++i, j = (j + k) & (n - 1))
+		{
+			// angle of index j is in table as is, or half turn on with both signs flipped
+			const float c = j < half ? twiddle[j] : -twiddle[j - half];
+			const float s = j < half ? twiddle[half + j] : -twiddle[j];
+
+			re += x[i] * c;
+			im += x[i] * s;
+		}
+
+		power[k] = re * re + im * im;
+	}
+}
+
+template <uint16_t N>
+void benchMonitor()
+{
+	static VibrationMonitor<N> monitor(1600.0f);
+
+	const double push = benchNanos(64 * N, [&](uint32_t i)
+	{
+		benchKeep(monitor.push(data[i & 1023], data[(i + 1) & 1023], data[(i + 2) & 1023], i));
+	});
+
+	printf("VibrationMonitor<%u>::push()  %7.1f ns per sample\n", N, push);
+}
+
+int main()
+{
+	for (uint16_t i = 0; i < 1024; ++i)
+	{
+		data[i] = sinf(0.37f * i) + 0.3f * sinf(1.9f * i);
+	}
+
+	for (uint16_t n = 64; n <= 1024; n *= 2)
+	{
+		fftTwiddles(twiddle, n);
+
+		const double fft = benchNanos(20000000 / (n * 8), [&](uint32_t)
+		{
+			for (uint16_t i = 0; i < n; ++i)
+			{
+				work[i] = data[i];
+			}
+
+			realFftPower(work, n, twiddle, power);
+			benchKeep(power);
+		});
+
+		const double dft = benchNanos(20000000 / (n * n / 2) + 1, [&](uint32_t)
+		{
+			directPower(data, n, twiddle, power);
+			benchKeep(power);
+		});
+
+		printf("%4u points  realFftPower %8.0f ns  direct DFT %10.0f ns  %5.1fx\n", n, fft, dft, dft / fft);
+	}
+
+	benchMonitor<256>();
+	benchMonitor<1024>();
+
+	return 0;
+}
@@ -0,0 +1,162 @@
+// Vibration spectrum. realFftPower() against direct DFT in double, VibrationMonitor against known sines:
+// peak frequency and amplitude, and band sums that add up to mean square as Parseval says.
+
+#include <math.h>
+#include <stdio.h>
+
+#include "vibration.h"
+
+#include "check.h"
+
+static uint32_t seed = 1;
+
+static float noise()
+{
+	seed = seed * 1664525u + 1013904223u;
+	return float(int32_t(seed) >> 8) / float(1 << 23);
+}
+
+// power spectrum against direct DFT, error relative to largest bin
+static void checkFft(uint16_t n)
+{
+	static float data[4096], twiddle[4096], power[2049];
+	static double input[4096];
+
+	for (uint16_t i = 0; i < n; ++i)
+	{
+		data[i] = noise() + 0.5f * sinf(0.3f * i);
+		input[i] = data[i];
+	}
+
+	fftTwiddles(twiddle, n);
+	realFftPower(data, n, twiddle, power);
+
+	double largest = 0.0, worst = 0.0;
+	double direct[2049];
+
+	for (uint16_t k = 0; k <= n / 2; ++k)
+	{
+		double re = 0.0, im = 0.0;
+
+		for (uint16_t i = 0; i < n; ++i)
+		{
+			const double a = -2.0 * M_PI * double(uint32_t(k) * i % n) / n;
+			re += input[i] * cos(a);
+			im += input[i] * sin(a);
+		}
+
+		direct[k] = re * re + im * im;
+		largest = direct[k] > largest ? direct[k] : largest;
+	}
+
+	for (uint16_t k = 0; k <= n / 2; ++k)
+	{
+		const double error = fabs(power[k] - direct[k]) / largest;
+		worst = error > worst ? error : worst;
+	}
+
+	printf("realFftPower %4u points, largest error %.1e of largest bin\n", n, worst);
+
+	CHECK(worst < 1e-5);
+}
+
+struct Tone
+{
+	float frequency;
+	float amplitude;
+};
+
+// sines on x and y, nothing but gravity on z, rate 1600 Hz, bands of 100 Hz up to Nyquist
+template <uint16_t N>
+static void checkMonitor(const Tone & x, const Tone & y1, const Tone & y2)
+{
+	const float rate = 1600.0f;
+	VibrationMonitor<N> monitor(rate);
+
+	float edges[9];
+
+	for (uint8_t b = 0; b <= 8; ++b)
+	{
+		edges[b] = b * 100.0f;
+	}
+
+	// last edge a bit past Nyquist, so Nyquist bin is in
+	edges[8] = 801.0f;
+	CHECK(monitor.setBands(edges, 8) == 0);
+
+	uint32_t reports = 0;
+	float worstFrequency = 0.0f, worstAmplitude = 0.0f, worstParseval = 0.0f, worstBand = 0.0f;
+
+	for (uint32_t i = 0; i < 20 * N; ++i)
+	{
+		const float t = i / rate;
+
+		const float vx = x.amplitude * sinf(2.0f * float(M_PI) * x.frequency * t);
+		const float vy = y1.amplitude * sinf(2.0f * float(M_PI) * y1.frequency * t) + y2.amplitude * sinf(2.0f * float(M_PI) * y2.frequency * t + 1.0f);
+
+		if (!monitor.push(vx + 0.1f, vy, 1.0f, i))
+		{
+			continue;
+		}
+
+		++reports;
+
+		const VibrationReport & r = monitor.report();
+
+		// x, one sine, peak anywhere between bins
+		const VibrationAxis & ax = r.axis[0];
+		worstFrequency = fmaxf(worstFrequency, fabsf(ax.peakFrequency - x.frequency) / monitor.binWidth());
+		worstAmplitude = fmaxf(worstAmplitude, fabsf(ax.peakAmplitude - x.amplitude) / x.amplitude);
+
+		// bands of x and y add up to mean square, tone power is in its band
+		for (uint8_t a = 0; a < 2; ++a)
+		{
+			const VibrationAxis & v = r.axis[a];
+			float sum = 0.0f;
+
+			for (uint8_t b = 0; b < 8; ++b)
+			{
+				sum += v.band[b];
+			}
+
+			worstParseval = fmaxf(worstParseval, fabsf(sum - v.rms * v.rms) / (v.rms * v.rms));
+		}
+
+		const float xBand = ax.band[uint8_t(x.frequency / 100.0f)];
+		worstBand = fmaxf(worstBand, fabsf(xBand - 0.5f * x.amplitude * x.amplitude) / (0.5f * x.amplitude * x.amplitude));
+
+		// y, strongest of two sines is peak
+		const Tone & strong = y1.amplitude > y2.amplitude ? y1 : y2;
+		CHECK(fabsf(r.axis[1].peakFrequency - strong.frequency) < monitor.binWidth());
+
+		// z has no vibration at all
+		CHECK(r.axis[2].rms < 1e-6f);
+		CHECK(r.axis[2].peakAmplitude < 1e-6f);
+	}
+
+	printf("VibrationMonitor<%u> %.1f Hz: %u reports, peak frequency off by %.3f bins, amplitude by %.2f%%, "
+		"bands miss mean square by %.2f%%, tone band by %.2f%%\n",
+		N, x.frequency, (unsigned)reports, worstFrequency, 100.0f * worstAmplitude, 100.0f * worstParseval, 100.0f * worstBand);
+
+	CHECK(reports == 20 * 2 - 2);
+	CHECK(worstFrequency < 0.01f);
+	CHECK(worstAmplitude < 0.005f);
+	CHECK(worstParseval < 0.02f);
+	CHECK(worstBand < 0.02f);
+}
+
+int main()
+{
+	for (uint16_t n = 16; n <= 4096; n *= 4)
+	{
+		checkFft(n);
+	}
+
+	// on bin, half and quarter bin off, anywhere
+	checkMonitor<256>({ 250.0f, 0.5f }, { 60.0f, 0.2f }, { 430.0f, 0.05f });
+	checkMonitor<256>({ 253.125f, 0.5f }, { 60.0f, 0.02f }, { 430.0f, 0.05f });
+	checkMonitor<256>({ 251.5625f, 1.5f }, { 60.0f, 0.02f }, { 430.0f, 0.05f });
+	checkMonitor<1024>({ 123.4f, 0.05f }, { 720.0f, 0.3f }, { 30.0f, 0.1f });
+
+	return checkResult();
+}
@@ -0,0 +1,106 @@
+#include "vibration.h"
+
+#include <Arduino.h>
+
+void fftTwiddles(float * twiddle, uint16_t n)
+{
+	const uint16_t half = n / 2;
+
+	for (uint16_t k = 0; k < half; ++k)
+	{
+		const float angle = -2.0f * float(PI) * k / n;
+
+		twiddle[k] = cosf(angle);
+		twiddle[half + k] = sinf(angle);
+	}
+}
+
+void hannWindow(float * window, uint16_t n)
+{
+	for (uint16_t k = 0; k < n; ++k)
+	{
+		window[k] = 0.5f - 0.5f * cosf(2.0f * float(PI) * k / n);
+	}
+}
+
+void realFftPower(float * data, uint16_t n, const float * twiddle, float * power)
+{
+	// even samples are real parts, odd ones imaginary parts of m complex points
+	const uint16_t m = n / 2;
+	const float * cosine = twiddle;
+	const float * sine = twiddle + m;
+
+	// bit reversed order
+	for (uint16_t i = 1, j = 0; i < m; ++i)
+	{
+		uint16_t bit = m >> 1;
+
+		for (; j & bit; bit >>= 1)
+		{
+			j ^= bit;
+		}
+
+		j |= bit;
+
+		if (i < j)
+		{
+			float t = data[2 * i];
+			data[2 * i] = data[2 * j];
+			data[2 * j] = t;
+
+			t = data[2 * i + 1];
+			data[2 * i + 1] = data[2 * j + 1];
+			data[2 * j + 1] = t;
+		}
+	}
+
+	// butterflies, twiddle of m point transform is every other one of n point table
+	for (uint16_t size = 2; size <= m; size <<= 1)
+	{
+		const uint16_t half = size / 2;
+		const uint16_t step = n / size;
+
+		for (uint16_t start = 0; start < m; start += size)
+		{
+			for (uint16_t k = 0; k < half; ++k)
+			{
+				const float wr = cosine[k * step];
+				const float wi = sine[k * step];
+
+				float * a = data + 2 * (start + k);
+				float * b = data + 2 * (start + k + half);
+
+				const float tr = b[0] * wr - b[1] * wi;
+				const float ti = b[0] * wi + b[1] * wr;
+
+				b[0] = a[0] - tr;
+				b[1] = a[1] - ti;
+				a[0] += tr;
+				a[1] += ti;
+			}
+		}
+	}
+
+	// split into spectrum of real signal, X[k] = (Z[k] + Z*[m-k]) / 2 - i W^k (Z[k] - Z*[m-k]) / 2
+	power[0] = (data[0] + data[1]) * (data[0] + data[1]);
+	power[m] = (data[0] - data[1]) * (data[0] - data[1]);
+
+	for (uint16_t k = 1; k < m; ++k)
+	{
+		const float zr = data[2 * k], zi = data[2 * k + 1];
+		const float cr = data[2 * (m - k)], ci = -data[2 * (m - k) + 1];
+
+		const float er = 0.5f * (zr + cr), ei = 0.5f * (zi + ci);	// even samples
+		const float dr = 0.5f * (zr - cr), di = 0.5f * (zi - ci);
+
+		// odd samples are -i (Z[k] - Z*[m-k]) / 2
+		const float orr = di, oi = -dr;
+
+		const float wr = cosine[k], wi = sine[k];
+
+		const float xr = er + orr * wr - oi * wi;
+		const float xi = ei + orr * wi + oi * wr;
+
+		power[k] = xr * xr + xi * xi;
+	}
+}
@@ -0,0 +1,228 @@
+#ifndef vibration_h_
+#define vibration_h_
+
+#include <stdint.h>
+#include <math.h>
+
+#include "imusample.h"
+
+// Radix-2 FFT of n real samples in place, n power of two, done as complex FFT of n / 2 points.
+// twiddle has n / 2 cosines then n / 2 sines of -2 pi k / n, see fftTwiddles().
+// power gets squared magnitude of bins 0 to n / 2.
+void realFftPower(float * data, uint16_t n, const float * twiddle, float * power);
+void fftTwiddles(float * twiddle, uint16_t n);
+// periodic Hann window
+void hannWindow(float * window, uint16_t n);
+
+// spectrum summary of one axis over one window, acceleration in input units, usually G
+struct VibrationAxis
+{
+	static constexpr uint8_t maxBands = 8;
+
+	float rms;				// of signal with its mean removed, so gravity does not count
+	float peakFrequency;	// Hz, strongest bin besides DC, interpolated between bins
+	float peakAmplitude;	// of sine at peak frequency, interpolated too
+	float band[maxBands];	// mean square within band, bands add up to square of rms
+};
+
+struct VibrationReport
+{
+	uint32_t time;		// of newest sample in window
+	uint32_t windows;	// reports so far
+	VibrationAxis axis[3];
+};
+
+// Running vibration spectrum of three axes, e.g. ADXL345 FIFO stream at high output rate.
+// Windows of N samples overlap by half, Hann windowed. Spectra of the three axes are
+// computed on three successive pushes, so no push runs more than one FFT.
+// Fixed size, nothing is allocated, float throughout as Teensy 3.5 and up have FPU.
+template <uint16_t N = 256>
+class VibrationMonitor
+{
+	static_assert(N >= 16 && N <= 4096 && (N & (N - 1)) == 0, "Window must be power of two, 16 to 4096");
+
+public:
+	// sample rate in Hz, e.g. 1000000 / ADXL345T<...>::period()
+	explicit VibrationMonitor(float sampleRate) : rate(sampleRate)
+	{
+		fftTwiddles(twiddle, N);
+		hannWindow(window, N);
+	}
+
+	VibrationMonitor (const VibrationMonitor &) = delete;
+	VibrationMonitor & operator = (const VibrationMonitor &) = delete;
+
+	// count bands from count + 1 ascending edges in Hz, return -1 if there are too many or edges are not ascending
+	int setBands(const float * edges, uint8_t count)
+	{
+		if (count > VibrationAxis::maxBands)
+		{
+			return -1;
+		}
+
+		for (uint8_t i = 0; i < count; ++i)
+		{
+			if (!(edges[i] < edges[i + 1]))
+			{
+				return -1;
+			}
+		}
+
+		bands = count;
+
+		for (uint8_t i = 0; i <= count; ++i)
+		{
+			// bin k covers frequencies from k - 0.5 to k + 0.5 bins
+			const float bin = edges[i] * N / rate + 0.5f;
+			edge[i] = bin <= 0.0f ? 0 : bin >= N / 2 + 1 ? N / 2 + 1 : uint16_t(bin);
+		}
+
+		return 0;
+	}
+
+	// one sample, return true when report() has new result
+	bool push(float x, float y, float z, uint32_t time)
+	{
+		history[0][head] = x;
+		history[1][head] = y;
+		history[2][head] = z;
+
+		head = head + 1 < ring ? head + 1 : 0;
+
+		if (filled < N)
+		{
+			++filled;
+		}
+
+		if (pending > 0)
+		{
+			// previous window ends pending axes back
+			analyze(3 - pending, 3 - pending);
+
+			if (--pending == 0)
+			{
+				++next.windows;
+				result = next;
+				return true;
+			}
+		}
+
+		if (++sinceWindow >= N / 2 && filled == N)
+		{
+			sinceWindow = 0;
+			next.time = time;
+
+			analyze(0, 0);
+			pending = 2;
+		}
+
+		return false;
+	}
+
+	bool push(const ImuSample & s) { return push(s.values[0], s.values[1], s.values[2], s.time); }
+
+	const VibrationReport & report() const { return result; }
+
+	float binWidth() const { return rate / N; }
+
+protected:
+	// one axis over window ending back samples before newest
+	void analyze(uint8_t a, uint16_t back)
+	{
+		VibrationAxis & out = next.axis[a];
+
+		// newest sample of window, oldest is N - 1 before it
+		uint16_t i = head >= back + 1 ? head - back - 1 : head + ring - back - 1;
+		i = i >= N - 1 ? i - (N - 1) : i + ring - (N - 1);
+
+		float mean = 0.0f;
+
+		for (uint16_t k = 0, j = i; k < N; ++k, j = j + 1 < ring ? j + 1 : 0)
+		{
+			work[k] = history[a][j];
+			mean += work[k];
+		}
+
+		mean /= N;
+
+		float square = 0.0f;
+
+		for (uint16_t k = 0; k < N; ++k)
+		{
+			const float v = work[k] - mean;
+			square += v * v;
+			work[k] = v * window[k];
+		}
+
+		out.rms = sqrtf(square / N);
+
+		realFftPower(work, N, twiddle, power);
+
+		// Parseval, bins other than DC and Nyquist stand for two, Hann window keeps 3/8 of power
+		const float scale = 2.0f / (float(N) * N * 0.375f);
+
+		uint16_t peak = 1;
+
+		for (uint16_t k = 2; k < N / 2; ++k)
+		{
+			if (power[k] > power[peak])
+			{
+				peak = k;
+			}
+		}
+
+		// Hann window spreads sine d bins from its frequency to sinc(d) / (1 - d^2) of its peak, so ratio r of
+		// larger neighbour to peak bin gives offset (2 r - 1) / (r + 1) of sine, exact for a single sine
+		const bool right = power[peak + 1] > power[peak - 1];
+		const float ratio = sqrtf(power[right ? peak + 1 : peak - 1] / (power[peak] + 1e-30f));
+		const float d = ratio > 0.5f ? (2.0f * ratio - 1.0f) / (ratio + 1.0f) : 0.0f;
+		const float offset = right ? d : -d;
+
+		out.peakFrequency = (peak + offset) * rate / N;
+		// Hann has half coherent gain, sine of amplitude A gives bin of A N / 4 when on the bin
+		const float pd = 3.14159265f * d;
+		const float spread = d > 0.0f ? sinf(pd) / (pd * (1.0f - d * d)) : 1.0f;
+		out.peakAmplitude = 4.0f * sqrtf(power[peak]) / (N * spread);
+
+		for (uint8_t b = 0; b < bands; ++b)
+		{
+			float sum = 0.0f;
+
+			for (uint16_t k = edge[b]; k < edge[b + 1]; ++k)
+			{
+				sum += k == 0 || k == N / 2 ? 0.5f * power[k] : power[k];
+			}
+
+			out.band[b] = sum * scale;
+		}
+
+		for (uint8_t b = bands; b < VibrationAxis::maxBands; ++b)
+		{
+			out.band[b] = 0.0f;
+		}
+	}
+
+	// two more than window, so later axes still see their window while new samples come
+	static constexpr uint16_t ring = N + 2;
+
+	const float rate;
+
+	float history[3][ring] = {};
+	uint16_t head = 0;
+	uint16_t filled = 0;
+	uint16_t sinceWindow = 0;
+	uint8_t pending = 0; // axes of current window still to analyze
+
+	float work[N];
+	float power[N / 2 + 1];
+	float window[N];
+	float twiddle[N];
+
+	uint8_t bands = 0;
+	uint16_t edge[VibrationAxis::maxBands + 1];
+
+	VibrationReport next = {};
+	VibrationReport result = {};
+};
+
+#endif